@@ -0,0 +1,150 @@
+/**
+ * Throughput and latency bench for two boards connected with an Ethernet cable.
+ *
+ * Upload with ECHO_SIDE defined to one board and without it to the other.
+ * The echo side answers UDP pings and receives TCP data.
+ * The measuring side runs UDP ping-pong and a TCP bulk transfer repeatedly
+ * and prints a CSV line per run, with throughput, p50/p99 ping time and CPU load,
+ * so results of different releases or settings can be compared.
+ * The CPU load column requires FreeRTOS run time stats (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS).
+ * extras/host/link_bench runs the same bench between two emulated ENC28J60 without hardware.
+ */
+
+#include <EthernetESP32.h>
+
+//#define ECHO_SIDE
+
+const uint16_t UDP_PORT = 7;
+const uint16_t TCP_PORT = 5001;
+const int PINGS = 200;
+const int PING_SIZE = 64;
+const uint32_t TCP_BYTES = 1000000;
+
+IPAddress echoIP(192, 168, 200, 1);
+IPAddress benchIP(192, 168, 200, 2);
+
+W5500Driver driver;
+//ENC28J60Driver driver;
+
+EthernetUDP udp;
+
+#ifdef ECHO_SIDE
+EthernetServer server(TCP_PORT);
+#endif
+
+void setup() {
+
+  Serial.begin(115200);
+  while (!Serial);
+
+  Ethernet.init(driver);
+#ifdef ECHO_SIDE
+  Ethernet.begin(echoIP);
+  server.begin();
+#else
+  Ethernet.begin(benchIP);
+  Serial.println("run,udp_p50_us,udp_p99_us,udp_lost,tcp_kBps,cpu_idle_pct");
+#endif
+  udp.begin(UDP_PORT);
+}
+
+#ifdef ECHO_SIDE
+
+static uint8_t buffer[1460];
+
+void loop() {
+  if (udp.parsePacket()) {
+    int len = udp.read(buffer, sizeof(buffer));
+    udp.beginPacket(udp.remoteIP(), udp.remotePort());
+    udp.write(buffer, len);
+    udp.endPacket();
+  }
+  EthernetClient client = server.accept();
+  if (client) {
+    while (client.connected()) {
+      if (client.read(buffer, sizeof(buffer)) <= 0) {
+        delay(0);
+      }
+    }
+    client.stop();
+  }
+}
+
+#else
+
+static uint32_t pingTimes[PINGS];
+static uint8_t buffer[1460];
+int run = 0;
+
+uint32_t idleRunTime() {
+#if configGENERATE_RUN_TIME_STATS
+  // the network tasks run on all cores, sum the idle tasks of all of them
+  uint32_t time = 0;
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    TaskStatus_t status;
+    vTaskGetInfo(xTaskGetIdleTaskHandleForCore(core), &status, pdFALSE, eRunning);
+    time += status.ulRunTimeCounter; // us with the default run time clock
+  }
+  return time;
+#else
+  return 0;
+#endif
+}
+
+void loop() {
+  delay(2000);
+
+  // UDP ping-pong
+  int received = 0;
+  for (int i = 0; i < PINGS; i++) {
+    memcpy(buffer, &i, sizeof(i));
+    unsigned long start = micros();
+    udp.beginPacket(echoIP, UDP_PORT);
+    udp.write(buffer, PING_SIZE);
+    udp.endPacket();
+    while (micros() - start < 100000) {
+      if (udp.parsePacket()) {
+        int seq;
+        udp.read((uint8_t*) &seq, sizeof(seq));
+        udp.flush();
+        if (seq == i) {
+          pingTimes[received++] = micros() - start;
+          break;
+        }
+      }
+    }
+  }
+  uint32_t p50 = 0;
+  uint32_t p99 = 0;
+  if (received > 0) {
+    qsort(pingTimes, received, sizeof(pingTimes[0]), [](const void *a, const void *b) {
+      uint32_t x = *(const uint32_t*) a;
+      uint32_t y = *(const uint32_t*) b;
+      return (x > y) - (x < y);
+    });
+    p50 = pingTimes[received / 2];
+    p99 = pingTimes[received * 99 / 100];
+  }
+
+  // TCP bulk transfer. the CPU load is estimated from the time the idle tasks of all cores get
+  EthernetClient client;
+  unsigned long tcpTime = 0;
+  uint32_t idleTime = 0;
+  uint32_t sent = 0;
+  if (client.connect(echoIP, TCP_PORT)) {
+    uint32_t idleStart = idleRunTime();
+    unsigned long start = micros();
+    while (sent < TCP_BYTES && client.connected()) {
+      sent += client.write(buffer, sizeof(buffer));
+    }
+    client.stop();
+    tcpTime = micros() - start;
+    idleTime = idleRunTime() - idleStart;
+  }
+  unsigned long kBps = tcpTime ? (unsigned long) ((uint64_t) sent * 1000 / tcpTime) : 0;
+  unsigned long idlePct = tcpTime ? (unsigned long) ((uint64_t) idleTime * 100 / ((uint64_t) tcpTime * portNUM_PROCESSORS)) : 0;
+
+  Serial.printf("%d,%lu,%lu,%d,%lu,%lu\n", run++, (unsigned long) p50, (unsigned long) p99, PINGS - received, kBps, idlePct);
+}
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * Compares the SPIClass backend of the SPI drivers with the native ESP-IDF SPI backend.
+ *
+ * Register access latency is measured with reads of a PHY register,
+ * bulk transfer throughput with transmitting of full size frames.
+ * Run it once with and once without USE_SPI_HOST.
+ */
+
+#include <EthernetESP32.h>
+
+#define USE_SPI_HOST
+
+const int REG_READS = 1000;
+const int FRAMES = 500;
+
+W5500Driver driver;
+
+void setup() {
+
+  Serial.begin(115200);
+  while (!Serial);
+
+#ifdef USE_SPI_HOST
+  // the SPI pins of the board on the host which SPIClass would use
+  driver.setSpiHost(SPI2_HOST, SCK, MISO, MOSI);
+  Serial.println("native ESP-IDF SPI backend");
+#else
+  Serial.println("SPIClass backend");
+#endif
+
+  Ethernet.init(driver);
+  Ethernet.begin(1000);
+  if (Ethernet.hardwareStatus() == EthernetNoHardware) {
+    Serial.println("Ethernet module not found");
+    while (true) {
+      delay(1);
+    }
+  }
+
+  esp_eth_handle_t ethHandle = Ethernet.getEthHandle();
+
+  uint32_t regValue;
+  esp_eth_phy_reg_rw_data_t phyReg = {};
+  phyReg.reg_addr = 1; // basic status register
+  phyReg.reg_value_p = &regValue;
+  unsigned long start = micros();
+  for (int i = 0; i < REG_READS; i++) {
+    esp_eth_ioctl(ethHandle, ETH_CMD_READ_PHY_REG, &phyReg);
+  }
+  unsigned long time = micros() - start;
+  Serial.printf("register read: %lu ns\n", time * 1000 / REG_READS);
+
+  static uint8_t frame[ETH_MAX_PAYLOAD_LEN + ETH_HEADER_LEN];
+  memset(frame, 0xFF, ETH_ADDR_LEN); // broadcast
+  Ethernet.MACAddress(frame + ETH_ADDR_LEN);
+  frame[12] = 0x88; // local experimental EtherType
+  frame[13] = 0xB5;
+  start = micros();
+  for (int i = 0; i < FRAMES; i++) {
+    esp_eth_transmit(ethHandle, frame, sizeof(frame));
+  }
+  time = micros() - start;
+  Serial.printf("transmit: %lu kB/s (limited by the link speed too)\n", (unsigned long) ((uint64_t) FRAMES * sizeof(frame) * 1000 / time));
+}
+
+void loop() {
+  delay(1);
+}
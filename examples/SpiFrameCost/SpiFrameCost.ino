@@ -0,0 +1,78 @@
+/**
+ * Measures the SPI cost of transmitting a frame with the SPI drivers.
+ *
+ * Transmits a series of small frames (size of a TCP ACK) and of full size frames
+ * and prints the count of SPI accesses and SPI bytes per frame.
+ * After each series the SPI traffic of the driver while idle (status polling) is measured
+ * for the same time and subtracted.
+ * Run it with each of the modules to compare their framing overhead.
+ * extras/host/frame_cost measures the same without hardware, for TX and RX.
+ */
+
+#include <EthernetESP32.h>
+
+const int FRAMES = 200;
+
+W5500Driver driver;
+//ENC28J60Driver driver;
+//DM9051Driver driver;
+
+esp_eth_handle_t ethHandle;
+static uint8_t frame[ETH_MAX_PAYLOAD_LEN + ETH_HEADER_LEN];
+
+void setup() {
+
+  Serial.begin(115200);
+  while (!Serial);
+
+  Ethernet.init(driver);
+  Ethernet.begin(1000);
+  if (Ethernet.hardwareStatus() == EthernetNoHardware) {
+    Serial.println("Ethernet module not found");
+    while (true) {
+      delay(1);
+    }
+  }
+  ethHandle = Ethernet.getEthHandle();
+
+  memset(frame, 0xFF, ETH_ADDR_LEN); // broadcast
+  Ethernet.MACAddress(frame + ETH_ADDR_LEN);
+  frame[12] = 0x88; // local experimental EtherType
+  frame[13] = 0xB5;
+
+  measure(60); // minimal frame without CRC, as a TCP ACK
+  measure(sizeof(frame));
+}
+
+void loop() {
+  delay(1);
+}
+
+void measure(uint32_t frameSize) {
+
+  unsigned long start = millis();
+  uint32_t accesses = driver.spiAccessCount();
+  uint64_t bytes = driver.spiByteCount();
+  for (int i = 0; i < FRAMES; i++) {
+    esp_eth_transmit(ethHandle, frame, frameSize);
+  }
+  unsigned long time = millis() - start;
+  accesses = driver.spiAccessCount() - accesses;
+  bytes = driver.spiByteCount() - bytes;
+
+  // the idle SPI traffic in the same time
+  uint32_t idleAccesses = driver.spiAccessCount();
+  uint64_t idleBytes = driver.spiByteCount();
+  delay(time);
+  idleAccesses = driver.spiAccessCount() - idleAccesses;
+  idleBytes = driver.spiByteCount() - idleBytes;
+  if (idleAccesses < accesses) {
+    accesses -= idleAccesses;
+  }
+  if (idleBytes < bytes) {
+    bytes -= idleBytes;
+  }
+
+  Serial.printf("frame %lu B: %lu SPI accesses, %lu SPI bytes per frame\n", (unsigned long) frameSize,
+      (unsigned long) (accesses / FRAMES), (unsigned long) (bytes / FRAMES));
+}
@@ -8,6 +8,8 @@
 W5500Driver driver;
 W5500Driver driver1(16);
 
+EthSpiArbiter spiArbiter; // both modules are on the same SPI bus
+
 EthernetClass Ethernet1;
 
 void setup() {
@@ -15,31 +17,25 @@ void setup() {
   Serial.begin(115200);
   while (!Serial);
 
+  driver.setArbiter(spiArbiter);
+  driver1.setArbiter(spiArbiter);
+
   Ethernet.init(driver);
   Ethernet1.init(driver1);
 
-  Serial.println("Attempting to connect with DHCP (eth0) ...");
-  if (!Ethernet.begin()) {
-    Serial.println("\t...ERROR (eth0)");
-    while (true) {
-      delay(1);
-    }
-  } else {
-    Serial.println("\t...success (eth0)");
-    printEthernetStatus(Ethernet);
-  }
-
-  Serial.println();
-
-  Serial.println("Attempting to connect with DHCP (eth1) ... ");
-  if (!Ethernet1.begin()) {
-    Serial.println("\t...ERROR (eth1)");
-    while (true) {
-      delay(1);
+  // both interfaces start and wait for DHCP at the same time
+  Serial.println("Attempting to connect with DHCP ...");
+  EthernetClass* eths[] = {&Ethernet, &Ethernet1};
+  EthernetClass::beginAll(eths, 2);
+
+  for (EthernetClass* eth : eths) {
+    Serial.println();
+    if (eth->hasIP()) {
+      Serial.printf("\t...success (%s)\n", eth->desc());
+      printEthernetStatus(*eth);
+    } else {
+      Serial.printf("\t...ERROR (%s)\n", eth->desc());
     }
-  } else {
-    Serial.println("\t...success (eth1)");
-    printEthernetStatus(Ethernet1);
   }
 }
 
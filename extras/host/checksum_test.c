@@ -0,0 +1,332 @@
+/*
+ * Test of the ENC28J60 TX checksum offload against a software checksum.
+ *
+ * IPv4 and IPv6 frames with TCP and UDP segments are transmitted through the driver with
+ * tx_checksum_offload, in single and double buffer mode. The chip model computes the DMA
+ * checksums like the chip, the frames it puts on the wire are compared with the frame
+ * transmitted, where the IPv4 header checksum and the TCP/UDP checksum are computed here in
+ * software. The checksum fields of the transmitted frames are filled with garbage, so a
+ * field the driver doesn't write shows up. The cases cover frames from the minimum to the
+ * maximum size, odd lengths, IPv4 options and IPv6 extension headers (computed by the
+ * driver in software), a VLAN tag and IPv4 fragments (IP header checksum only).
+ *
+ * usage: checksum_test [--seed n]
+ * exits with 1 if a frame differs
+ */
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_eth.h"
+#include "esp_eth_enc28j60.h"
+#include "host_eth.h"
+#include "host_spi.h"
+#include "enc28j60_model.h"
+
+#define TEST_INT_GPIO (4)
+#define TEST_TIMEOUT_MS (2000)
+#define TEST_GARBAGE (0xA5)
+
+typedef struct {
+    const char *name;
+    bool ip6;
+    uint8_t proto;      // 6 TCP, 17 UDP
+    bool vlan;
+    bool options;       // IPv4 options or an IPv6 hop-by-hop header
+    bool fragment;      // IPv4 more fragments flag
+} test_case_t;
+
+typedef struct {
+    atomic_uint frames;
+    uint8_t frame[ETH_MAX_PACKET_SIZE];
+    uint32_t length;
+} test_wire_t;
+
+static const uint8_t s_dev_addr[ETH_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t s_peer_addr[ETH_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+static const test_case_t s_cases[] = {
+    { "ip4_udp", false, 17, false, false, false },
+    { "ip4_tcp", false, 6, false, false, false },
+    { "ip4_udp_options", false, 17, false, true, false },
+    { "ip4_tcp_options", false, 6, false, true, false },
+    { "ip4_udp_vlan", false, 17, true, false, false },
+    { "ip4_udp_fragment", false, 17, false, false, true },
+    { "ip6_udp", true, 17, false, false, false },
+    { "ip6_tcp", true, 6, false, false, false },
+    { "ip6_udp_hop_by_hop", true, 17, false, true, false },
+    { "ip6_tcp_hop_by_hop", true, 6, false, true, false },
+    { "ip6_tcp_vlan", true, 6, true, false, false },
+};
+
+static uint32_t s_seed = 1;
+
+static uint8_t test_random(void)
+{
+    s_seed = s_seed * 1103515245 + 12345;
+    return s_seed >> 16;
+}
+
+static void test_sleep_us(uint32_t us)
+{
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+static uint32_t test_transmit(void *ctx, const uint8_t *frame, uint32_t length)
+{
+    test_wire_t *wire = (test_wire_t *)ctx;
+    memcpy(wire->frame, frame, length);
+    wire->length = length;
+    atomic_fetch_add(&wire->frames, 1);
+    return length * 8 / 10; // 10 Mbps
+}
+
+static void test_input(void *ctx, const uint8_t *frame, uint32_t length)
+{
+}
+
+static esp_err_t test_spi_xfer(void *chip, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len)
+{
+    return enc28j60_model_spi((enc28j60_model_t *)chip, write, cmd, addr, data, len);
+}
+
+static uint32_t test_sum(uint32_t sum, const uint8_t *data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        sum += (i & 1) ? data[i] : data[i] << 8;
+    }
+    return sum;
+}
+
+static uint16_t test_fold(uint32_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return ~sum;
+}
+
+/**
+ * @brief Build the frame of the case with payload_len bytes of TCP/UDP payload
+ * @return frame length, the offsets of the IPv4 header checksum (0 for IPv6) and of the L4 checksum
+ */
+static uint32_t test_frame(const test_case_t *tc, uint32_t payload_len, uint8_t *frame, uint32_t *ip_csum, uint32_t *l4_csum)
+{
+    uint32_t l3 = tc->vlan ? 18 : 14;
+    uint32_t ip_len = tc->ip6 ? 40 + (tc->options ? 8 : 0) : 20 + (tc->options ? 4 : 0);
+    uint32_t l4_hdr = tc->proto == 6 ? 20 : 8;
+    uint32_t l4_len = l4_hdr + payload_len;
+    uint32_t length = l3 + ip_len + l4_len;
+
+    memset(frame, 0, length);
+    memcpy(frame, s_peer_addr, ETH_ADDR_LEN);
+    memcpy(frame + 6, s_dev_addr, ETH_ADDR_LEN);
+    if (tc->vlan) {
+        frame[12] = 0x81;
+        frame[14] = 0x00;
+        frame[15] = 0x05; // VID 5
+    }
+    frame[l3 - 2] = tc->ip6 ? 0x86 : 0x08;
+    frame[l3 - 1] = tc->ip6 ? 0xDD : 0x00;
+    uint8_t *ip = frame + l3;
+    uint8_t *l4 = ip + ip_len;
+    if (tc->ip6) {
+        uint32_t payload = ip_len - 40 + l4_len;
+        ip[0] = 0x60;
+        ip[4] = payload >> 8;
+        ip[5] = payload & 0xFF;
+        ip[6] = tc->options ? 0 : tc->proto;
+        ip[7] = 64;
+        for (int i = 8; i < 40; i++) {
+            ip[i] = test_random();
+        }
+        if (tc->options) {
+            ip[40] = tc->proto;
+            ip[41] = 0;
+            ip[42] = 1; // PadN
+            ip[43] = 4;
+        }
+        *ip_csum = 0;
+    } else {
+        uint32_t tot_len = ip_len + l4_len;
+        ip[0] = 0x40 | (ip_len / 4);
+        ip[2] = tot_len >> 8;
+        ip[3] = tot_len & 0xFF;
+        ip[4] = test_random();
+        ip[5] = test_random();
+        ip[6] = tc->fragment ? 0x20 : 0x40; // MF or DF
+        ip[8] = 64;
+        ip[9] = tc->proto;
+        ip[10] = ip[11] = TEST_GARBAGE;
+        for (int i = 12; i < 20; i++) {
+            ip[i] = test_random();
+        }
+        if (tc->options) {
+            memset(ip + 20, 1, 4); // NOP
+        }
+        *ip_csum = l3 + 10;
+    }
+    l4[0] = test_random();
+    l4[1] = test_random();
+    l4[2] = test_random();
+    l4[3] = test_random();
+    if (tc->proto == 6) {
+        for (int i = 4; i < 12; i++) {
+            l4[i] = test_random();
+        }
+        l4[12] = 0x50;
+        l4[13] = 0x18; // PSH ACK
+        l4[14] = 0x16;
+        l4[15] = 0xD0;
+        *l4_csum = l3 + ip_len + 16;
+    } else {
+        l4[4] = l4_len >> 8;
+        l4[5] = l4_len & 0xFF;
+        *l4_csum = l3 + ip_len + 6;
+    }
+    frame[*l4_csum] = frame[*l4_csum + 1] = TEST_GARBAGE;
+    for (uint32_t i = 0; i < payload_len; i++) {
+        l4[l4_hdr + i] = test_random();
+    }
+    return length;
+}
+
+/**
+ * @brief The frame as it must be on the wire, the checksums computed in software
+ */
+static void test_expected(const test_case_t *tc, uint8_t *frame, uint32_t ip_csum, uint32_t l4_csum)
+{
+    uint32_t l3 = tc->vlan ? 18 : 14;
+    uint8_t *ip = frame + l3;
+    uint32_t sum;
+    uint32_t l4_off = l4_csum - (tc->proto == 6 ? 16 : 6);
+    uint32_t l4_len;
+    if (tc->ip6) {
+        l4_len = ((ip[4] << 8) | ip[5]) + 40 + l3 - l4_off;
+        sum = test_sum(0, ip + 8, 32);
+    } else {
+        uint32_t ihl = (ip[0] & 0x0F) * 4;
+        ip[10] = ip[11] = 0;
+        uint16_t csum = test_fold(test_sum(0, ip, ihl));
+        ip[10] = csum >> 8;
+        ip[11] = csum & 0xFF;
+        if (tc->fragment) {
+            return; // the L4 checksum is left as it is
+        }
+        l4_len = ((ip[2] << 8) | ip[3]) - ihl;
+        sum = test_sum(0, ip + 12, 8);
+    }
+    sum += tc->proto + l4_len;
+    frame[l4_csum] = frame[l4_csum + 1] = 0;
+    uint16_t csum = test_fold(test_sum(sum, frame + l4_off, l4_len));
+    if (tc->proto == 17 && csum == 0) {
+        csum = 0xFFFF;
+    }
+    frame[l4_csum] = csum >> 8;
+    frame[l4_csum + 1] = csum & 0xFF;
+}
+
+static bool test_wait(test_wire_t *wire, uint32_t frames)
+{
+    for (uint32_t waited = 0; waited < TEST_TIMEOUT_MS * 1000; waited += 20) {
+        if (atomic_load(&wire->frames) >= frames) {
+            return true;
+        }
+        test_sleep_us(20);
+    }
+    return false;
+}
+
+/**
+ * @return count of failed frames
+ */
+static uint32_t test_run(bool double_buffer, uint32_t *frames)
+{
+    static const uint32_t payloads[] = { 0, 1, 6, 17, 18, 255, 256, 1001 };
+    test_wire_t *wire = calloc(1, sizeof(test_wire_t));
+    const enc28j60_model_config_t model_config = {
+        .int_gpio_num = TEST_INT_GPIO,
+        .transmit = test_transmit,
+        .transmit_ctx = wire,
+    };
+    enc28j60_model_t *chip = enc28j60_model_new(&model_config);
+    host_spi_t *spi = host_spi_new(chip, test_spi_xfer);
+    eth_enc28j60_config_t enc28j60_config = ETH_ENC28J60_DEFAULT_CONFIG(0, NULL);
+    enc28j60_config.custom_spi_driver = host_spi_driver_config(spi);
+    enc28j60_config.spi_burst.begin = host_spi_burst_begin;
+    enc28j60_config.spi_burst.end = host_spi_burst_end;
+    enc28j60_config.int_gpio_num = TEST_INT_GPIO;
+    enc28j60_config.tx_double_buffer = double_buffer;
+    enc28j60_config.tx_checksum_offload = true;
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    esp_eth_mac_t *mac = esp_eth_mac_new_enc28j60(&enc28j60_config, &mac_config);
+    host_eth_t *eth = mac ? host_eth_new(mac, test_input, NULL, NULL) : NULL;
+    if (!eth || host_eth_start(eth, s_dev_addr) != ESP_OK) {
+        fprintf(stderr, "driver start failed\n");
+        exit(1);
+    }
+
+    const char *mode = double_buffer ? "double_buffer" : "single_buffer";
+    uint32_t failed = 0;
+    uint8_t frame[ETH_MAX_PACKET_SIZE];
+    uint8_t expected[ETH_MAX_PACKET_SIZE];
+    for (size_t c = 0; c < sizeof(s_cases) / sizeof(s_cases[0]); c++) {
+        const test_case_t *tc = &s_cases[c];
+        uint32_t case_failed = failed;
+        uint32_t headers = test_frame(tc, 0, frame, &(uint32_t){0}, &(uint32_t){0});
+        for (size_t p = 0; p <= sizeof(payloads) / sizeof(payloads[0]); p++) {
+            // the last run is a frame of the maximum size
+            uint32_t payload_len = p < sizeof(payloads) / sizeof(payloads[0]) ? payloads[p] : ETH_MAX_PACKET_SIZE - headers;
+            uint32_t ip_csum;
+            uint32_t l4_csum;
+            uint32_t length = test_frame(tc, payload_len, frame, &ip_csum, &l4_csum);
+            memcpy(expected, frame, length);
+            test_expected(tc, expected, ip_csum, l4_csum);
+            (*frames)++;
+            if (host_eth_transmit(eth, frame, length) != ESP_OK || !test_wait(wire, *frames)) {
+                printf("%s,%s,%u,FAIL transmit\n", mode, tc->name, (unsigned)length);
+                failed++;
+                continue;
+            }
+            uint32_t wire_len = length < 60 ? 60 : length;
+            if (wire->length != wire_len || memcmp(wire->frame, expected, length)) {
+                uint32_t at = 0;
+                while (at < length && wire->frame[at] == expected[at]) {
+                    at++;
+                }
+                printf("%s,%s,%u,FAIL at byte %u: 0x%02x expected 0x%02x (IP checksum at %u, L4 checksum at %u)\n",
+                       mode, tc->name, (unsigned)length, (unsigned)at, wire->frame[at], expected[at],
+                       (unsigned)ip_csum, (unsigned)l4_csum);
+                failed++;
+            }
+        }
+        if (failed == case_failed) {
+            printf("%s,%s,ok\n", mode, tc->name);
+        }
+    }
+    host_eth_delete(eth);
+    host_spi_delete(spi);
+    enc28j60_model_delete(chip);
+    free(wire);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            s_seed = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--seed n]\n", argv[0]);
+            return 2;
+        }
+    }
+    uint32_t frames = 0;
+    uint32_t failed = test_run(false, &frames);
+    frames = 0;
+    failed += test_run(true, &frames);
+    printf("%u frames failed\n", (unsigned)failed);
+    return failed ? 1 : 0;
+}
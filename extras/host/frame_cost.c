@@ -0,0 +1,437 @@
+/*
+ * SPI cost per frame of the MAC drivers, measured on the host against the chip models.
+ *
+ * Every configuration transmits and receives frames of the minimum size (60 bytes, 64 with
+ * the FCS) and of the maximum size (1514 bytes) through the driver's transmit function and
+ * RX task. The chip model counts the SPI transactions and bytes, so the cost contains the
+ * interrupt handling of every frame. rx_burst receives frames which arrive together and are
+ * read in one interrupt. replay_bulk replays the frames of a bulk TCP download, two full size
+ * segments and one ACK. The SPI time is estimated from the bytes at the SPI clock and a fixed
+ * overhead per transaction.
+ *
+ * usage: frame_cost [--frames n] [--spi-mhz f] [--transaction-us t]
+ */
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_eth.h"
+#include "esp_eth_enc28j60.h"
+#include "host_eth.h"
+#include "host_spi.h"
+#include "enc28j60_model.h"
+#include "esp_eth_mac_w5500.h"
+#include "w5500_model.h"
+
+#define BENCH_INT_GPIO (4)
+#define BENCH_RX_BURST (3)          // 3 frames of 1514 bytes fit in the RX buffer of every buffer layout
+#define BENCH_TIMEOUT_MS (2000)
+
+typedef struct {
+    uint32_t transactions;
+    uint64_t bytes;
+} bench_spi_count_t;
+
+typedef struct bench_dev bench_dev_t;
+
+struct bench_dev {
+    esp_eth_mac_t *mac;
+    host_eth_t *eth;
+    atomic_uint rx_frames;
+    void *chip;
+    host_spi_t *spi;
+    void (*spi_count)(void *chip, bench_spi_count_t *count);
+    uint32_t (*tx_frames)(void *chip);
+    bool (*idle)(void *chip);
+    bool (*receive)(void *chip, const uint8_t *frame, uint32_t length);
+    void (*check)(bench_dev_t *dev);
+    void (*chip_delete)(void *chip);
+};
+
+typedef struct {
+    const char *chip;
+    const char *name;
+    bench_dev_t *(*create)(bool option_a, bool option_b);
+    bool option_a;
+    bool option_b;
+} bench_config_t;
+
+static const uint8_t s_dev_addr[ETH_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t s_peer_addr[ETH_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+static void bench_sleep_us(uint32_t us)
+{
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+static void bench_input(void *ctx, const uint8_t *frame, uint32_t length)
+{
+    (void)frame;
+    (void)length;
+    atomic_fetch_add(&((bench_dev_t *)ctx)->rx_frames, 1);
+}
+
+/**
+ * @brief IPv4 UDP frame of length bytes without FCS, so the checksum offload has work
+ */
+static void bench_udp_frame(uint8_t *frame, uint32_t length, const uint8_t *dest, const uint8_t *src)
+{
+    memset(frame, 0, length);
+    memcpy(frame, dest, ETH_ADDR_LEN);
+    memcpy(frame + 6, src, ETH_ADDR_LEN);
+    frame[12] = 0x08; // IPv4
+    uint8_t *ip = frame + 14;
+    uint16_t ip_len = length - 14;
+    ip[0] = 0x45;
+    ip[2] = ip_len >> 8;
+    ip[3] = ip_len & 0xFF;
+    ip[8] = 64;
+    ip[9] = 17; // UDP
+    memcpy(ip + 12, "\xc0\xa8\x01\x02\xc0\xa8\x01\x01", 8);
+    uint8_t *udp = ip + 20;
+    uint16_t udp_len = ip_len - 20;
+    udp[0] = 0x30;
+    udp[1] = 0x39;
+    udp[2] = 0x30;
+    udp[3] = 0x39;
+    udp[4] = udp_len >> 8;
+    udp[5] = udp_len & 0xFF;
+    for (uint32_t i = 42; i < length; i++) {
+        frame[i] = i & 0xFF;
+    }
+}
+
+/**
+ * @brief Wait until the device received rx_frames, transmitted tx_frames and the chip is idle
+ */
+static bool bench_wait(bench_dev_t *dev, uint32_t rx_frames, uint32_t tx_frames)
+{
+    for (uint32_t waited = 0; waited < BENCH_TIMEOUT_MS * 1000; waited += 20) {
+        if (atomic_load(&dev->rx_frames) >= rx_frames && dev->tx_frames(dev->chip) >= tx_frames && dev->idle(dev->chip)) {
+            return true;
+        }
+        bench_sleep_us(20);
+    }
+    return false;
+}
+
+static esp_err_t bench_enc28j60_xfer(void *chip, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len)
+{
+    return enc28j60_model_spi((enc28j60_model_t *)chip, write, cmd, addr, data, len);
+}
+
+static void bench_enc28j60_spi_count(void *chip, bench_spi_count_t *count)
+{
+    enc28j60_model_stats_t stats;
+    enc28j60_model_get_stats((enc28j60_model_t *)chip, &stats);
+    count->transactions = stats.spi_transactions;
+    count->bytes = stats.spi_bytes;
+}
+
+static uint32_t bench_enc28j60_tx_frames(void *chip)
+{
+    enc28j60_model_stats_t stats;
+    enc28j60_model_get_stats((enc28j60_model_t *)chip, &stats);
+    return stats.tx_frames;
+}
+
+static bool bench_enc28j60_idle(void *chip)
+{
+    return enc28j60_model_idle((enc28j60_model_t *)chip);
+}
+
+static bool bench_enc28j60_receive(void *chip, const uint8_t *frame, uint32_t length)
+{
+    return enc28j60_model_receive((enc28j60_model_t *)chip, frame, length);
+}
+
+static void bench_enc28j60_check(bench_dev_t *dev)
+{
+    enc28j60_model_stats_t stats;
+    eth_enc28j60_stats_t driver_stats;
+    enc28j60_model_get_stats((enc28j60_model_t *)dev->chip, &stats);
+    emac_enc28j60_get_stats(dev->mac, &driver_stats);
+    if (driver_stats.spi_transactions != stats.spi_transactions || driver_stats.spi_bytes != stats.spi_bytes) {
+        fprintf(stderr, "enc28j60: driver counted %u transactions and %llu bytes, the chip %u and %llu\n",
+                (unsigned)driver_stats.spi_transactions, (unsigned long long)driver_stats.spi_bytes,
+                (unsigned)stats.spi_transactions, (unsigned long long)stats.spi_bytes);
+    }
+    if (stats.invalid_accesses || stats.even_erxrdpt || stats.rx_overflows) {
+        fprintf(stderr, "enc28j60: %u invalid accesses, %u even ERXRDPT, %u RX overflows\n",
+                (unsigned)stats.invalid_accesses, (unsigned)stats.even_erxrdpt, (unsigned)stats.rx_overflows);
+    }
+}
+
+static void bench_enc28j60_chip_delete(void *chip)
+{
+    enc28j60_model_delete((enc28j60_model_t *)chip);
+}
+
+/**
+ * @param double_buffer tx_double_buffer of the driver
+ * @param offload tx_checksum_offload of the driver
+ */
+static bench_dev_t *bench_enc28j60_create(bool double_buffer, bool offload)
+{
+    bench_dev_t *dev = calloc(1, sizeof(bench_dev_t));
+    if (!dev) {
+        return NULL;
+    }
+    const enc28j60_model_config_t model_config = {
+        .int_gpio_num = BENCH_INT_GPIO,
+    };
+    dev->chip = enc28j60_model_new(&model_config);
+    dev->spi = host_spi_new(dev->chip, bench_enc28j60_xfer);
+    dev->spi_count = bench_enc28j60_spi_count;
+    dev->tx_frames = bench_enc28j60_tx_frames;
+    dev->idle = bench_enc28j60_idle;
+    dev->receive = bench_enc28j60_receive;
+    dev->check = bench_enc28j60_check;
+    dev->chip_delete = bench_enc28j60_chip_delete;
+
+    eth_enc28j60_config_t enc28j60_config = ETH_ENC28J60_DEFAULT_CONFIG(0, NULL);
+    enc28j60_config.custom_spi_driver = host_spi_driver_config(dev->spi);
+    enc28j60_config.spi_burst.begin = host_spi_burst_begin;
+    enc28j60_config.spi_burst.end = host_spi_burst_end;
+    enc28j60_config.int_gpio_num = BENCH_INT_GPIO;
+    enc28j60_config.tx_double_buffer = double_buffer;
+    enc28j60_config.tx_checksum_offload = offload;
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    dev->mac = esp_eth_mac_new_enc28j60(&enc28j60_config, &mac_config);
+    if (!dev->mac) {
+        host_spi_delete(dev->spi);
+        enc28j60_model_delete(dev->chip);
+        free(dev);
+        return NULL;
+    }
+    dev->eth = host_eth_new(dev->mac, bench_input, dev, NULL);
+    return dev;
+}
+
+static esp_err_t bench_w5500_xfer(void *chip, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len)
+{
+    return w5500_model_spi((w5500_model_t *)chip, write, cmd, addr, data, len);
+}
+
+static void bench_w5500_spi_count(void *chip, bench_spi_count_t *count)
+{
+    w5500_model_stats_t stats;
+    w5500_model_get_stats((w5500_model_t *)chip, &stats);
+    count->transactions = stats.spi_transactions;
+    count->bytes = stats.spi_bytes;
+}
+
+static uint32_t bench_w5500_tx_frames(void *chip)
+{
+    w5500_model_stats_t stats;
+    w5500_model_get_stats((w5500_model_t *)chip, &stats);
+    return stats.tx_frames;
+}
+
+static bool bench_w5500_idle(void *chip)
+{
+    return w5500_model_idle((w5500_model_t *)chip);
+}
+
+static bool bench_w5500_receive(void *chip, const uint8_t *frame, uint32_t length)
+{
+    return w5500_model_receive((w5500_model_t *)chip, frame, length);
+}
+
+static void bench_w5500_check(bench_dev_t *dev)
+{
+    w5500_model_stats_t stats;
+    w5500_model_get_stats((w5500_model_t *)dev->chip, &stats);
+    if (stats.invalid_accesses || stats.rx_overflows) {
+        fprintf(stderr, "w5500: %u invalid accesses, %u RX overflows\n",
+                (unsigned)stats.invalid_accesses, (unsigned)stats.rx_overflows);
+    }
+}
+
+static void bench_w5500_chip_delete(void *chip)
+{
+    w5500_model_delete((w5500_model_t *)chip);
+}
+
+/**
+ * @brief W5500 with the replica of the IDF driver, which has no options
+ */
+static bench_dev_t *bench_w5500_create(bool unused_a, bool unused_b)
+{
+    bench_dev_t *dev = calloc(1, sizeof(bench_dev_t));
+    if (!dev) {
+        return NULL;
+    }
+    const w5500_model_config_t model_config = {
+        .int_gpio_num = BENCH_INT_GPIO,
+    };
+    dev->chip = w5500_model_new(&model_config);
+    dev->spi = host_spi_new(dev->chip, bench_w5500_xfer);
+    dev->spi_count = bench_w5500_spi_count;
+    dev->tx_frames = bench_w5500_tx_frames;
+    dev->idle = bench_w5500_idle;
+    dev->receive = bench_w5500_receive;
+    dev->check = bench_w5500_check;
+    dev->chip_delete = bench_w5500_chip_delete;
+
+    eth_w5500_config_t w5500_config = ETH_W5500_DEFAULT_CONFIG();
+    w5500_config.custom_spi_driver = host_spi_driver_config(dev->spi);
+    w5500_config.int_gpio_num = BENCH_INT_GPIO;
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    dev->mac = esp_eth_mac_new_w5500(&w5500_config, &mac_config);
+    if (!dev->mac) {
+        host_spi_delete(dev->spi);
+        w5500_model_delete(dev->chip);
+        free(dev);
+        return NULL;
+    }
+    dev->eth = host_eth_new(dev->mac, bench_input, dev, NULL);
+    return dev;
+}
+
+static void bench_dev_delete(bench_dev_t *dev)
+{
+    host_eth_delete(dev->eth);
+    host_spi_delete(dev->spi);
+    dev->chip_delete(dev->chip);
+    free(dev);
+}
+
+static const bench_config_t s_configs[] = {
+    { "enc28j60", "single_buffer", bench_enc28j60_create, false, false },
+    { "enc28j60", "single_buffer_csum_offload", bench_enc28j60_create, false, true },
+    { "enc28j60", "double_buffer", bench_enc28j60_create, true, false },
+    { "enc28j60", "double_buffer_csum_offload", bench_enc28j60_create, true, true },
+    { "w5500", "idf_driver", bench_w5500_create, false, false },
+};
+
+/**
+ * @param frame_bytes bytes of all measured frames, for the ratio of frame bytes to SPI bytes
+ */
+static void bench_print(const bench_config_t *config, const char *direction, const char *frame_size, uint32_t frames,
+                        uint64_t frame_bytes, const bench_spi_count_t *before, const bench_spi_count_t *after,
+                        double spi_mhz, double transaction_us)
+{
+    double transactions = (double)(after->transactions - before->transactions) / frames;
+    double bytes = (double)(after->bytes - before->bytes) / frames;
+    double spi_us = bytes * 8 / spi_mhz + transactions * transaction_us;
+    printf("%s,%s,%s,%s,%u,%.1f,%.1f,%.1f,%.3f\n", config->chip, config->name, direction, frame_size,
+           (unsigned)frames, transactions, bytes, spi_us, frame_bytes / (bytes * frames));
+}
+
+static bool bench_run(const bench_config_t *config, uint32_t frames, double spi_mhz, double transaction_us)
+{
+    static const uint32_t sizes[] = { 60, 1514 };
+    uint8_t frame[1514];
+    bench_spi_count_t before;
+    bench_spi_count_t after;
+    bench_dev_t *dev = config->create(config->option_a, config->option_b);
+    if (!dev) {
+        fprintf(stderr, "%s %s: create failed\n", config->chip, config->name);
+        return false;
+    }
+    bool ok = host_eth_start(dev->eth, s_dev_addr) == ESP_OK && bench_wait(dev, 0, 0);
+    for (size_t s = 0; ok && s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t size = sizes[s];
+        char size_label[8];
+        snprintf(size_label, sizeof(size_label), "%u", (unsigned)size);
+        // transmit
+        bench_udp_frame(frame, size, s_peer_addr, s_dev_addr);
+        uint32_t tx_start = dev->tx_frames(dev->chip);
+        dev->spi_count(dev->chip, &before);
+        for (uint32_t i = 0; ok && i < frames; i++) {
+            ok = host_eth_transmit(dev->eth, frame, size) == ESP_OK;
+        }
+        ok = ok && bench_wait(dev, 0, tx_start + frames);
+        dev->spi_count(dev->chip, &after);
+        if (ok) {
+            bench_print(config, "tx", size_label, frames, (uint64_t)size * frames, &before, &after, spi_mhz, transaction_us);
+        }
+        // receive, one frame per interrupt
+        bench_udp_frame(frame, size, s_dev_addr, s_peer_addr);
+        uint32_t rx_start = atomic_load(&dev->rx_frames);
+        dev->spi_count(dev->chip, &before);
+        for (uint32_t i = 0; ok && i < frames; i++) {
+            ok = dev->receive(dev->chip, frame, size) && bench_wait(dev, rx_start + i + 1, 0);
+        }
+        dev->spi_count(dev->chip, &after);
+        if (ok) {
+            bench_print(config, "rx", size_label, frames, (uint64_t)size * frames, &before, &after, spi_mhz, transaction_us);
+        }
+        // receive, BENCH_RX_BURST frames arriving together
+        uint32_t bursts = (frames + BENCH_RX_BURST - 1) / BENCH_RX_BURST;
+        rx_start = atomic_load(&dev->rx_frames);
+        dev->spi_count(dev->chip, &before);
+        for (uint32_t i = 0; ok && i < bursts; i++) {
+            // keep the bus, so the RX task finds all frames of the burst on its first look
+            host_spi_burst_begin(dev->spi);
+            for (uint32_t j = 0; ok && j < BENCH_RX_BURST; j++) {
+                ok = dev->receive(dev->chip, frame, size);
+            }
+            host_spi_burst_end(dev->spi);
+            ok = ok && bench_wait(dev, rx_start + (i + 1) * BENCH_RX_BURST, 0);
+        }
+        dev->spi_count(dev->chip, &after);
+        if (ok) {
+            bench_print(config, "rx_burst", size_label, bursts * BENCH_RX_BURST,
+                        (uint64_t)size * bursts * BENCH_RX_BURST, &before, &after, spi_mhz, transaction_us);
+        }
+    }
+    // replay of a bulk TCP download: two full size segments arrive together, one ACK is sent
+    uint8_t ack[60];
+    bench_udp_frame(frame, 1514, s_dev_addr, s_peer_addr);
+    bench_udp_frame(ack, sizeof(ack), s_peer_addr, s_dev_addr);
+    uint32_t cycles = (frames + 2) / 3;
+    uint32_t rx_start = atomic_load(&dev->rx_frames);
+    uint32_t tx_start = dev->tx_frames(dev->chip);
+    dev->spi_count(dev->chip, &before);
+    for (uint32_t i = 0; ok && i < cycles; i++) {
+        host_spi_burst_begin(dev->spi);
+        ok = dev->receive(dev->chip, frame, 1514) && dev->receive(dev->chip, frame, 1514);
+        host_spi_burst_end(dev->spi);
+        ok = ok && bench_wait(dev, rx_start + (i + 1) * 2, 0);
+        ok = ok && host_eth_transmit(dev->eth, ack, sizeof(ack)) == ESP_OK && bench_wait(dev, 0, tx_start + i + 1);
+    }
+    dev->spi_count(dev->chip, &after);
+    if (ok) {
+        bench_print(config, "replay_bulk", "2x1514+60", cycles * 3, (uint64_t)(2 * 1514 + 60) * cycles,
+                    &before, &after, spi_mhz, transaction_us);
+    }
+    if (!ok) {
+        fprintf(stderr, "%s %s: frames lost or timed out\n", config->chip, config->name);
+    }
+    dev->check(dev);
+    bench_dev_delete(dev);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t frames = 200;
+    double spi_mhz = 20;
+    double transaction_us = 2;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--spi-mhz") && i + 1 < argc) {
+            spi_mhz = strtod(argv[++i], NULL);
+        } else if (!strcmp(argv[i], "--transaction-us") && i + 1 < argc) {
+            transaction_us = strtod(argv[++i], NULL);
+        } else {
+            fprintf(stderr, "usage: %s [--frames n] [--spi-mhz f] [--transaction-us t]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames == 0 || spi_mhz <= 0) {
+        fprintf(stderr, "frames and spi-mhz must be positive\n");
+        return 2;
+    }
+    printf("chip,config,direction,frame_size,frames,transactions,bytes,spi_us,efficiency\n");
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(s_configs) / sizeof(s_configs[0]); i++) {
+        ok &= bench_run(&s_configs[i], frames, spi_mhz, transaction_us);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+/*
+ * Minimal esp_eth glue of the host build, see host_eth.h.
+ */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_eth.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "host_eth.h"
+
+static const char *TAG = "host_eth";
+
+typedef struct host_eth_frame {
+    struct host_eth_frame *next;
+    uint8_t *buffer;
+    uint32_t length;
+} host_eth_frame_t;
+
+struct host_eth {
+    esp_eth_mediator_t mediator;
+    esp_eth_mac_t *mac;
+    host_eth_input_t input;
+    void *ctx;
+    host_eth_free_rx_t free_rx;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    host_eth_frame_t *head;
+    host_eth_frame_t *tail;
+    bool stop;
+    bool started;
+};
+
+static void host_eth_free_buffer(host_eth_t *eth, uint8_t *buffer)
+{
+    if (eth->free_rx) {
+        eth->free_rx(eth->mac, buffer);
+    } else {
+        free(buffer);
+    }
+}
+
+static esp_err_t host_eth_phy_reg_read(esp_eth_mediator_t *mediator, uint32_t phy_addr, uint32_t phy_reg, uint32_t *reg_value)
+{
+    host_eth_t *eth = __containerof(mediator, host_eth_t, mediator);
+    return eth->mac->read_phy_reg(eth->mac, phy_addr, phy_reg, reg_value);
+}
+
+static esp_err_t host_eth_phy_reg_write(esp_eth_mediator_t *mediator, uint32_t phy_addr, uint32_t phy_reg, uint32_t reg_value)
+{
+    host_eth_t *eth = __containerof(mediator, host_eth_t, mediator);
+    return eth->mac->write_phy_reg(eth->mac, phy_addr, phy_reg, reg_value);
+}
+
+static esp_err_t host_eth_stack_input(esp_eth_mediator_t *mediator, uint8_t *buffer, uint32_t length)
+{
+    host_eth_t *eth = __containerof(mediator, host_eth_t, mediator);
+    host_eth_frame_t *frame = malloc(sizeof(host_eth_frame_t));
+    if (!frame) {
+        host_eth_free_buffer(eth, buffer);
+        return ESP_ERR_NO_MEM;
+    }
+    frame->next = NULL;
+    frame->buffer = buffer;
+    frame->length = length;
+    pthread_mutex_lock(&eth->lock);
+    if (eth->tail) {
+        eth->tail->next = frame;
+    } else {
+        eth->head = frame;
+    }
+    eth->tail = frame;
+    pthread_cond_signal(&eth->cond);
+    pthread_mutex_unlock(&eth->lock);
+    return ESP_OK;
+}
+
+static esp_err_t host_eth_on_state_changed(esp_eth_mediator_t *mediator, esp_eth_state_t state, void *args)
+{
+    (void)mediator;
+    (void)state;
+    (void)args;
+    return ESP_OK;
+}
+
+static void *host_eth_stack_thread(void *arg)
+{
+    host_eth_t *eth = (host_eth_t *)arg;
+    pthread_mutex_lock(&eth->lock);
+    while (!eth->stop) {
+        host_eth_frame_t *frame = eth->head;
+        if (!frame) {
+            pthread_cond_wait(&eth->cond, &eth->lock);
+            continue;
+        }
+        eth->head = frame->next;
+        if (!eth->head) {
+            eth->tail = NULL;
+        }
+        pthread_mutex_unlock(&eth->lock);
+        if (eth->input) {
+            eth->input(eth->ctx, frame->buffer, frame->length);
+        }
+        host_eth_free_buffer(eth, frame->buffer);
+        free(frame);
+        pthread_mutex_lock(&eth->lock);
+    }
+    pthread_mutex_unlock(&eth->lock);
+    return NULL;
+}
+
+host_eth_t *host_eth_new(esp_eth_mac_t *mac, host_eth_input_t input, void *ctx, host_eth_free_rx_t free_rx)
+{
+    host_eth_t *eth = calloc(1, sizeof(host_eth_t));
+    if (!eth) {
+        return NULL;
+    }
+    eth->mediator.phy_reg_read = host_eth_phy_reg_read;
+    eth->mediator.phy_reg_write = host_eth_phy_reg_write;
+    eth->mediator.stack_input = host_eth_stack_input;
+    eth->mediator.on_state_changed = host_eth_on_state_changed;
+    eth->mac = mac;
+    eth->input = input;
+    eth->ctx = ctx;
+    eth->free_rx = free_rx;
+    pthread_mutex_init(&eth->lock, NULL);
+    pthread_cond_init(&eth->cond, NULL);
+    if (pthread_create(&eth->thread, NULL, host_eth_stack_thread, eth) != 0) {
+        pthread_mutex_destroy(&eth->lock);
+        pthread_cond_destroy(&eth->cond);
+        free(eth);
+        return NULL;
+    }
+    mac->set_mediator(mac, &eth->mediator);
+    return eth;
+}
+
+esp_err_t host_eth_start(host_eth_t *eth, const uint8_t *addr)
+{
+    esp_eth_mac_t *mac = eth->mac;
+    uint8_t mac_addr[ETH_ADDR_LEN];
+    memcpy(mac_addr, addr, ETH_ADDR_LEN);
+    ESP_RETURN_ON_ERROR(mac->init(mac), TAG, "init failed");
+    eth->started = true;
+    ESP_RETURN_ON_ERROR(mac->set_addr(mac, mac_addr), TAG, "set address failed");
+    ESP_RETURN_ON_ERROR(mac->set_speed(mac, ETH_SPEED_10M), TAG, "set speed failed");
+    ESP_RETURN_ON_ERROR(mac->set_duplex(mac, ETH_DUPLEX_FULL), TAG, "set duplex failed");
+    ESP_RETURN_ON_ERROR(mac->set_link(mac, ETH_LINK_UP), TAG, "link up failed");
+    return ESP_OK;
+}
+
+esp_err_t host_eth_transmit(host_eth_t *eth, const uint8_t *frame, uint32_t length)
+{
+    // the drivers don't modify the frame, the signature predates const
+    return eth->mac->transmit(eth->mac, (uint8_t *)frame, length);
+}
+
+void host_eth_delete(host_eth_t *eth)
+{
+    if (eth->started) {
+        eth->mac->deinit(eth->mac);
+    }
+    eth->mac->del(eth->mac);
+    pthread_mutex_lock(&eth->lock);
+    eth->stop = true;
+    pthread_cond_signal(&eth->cond);
+    pthread_mutex_unlock(&eth->lock);
+    pthread_join(eth->thread, NULL);
+    // frames the stack thread didn't process
+    while (eth->head) {
+        host_eth_frame_t *frame = eth->head;
+        eth->head = frame->next;
+        host_eth_free_buffer(eth, frame->buffer);
+        free(frame);
+    }
+    pthread_mutex_destroy(&eth->lock);
+    pthread_cond_destroy(&eth->cond);
+    free(eth);
+}
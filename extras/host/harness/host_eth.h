@@ -0,0 +1,50 @@
+/*
+ * Minimal esp_eth glue of the host build: the mediator of a MAC driver and a stack thread.
+ *
+ * Received frames are queued by the driver's RX task and handed to the input callback in the
+ * stack thread, like lwIP's tcpip thread does on the target. The callback may transmit.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_eth_mac.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_eth host_eth_t;
+
+/**
+ * @brief Received frame, the buffer is freed after the call
+ */
+typedef void (*host_eth_input_t)(void *ctx, const uint8_t *frame, uint32_t length);
+
+/**
+ * @brief Free function of the RX buffers, signature of esp_netif_driver_ifconfig_t.driver_free_rx_buffer
+ */
+typedef void (*host_eth_free_rx_t)(void *h, void *buffer);
+
+/**
+ * @brief Attach to a MAC instance
+ *
+ * @param free_rx free function of the driver's RX buffers, NULL for free()
+ */
+host_eth_t *host_eth_new(esp_eth_mac_t *mac, host_eth_input_t input, void *ctx, host_eth_free_rx_t free_rx);
+
+/**
+ * @brief Init the MAC, set the address and bring the link up at 10 Mbps full duplex
+ */
+esp_err_t host_eth_start(host_eth_t *eth, const uint8_t *addr);
+
+esp_err_t host_eth_transmit(host_eth_t *eth, const uint8_t *frame, uint32_t length);
+
+/**
+ * @brief Deinit and delete the MAC, then stop the stack thread
+ */
+void host_eth_delete(host_eth_t *eth);
+
+#ifdef __cplusplus
+}
+#endif
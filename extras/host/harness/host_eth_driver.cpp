@@ -0,0 +1,59 @@
+/*
+ * Out-of-line parts of EthDriver.cpp for the host build of the SPI access path.
+ *
+ * eth_spi_read and eth_spi_write are the ones of EthDriver.cpp. spiTransfer only copies the
+ * data from and to a register file, so a bench measures the calls and not the SPI bus. Like on
+ * the target, they are in a translation unit of their own, so the compiler can't inline them
+ * into the driver class or devirtualize the read and write calls.
+ */
+#include <string.h>
+#include "EthDriver.h"
+
+SPIClass SPI;
+
+static uint8_t s_registers[256];
+
+EthDriver::~EthDriver() {
+}
+
+uint32_t EthDriver::rxTaskStackHighWaterMark() {
+  return 0;
+}
+
+size_t EthDriver::printInfo(Print &out) {
+  return 0;
+}
+
+bool EthDriver::addMacFilter(const uint8_t *addr) {
+  return false;
+}
+
+bool EthDriver::removeMacFilter(const uint8_t *addr) {
+  return false;
+}
+
+size_t EthSpiDriver::printInfo(Print &out) {
+  return 0;
+}
+
+void EthSpiDriver::spiTransfer(const uint8_t *header, uint8_t headerLen, uint8_t *rxData, const uint8_t *txData, uint32_t dataLen) {
+  uint8_t reg = header[headerLen - 1];
+  if (dataLen > sizeof(s_registers) - reg) {
+    dataLen = sizeof(s_registers) - reg;
+  }
+  if (rxData) {
+    memcpy(rxData, s_registers + reg, dataLen);
+  } else {
+    memcpy(s_registers + reg, txData, dataLen);
+  }
+  spiAccesses++;
+  spiBits += (headerLen + dataLen) * 8;
+}
+
+esp_err_t eth_spi_read(void *ctx, uint32_t cmd, uint32_t addr, void *data, uint32_t data_len) {
+  return ((EthSpiDriver*) ctx)->read(cmd, addr, data, data_len);
+}
+
+esp_err_t eth_spi_write(void *ctx, uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len) {
+  return ((EthSpiDriver*) ctx)->write(cmd, addr, data, data_len);
+}
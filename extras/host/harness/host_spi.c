@@ -0,0 +1,130 @@
+/*
+ * SPI bus of the host build, see host_spi.h.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "host_spi.h"
+
+#define HOST_SPI_SLEEP_MIN_NS (50000)
+
+struct host_spi {
+    pthread_mutex_t bus_lock;   /*!< recursive, a burst keeps it across transactions */
+    void *chip;
+    host_spi_xfer_t xfer;
+    host_spi_timing_t timing;
+    int64_t debt_ns;            /*!< bus time not slept yet, negative after a longer sleep */
+};
+
+static int64_t host_spi_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Account the bus time of a transaction, called with the bus taken
+ */
+static void host_spi_bus_time(host_spi_t *spi, uint32_t len)
+{
+    if (!spi->timing.clock_hz) {
+        return;
+    }
+    uint64_t bits = (uint64_t)(spi->timing.header_bytes + len) * 8;
+    spi->debt_ns += spi->timing.transaction_ns + bits * 1000000000 / spi->timing.clock_hz;
+    if (spi->debt_ns >= HOST_SPI_SLEEP_MIN_NS) {
+        int64_t start = host_spi_now_ns();
+        struct timespec ts = { .tv_sec = spi->debt_ns / 1000000000, .tv_nsec = spi->debt_ns % 1000000000 };
+        nanosleep(&ts, NULL);
+        spi->debt_ns -= host_spi_now_ns() - start;
+        if (spi->debt_ns < -HOST_SPI_SLEEP_MIN_NS) {
+            spi->debt_ns = -HOST_SPI_SLEEP_MIN_NS; // don't bank a long oversleep, e.g. a preemption
+        }
+    }
+}
+
+host_spi_t *host_spi_new(void *chip, host_spi_xfer_t xfer)
+{
+    host_spi_t *spi = calloc(1, sizeof(host_spi_t));
+    if (!spi) {
+        return NULL;
+    }
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&spi->bus_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    spi->chip = chip;
+    spi->xfer = xfer;
+    return spi;
+}
+
+void host_spi_set_timing(host_spi_t *spi, const host_spi_timing_t *timing)
+{
+    pthread_mutex_lock(&spi->bus_lock);
+    spi->timing = *timing;
+    spi->debt_ns = 0;
+    pthread_mutex_unlock(&spi->bus_lock);
+}
+
+void host_spi_delete(host_spi_t *spi)
+{
+    if (spi) {
+        pthread_mutex_destroy(&spi->bus_lock);
+        free(spi);
+    }
+}
+
+static void *host_spi_init(const void *spi_config)
+{
+    return (void *)spi_config;
+}
+
+static esp_err_t host_spi_deinit(void *spi_ctx)
+{
+    (void)spi_ctx;
+    return ESP_OK; // the bus belongs to the harness
+}
+
+static esp_err_t host_spi_transfer(host_spi_t *spi, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len)
+{
+    pthread_mutex_lock(&spi->bus_lock);
+    esp_err_t ret = spi->xfer(spi->chip, write, cmd, addr, data, len);
+    host_spi_bus_time(spi, len);
+    pthread_mutex_unlock(&spi->bus_lock);
+    return ret;
+}
+
+static esp_err_t host_spi_read(void *spi_ctx, uint32_t cmd, uint32_t addr, void *data, uint32_t data_len)
+{
+    return host_spi_transfer((host_spi_t *)spi_ctx, false, cmd, addr, (uint8_t *)data, data_len);
+}
+
+static esp_err_t host_spi_write(void *spi_ctx, uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len)
+{
+    // the chip models don't modify the data of a write
+    return host_spi_transfer((host_spi_t *)spi_ctx, true, cmd, addr, (uint8_t *)data, data_len);
+}
+
+eth_spi_custom_driver_config_t host_spi_driver_config(host_spi_t *spi)
+{
+    eth_spi_custom_driver_config_t config = {
+        .config = spi,
+        .init = host_spi_init,
+        .deinit = host_spi_deinit,
+        .read = host_spi_read,
+        .write = host_spi_write,
+    };
+    return config;
+}
+
+void host_spi_burst_begin(void *spi_ctx)
+{
+    pthread_mutex_lock(&((host_spi_t *)spi_ctx)->bus_lock);
+}
+
+void host_spi_burst_end(void *spi_ctx)
+{
+    pthread_mutex_unlock(&((host_spi_t *)spi_ctx)->bus_lock);
+}
@@ -0,0 +1,57 @@
+/*
+ * SPI bus of the host build. Implements the custom SPI driver hooks of the Ethernet drivers
+ * on top of a chip model and the burst hooks which keep the bus for a sequence of accesses.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_eth_mac.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_spi host_spi_t;
+
+/**
+ * @brief One SPI transaction of the chip, cmd and addr as passed to the custom SPI hooks
+ */
+typedef esp_err_t (*host_spi_xfer_t)(void *chip, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len);
+
+/**
+ * @brief Time the transactions take on the bus
+ */
+typedef struct {
+    uint32_t clock_hz;          /*!< SPI clock, 0 for transactions without time */
+    uint32_t transaction_ns;    /*!< Overhead of a transaction: CS, the SPI driver and the peripheral setup */
+    uint32_t header_bytes;      /*!< Bytes of command and address of a transaction */
+} host_spi_timing_t;
+
+host_spi_t *host_spi_new(void *chip, host_spi_xfer_t xfer);
+
+/**
+ * @brief Emulate the time of the transactions
+ *
+ * The time is added up and slept with the bus taken when it reaches 50 us, so a sequence of
+ * short transactions takes the right time without a sleep for each of them.
+ */
+void host_spi_set_timing(host_spi_t *spi, const host_spi_timing_t *timing);
+
+void host_spi_delete(host_spi_t *spi);
+
+/**
+ * @brief Custom SPI driver hooks for the driver configuration, deinit doesn't delete the bus
+ */
+eth_spi_custom_driver_config_t host_spi_driver_config(host_spi_t *spi);
+
+/**
+ * @brief Burst hooks, the bus is kept by the calling thread until the matching end
+ */
+void host_spi_burst_begin(void *spi_ctx);
+void host_spi_burst_end(void *spi_ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Virtual wire of the host build, see host_wire.h.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "host_wire.h"
+
+#define WIRE_OVERHEAD_BYTES (8 + 4 + 12) // preamble with SFD, FCS and the inter-frame gap
+#define WIRE_MIN_FRAME (60)
+
+typedef struct host_wire_frame {
+    struct host_wire_frame *next;
+    int64_t arrival_ns;
+    int end;                            /*!< receiving end */
+    uint32_t length;
+    uint8_t data[];
+} host_wire_frame_t;
+
+typedef struct {
+    host_wire_rx_t rx;
+    void *ctx;
+    int64_t busy_until_ns;              /*!< the sending direction from this end is busy until */
+    host_wire_stats_t stats;
+} host_wire_end_t;
+
+struct host_wire {
+    host_wire_config_t config;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    host_wire_frame_t *head;            /*!< frames in flight, by arrival time */
+    host_wire_end_t ends[2];
+    unsigned int random;
+    bool stop;
+};
+
+static int64_t wire_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void *wire_thread(void *arg)
+{
+    host_wire_t *wire = (host_wire_t *)arg;
+    pthread_mutex_lock(&wire->lock);
+    while (!wire->stop) {
+        host_wire_frame_t *frame = wire->head;
+        if (!frame) {
+            pthread_cond_wait(&wire->cond, &wire->lock);
+            continue;
+        }
+        if (frame->arrival_ns > wire_now_ns()) {
+            struct timespec ts = {
+                .tv_sec = frame->arrival_ns / 1000000000,
+                .tv_nsec = frame->arrival_ns % 1000000000,
+            };
+            pthread_cond_timedwait(&wire->cond, &wire->lock, &ts);
+            continue; // a frame with an earlier arrival may have been queued
+        }
+        wire->head = frame->next;
+        host_wire_end_t *end = &wire->ends[frame->end];
+        host_wire_rx_t rx = end->rx;
+        void *ctx = end->ctx;
+        // the receiver may send, e.g. a chip which sets its interrupt, so deliver without the lock
+        pthread_mutex_unlock(&wire->lock);
+        bool stored = rx ? rx(ctx, frame->data, frame->length) : false;
+        pthread_mutex_lock(&wire->lock);
+        if (!stored) {
+            end->stats.dropped++;
+        }
+        free(frame);
+    }
+    pthread_mutex_unlock(&wire->lock);
+    return NULL;
+}
+
+host_wire_t *host_wire_new(const host_wire_config_t *config)
+{
+    host_wire_t *wire = calloc(1, sizeof(host_wire_t));
+    if (!wire || !config->bandwidth_kbps) {
+        free(wire);
+        return NULL;
+    }
+    wire->config = *config;
+    wire->random = config->seed;
+    pthread_mutex_init(&wire->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wire->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&wire->thread, NULL, wire_thread, wire) != 0) {
+        pthread_mutex_destroy(&wire->lock);
+        pthread_cond_destroy(&wire->cond);
+        free(wire);
+        return NULL;
+    }
+    return wire;
+}
+
+void host_wire_delete(host_wire_t *wire)
+{
+    pthread_mutex_lock(&wire->lock);
+    wire->stop = true;
+    pthread_cond_signal(&wire->cond);
+    pthread_mutex_unlock(&wire->lock);
+    pthread_join(wire->thread, NULL);
+    while (wire->head) {
+        host_wire_frame_t *frame = wire->head;
+        wire->head = frame->next;
+        free(frame);
+    }
+    pthread_mutex_destroy(&wire->lock);
+    pthread_cond_destroy(&wire->cond);
+    free(wire);
+}
+
+void host_wire_attach(host_wire_t *wire, int end, host_wire_rx_t rx, void *ctx)
+{
+    pthread_mutex_lock(&wire->lock);
+    wire->ends[end].rx = rx;
+    wire->ends[end].ctx = ctx;
+    pthread_mutex_unlock(&wire->lock);
+}
+
+uint32_t host_wire_send(host_wire_t *wire, int end, const uint8_t *frame, uint32_t length)
+{
+    host_wire_frame_t *item = malloc(sizeof(host_wire_frame_t) + length);
+    uint32_t wire_bytes = (length < WIRE_MIN_FRAME ? WIRE_MIN_FRAME : length) + WIRE_OVERHEAD_BYTES;
+    int64_t frame_ns = (int64_t)wire_bytes * 8 * 1000000 / wire->config.bandwidth_kbps;
+    int64_t now = wire_now_ns();
+    pthread_mutex_lock(&wire->lock);
+    host_wire_end_t *from = &wire->ends[end];
+    int64_t start = from->busy_until_ns > now ? from->busy_until_ns : now;
+    from->busy_until_ns = start + frame_ns;
+    from->stats.frames++;
+    bool lost = wire->config.loss_pct > 0 && rand_r(&wire->random) < wire->config.loss_pct / 100 * ((double)RAND_MAX + 1);
+    if (lost || !item) {
+        from->stats.lost++;
+        free(item);
+    } else {
+        item->arrival_ns = from->busy_until_ns + (int64_t)wire->config.latency_us * 1000;
+        item->end = !end;
+        item->length = length;
+        memcpy(item->data, frame, length);
+        // frames of a direction arrive in order, the directions are merged by arrival time
+        host_wire_frame_t **pos = &wire->head;
+        while (*pos && (*pos)->arrival_ns <= item->arrival_ns) {
+            pos = &(*pos)->next;
+        }
+        item->next = *pos;
+        *pos = item;
+        pthread_cond_signal(&wire->cond);
+    }
+    uint32_t time_us = (from->busy_until_ns - now + 999) / 1000;
+    pthread_mutex_unlock(&wire->lock);
+    return time_us;
+}
+
+void host_wire_get_stats(host_wire_t *wire, int end, host_wire_stats_t *stats)
+{
+    pthread_mutex_lock(&wire->lock);
+    *stats = wire->ends[end].stats;
+    pthread_mutex_unlock(&wire->lock);
+}
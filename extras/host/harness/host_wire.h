@@ -0,0 +1,61 @@
+/*
+ * Virtual wire of the host build: a full duplex point-to-point link between two emulated chips.
+ *
+ * A frame occupies its direction of the wire for its time at the configured bandwidth, with
+ * preamble, FCS and the inter-frame gap, and arrives at the other end after the latency.
+ * Frames are lost at random with the configured probability. Frames are delivered by the
+ * thread of the wire.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_wire host_wire_t;
+
+/**
+ * @brief Frame arrived at an end of the wire
+ * @return false if the chip dropped it
+ */
+typedef bool (*host_wire_rx_t)(void *ctx, const uint8_t *frame, uint32_t length);
+
+typedef struct {
+    uint32_t bandwidth_kbps;        /*!< Bandwidth of each direction in kbit/s */
+    uint32_t latency_us;            /*!< Propagation delay in us, added to the time of the frame */
+    double loss_pct;                /*!< Probability in % that a frame is lost */
+    uint32_t seed;                  /*!< Seed of the random losses */
+} host_wire_config_t;
+
+typedef struct {
+    uint32_t frames;                /*!< Frames sent from this end */
+    uint32_t lost;                  /*!< Frames sent from this end and lost on the wire */
+    uint32_t dropped;               /*!< Frames delivered to this end and dropped by its chip */
+} host_wire_stats_t;
+
+host_wire_t *host_wire_new(const host_wire_config_t *config);
+
+/**
+ * @brief Delete the wire, frames in flight are discarded
+ */
+void host_wire_delete(host_wire_t *wire);
+
+/**
+ * @brief Connect the receiver of an end of the wire, end 0 or 1
+ */
+void host_wire_attach(host_wire_t *wire, int end, host_wire_rx_t rx, void *ctx);
+
+/**
+ * @brief Send a frame (without FCS) from an end to the other one
+ * @return time in us until the frame has left the sender, including the wait for the previous frame
+ */
+uint32_t host_wire_send(host_wire_t *wire, int end, const uint8_t *frame, uint32_t length);
+
+void host_wire_get_stats(host_wire_t *wire, int end, host_wire_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
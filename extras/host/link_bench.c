@@ -0,0 +1,565 @@
+/*
+ * Link bench of two emulated ENC28J60 connected by a virtual wire, the host counterpart of
+ * examples/LinkBench.
+ *
+ * Both nodes run the real driver against a chip model. The models transmit into a virtual wire
+ * with a bandwidth, a latency and a loss rate, and the SPI accesses of the drivers take the time
+ * of the bus. Every run makes a UDP ping-pong, with the echo sent by the stack thread of the
+ * peer, and a TCP-like bulk transfer over UDP: full size segments with a window, go-back-N
+ * retransmission after a timeout or three duplicate ACKs and a delayed ACK for every second
+ * segment. A CSV line per run has the p50/p99 ping time, the throughput of the bulk transfer
+ * and the CPU time of the process during it, for both nodes, the models and the wire.
+ *
+ * usage: link_bench [--runs n] [--bandwidth-kbps b] [--latency-us l] [--loss-pct p] [--spi-mhz f]
+ *                   [--transaction-us t] [--bytes n] [--pings n] [--double-buffer]
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_eth.h"
+#include "esp_eth_enc28j60.h"
+#include "host_eth.h"
+#include "host_spi.h"
+#include "host_wire.h"
+#include "enc28j60_model.h"
+
+#define LINK_PING_SIZE (64)
+#define LINK_PING_TIMEOUT_US (100000)
+#define LINK_SEGMENT_SIZE (1460)
+#define LINK_HEADER_SIZE (42 + 12)  // Ethernet, IPv4 and UDP headers, then type, seq and length
+#define LINK_ACK_SIZE (60)
+#define LINK_WINDOW (8)
+#define LINK_RTO_US (200000)
+#define LINK_DUP_ACKS (3)
+#define LINK_MAX_RTOS (50)          // consecutive timeouts without progress which fail the transfer
+#define LINK_START_TIMEOUT_MS (2000)
+
+typedef enum {
+    LINK_PING = 1,
+    LINK_PONG,
+    LINK_DATA,
+    LINK_ACK,
+} link_type_t;
+
+typedef struct link_bench link_bench_t;
+
+typedef struct {
+    link_bench_t *bench;
+    int end;                        /*!< end of the wire */
+    const uint8_t *addr;
+    const uint8_t *peer_addr;
+    enc28j60_model_t *chip;
+    host_spi_t *spi;
+    esp_eth_mac_t *mac;
+    host_eth_t *eth;
+} link_node_t;
+
+typedef struct {
+    uint32_t runs;
+    uint32_t bandwidth_kbps;
+    uint32_t latency_us;
+    double loss_pct;
+    double spi_mhz;
+    double transaction_us;
+    uint32_t bytes;
+    uint32_t pings;
+    bool double_buffer;
+} link_options_t;
+
+struct link_bench {
+    host_wire_t *wire;
+    link_node_t nodes[2];           /*!< 0 measures, 1 echoes and receives the bulk transfer */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    atomic_bool closing;            /*!< the nodes don't answer any more */
+    // node 0
+    uint32_t pong_seq;              /*!< seq of the last pong, UINT32_MAX for none */
+    uint32_t acked;                 /*!< segments acked by the receiver */
+    uint32_t dup_acks;
+    bool fast_retransmit;
+    // node 1
+    uint32_t expected;              /*!< next segment in order */
+    uint32_t unacked;               /*!< in-order segments not acked yet */
+    uint32_t segments;              /*!< segments of the transfer, the last one is acked at once */
+};
+
+static const uint8_t s_addr[2][6] = {
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 },
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 },
+};
+
+static int64_t link_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t link_cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void link_sleep_us(uint32_t us)
+{
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * @brief Wait on the bench condition until deadline_us of link_now_us, called with the lock
+ */
+static void link_wait_until(link_bench_t *bench, int64_t deadline_us)
+{
+    struct timespec ts = { .tv_sec = deadline_us / 1000000, .tv_nsec = (deadline_us % 1000000) * 1000 };
+    pthread_cond_timedwait(&bench->cond, &bench->lock, &ts);
+}
+
+static void link_put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = value >> 24;
+}
+
+static uint32_t link_get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief IPv4 UDP frame of length bytes, with the bench header after the UDP header
+ */
+static void link_frame(uint8_t *frame, uint32_t length, const link_node_t *from, link_type_t type,
+                       uint32_t seq, uint32_t data_length)
+{
+    memset(frame, 0, LINK_HEADER_SIZE);
+    memcpy(frame, from->peer_addr, 6);
+    memcpy(frame + 6, from->addr, 6);
+    frame[12] = 0x08; // IPv4
+    uint8_t *ip = frame + 14;
+    uint16_t ip_len = length - 14;
+    ip[0] = 0x45;
+    ip[2] = ip_len >> 8;
+    ip[3] = ip_len & 0xFF;
+    ip[8] = 64;
+    ip[9] = 17; // UDP
+    memcpy(ip + 12, from->end ? "\xc0\xa8\xc8\x01\xc0\xa8\xc8\x02" : "\xc0\xa8\xc8\x02\xc0\xa8\xc8\x01", 8);
+    uint8_t *udp = ip + 20;
+    uint16_t port = type == LINK_PING || type == LINK_PONG ? 7 : 5001;
+    uint16_t udp_len = ip_len - 20;
+    udp[0] = port >> 8;
+    udp[1] = port & 0xFF;
+    udp[2] = port >> 8;
+    udp[3] = port & 0xFF;
+    udp[4] = udp_len >> 8;
+    udp[5] = udp_len & 0xFF;
+    uint8_t *header = udp + 8;
+    header[0] = type;
+    link_put_u32(header + 4, seq);
+    link_put_u32(header + 8, data_length);
+}
+
+static uint32_t link_transmit(void *ctx, const uint8_t *frame, uint32_t length)
+{
+    link_node_t *node = (link_node_t *)ctx;
+    return host_wire_send(node->bench->wire, node->end, frame, length);
+}
+
+static bool link_wire_rx(void *ctx, const uint8_t *frame, uint32_t length)
+{
+    return enc28j60_model_receive((enc28j60_model_t *)ctx, frame, length);
+}
+
+static void link_send_ack(link_node_t *node, uint32_t seq)
+{
+    uint8_t ack[LINK_ACK_SIZE];
+    link_frame(ack, sizeof(ack), node, LINK_ACK, seq, 0);
+    host_eth_transmit(node->eth, ack, sizeof(ack));
+}
+
+/**
+ * @brief Stack thread of the echoing node: answers pings and acks the segments
+ */
+static void link_echo_input(void *ctx, const uint8_t *frame, uint32_t length)
+{
+    link_node_t *node = (link_node_t *)ctx;
+    link_bench_t *bench = node->bench;
+    if (length < LINK_HEADER_SIZE || atomic_load(&bench->closing)) {
+        return;
+    }
+    const uint8_t *header = frame + 42;
+    uint32_t seq = link_get_u32(header + 4);
+    uint32_t ack = UINT32_MAX;
+    if (header[0] == LINK_PING) {
+        uint8_t pong[42 + 12 + LINK_PING_SIZE];
+        if (length > sizeof(pong)) {
+            return;
+        }
+        memcpy(pong, frame, length);
+        link_frame(pong, length, node, LINK_PONG, seq, link_get_u32(header + 8));
+        host_eth_transmit(node->eth, pong, length);
+    } else if (header[0] == LINK_DATA) {
+        pthread_mutex_lock(&bench->lock);
+        if (seq == bench->expected) {
+            bench->expected++;
+            // delayed ACK for every second segment, the last one is acked at once
+            if (++bench->unacked >= 2 || bench->expected == bench->segments) {
+                bench->unacked = 0;
+                ack = bench->expected;
+            }
+        } else {
+            // out of order or a retransmission of an acked segment
+            bench->unacked = 0;
+            ack = bench->expected;
+        }
+        pthread_mutex_unlock(&bench->lock);
+    }
+    if (ack != UINT32_MAX) {
+        link_send_ack(node, ack);
+    }
+}
+
+/**
+ * @brief Stack thread of the measuring node: takes the pongs and the ACKs
+ */
+static void link_measure_input(void *ctx, const uint8_t *frame, uint32_t length)
+{
+    link_node_t *node = (link_node_t *)ctx;
+    link_bench_t *bench = node->bench;
+    if (length < LINK_HEADER_SIZE) {
+        return;
+    }
+    const uint8_t *header = frame + 42;
+    uint32_t seq = link_get_u32(header + 4);
+    pthread_mutex_lock(&bench->lock);
+    if (header[0] == LINK_PONG) {
+        bench->pong_seq = seq;
+        pthread_cond_signal(&bench->cond);
+    } else if (header[0] == LINK_ACK) {
+        if (seq > bench->acked) {
+            bench->acked = seq;
+            bench->dup_acks = 0;
+            pthread_cond_signal(&bench->cond);
+        } else if (seq == bench->acked && ++bench->dup_acks == LINK_DUP_ACKS) {
+            bench->fast_retransmit = true;
+            pthread_cond_signal(&bench->cond);
+        }
+    }
+    pthread_mutex_unlock(&bench->lock);
+}
+
+static esp_err_t link_spi_xfer(void *chip, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len)
+{
+    return enc28j60_model_spi((enc28j60_model_t *)chip, write, cmd, addr, data, len);
+}
+
+static bool link_node_init(link_bench_t *bench, int end, const link_options_t *options)
+{
+    link_node_t *node = &bench->nodes[end];
+    node->bench = bench;
+    node->end = end;
+    node->addr = s_addr[end];
+    node->peer_addr = s_addr[!end];
+    const enc28j60_model_config_t model_config = {
+        .int_gpio_num = 4 + end,
+        .transmit = link_transmit,
+        .transmit_ctx = node,
+    };
+    node->chip = enc28j60_model_new(&model_config);
+    if (!node->chip) {
+        return false;
+    }
+    node->spi = host_spi_new(node->chip, link_spi_xfer);
+    if (!node->spi) {
+        return false;
+    }
+    const host_spi_timing_t timing = {
+        .clock_hz = options->spi_mhz * 1000000,
+        .transaction_ns = options->transaction_us * 1000,
+        .header_bytes = 1, // opcode
+    };
+    host_spi_set_timing(node->spi, &timing);
+
+    eth_enc28j60_config_t enc28j60_config = ETH_ENC28J60_DEFAULT_CONFIG(0, NULL);
+    enc28j60_config.custom_spi_driver = host_spi_driver_config(node->spi);
+    enc28j60_config.spi_burst.begin = host_spi_burst_begin;
+    enc28j60_config.spi_burst.end = host_spi_burst_end;
+    enc28j60_config.int_gpio_num = model_config.int_gpio_num;
+    enc28j60_config.tx_double_buffer = options->double_buffer;
+    eth_mac_config_t mac_config = ETH_MAC_DEFAULT_CONFIG();
+    node->mac = esp_eth_mac_new_enc28j60(&enc28j60_config, &mac_config);
+    if (!node->mac) {
+        return false;
+    }
+    node->eth = host_eth_new(node->mac, end ? link_echo_input : link_measure_input, node, NULL);
+    if (!node->eth) {
+        node->mac->del(node->mac);
+        node->mac = NULL;
+        return false;
+    }
+    host_wire_attach(bench->wire, end, link_wire_rx, node->chip);
+    return host_eth_start(node->eth, node->addr) == ESP_OK;
+}
+
+static void link_node_check(link_node_t *node)
+{
+    enc28j60_model_stats_t stats;
+    eth_enc28j60_stats_t driver_stats;
+    host_wire_stats_t wire_stats;
+    enc28j60_model_get_stats(node->chip, &stats);
+    emac_enc28j60_get_stats(node->mac, &driver_stats);
+    host_wire_get_stats(node->bench->wire, node->end, &wire_stats);
+    if (stats.invalid_accesses || stats.even_erxrdpt || stats.rx_overflows || driver_stats.tx_timeouts) {
+        fprintf(stderr, "node %d: %u invalid accesses, %u even ERXRDPT, %u RX overflows, %u TX timeouts\n",
+                node->end, (unsigned)stats.invalid_accesses, (unsigned)stats.even_erxrdpt,
+                (unsigned)stats.rx_overflows, (unsigned)driver_stats.tx_timeouts);
+    }
+    if (wire_stats.dropped) {
+        fprintf(stderr, "node %d: %u frames from the wire dropped by the chip\n", node->end, (unsigned)wire_stats.dropped);
+    }
+}
+
+/**
+ * @brief Stop answering, let the frames in flight settle and delete the nodes and the wire
+ */
+static void link_bench_delete(link_bench_t *bench)
+{
+    atomic_store(&bench->closing, true);
+    link_sleep_us(LINK_RTO_US);
+    for (int end = 0; end < 2; end++) {
+        if (bench->wire) {
+            host_wire_attach(bench->wire, end, NULL, NULL);
+        }
+    }
+    if (bench->wire) {
+        host_wire_delete(bench->wire);
+    }
+    for (int end = 0; end < 2; end++) {
+        link_node_t *node = &bench->nodes[end];
+        if (node->eth) {
+            host_eth_delete(node->eth);
+        } else if (node->mac) {
+            node->mac->del(node->mac);
+        }
+        if (node->spi) {
+            host_spi_delete(node->spi);
+        }
+        if (node->chip) {
+            enc28j60_model_delete(node->chip);
+        }
+    }
+    pthread_mutex_destroy(&bench->lock);
+    pthread_cond_destroy(&bench->cond);
+    free(bench);
+}
+
+static link_bench_t *link_bench_new(const link_options_t *options)
+{
+    link_bench_t *bench = calloc(1, sizeof(link_bench_t));
+    if (!bench) {
+        return NULL;
+    }
+    pthread_mutex_init(&bench->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&bench->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    const host_wire_config_t wire_config = {
+        .bandwidth_kbps = options->bandwidth_kbps,
+        .latency_us = options->latency_us,
+        .loss_pct = options->loss_pct,
+        .seed = 1,
+    };
+    bench->wire = host_wire_new(&wire_config);
+    bool ok = bench->wire && link_node_init(bench, 0, options) && link_node_init(bench, 1, options);
+    // the link comes up without traffic, wait until both drivers have handled its interrupts
+    for (uint32_t waited = 0; ok && waited < LINK_START_TIMEOUT_MS; waited++) {
+        if (enc28j60_model_idle(bench->nodes[0].chip) && enc28j60_model_idle(bench->nodes[1].chip)) {
+            return bench;
+        }
+        link_sleep_us(1000);
+    }
+    link_bench_delete(bench);
+    return NULL;
+}
+
+static int link_compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief UDP ping-pong
+ * @return pings answered, their times in us sorted in times
+ */
+static uint32_t link_ping_pong(link_bench_t *bench, uint32_t pings, uint32_t *times)
+{
+    link_node_t *node = &bench->nodes[0];
+    uint8_t ping[42 + 12 + LINK_PING_SIZE];
+    uint32_t received = 0;
+    for (uint32_t i = 0; i < pings; i++) {
+        link_frame(ping, sizeof(ping), node, LINK_PING, i, LINK_PING_SIZE);
+        memset(ping + LINK_HEADER_SIZE, i & 0xFF, LINK_PING_SIZE);
+        int64_t start = link_now_us();
+        if (host_eth_transmit(node->eth, ping, sizeof(ping)) != ESP_OK) {
+            continue;
+        }
+        pthread_mutex_lock(&bench->lock);
+        while (bench->pong_seq != i && link_now_us() - start < LINK_PING_TIMEOUT_US) {
+            link_wait_until(bench, start + LINK_PING_TIMEOUT_US);
+        }
+        if (bench->pong_seq == i) {
+            times[received++] = link_now_us() - start;
+        }
+        pthread_mutex_unlock(&bench->lock);
+    }
+    qsort(times, received, sizeof(times[0]), link_compare_u32);
+    return received;
+}
+
+/**
+ * @brief Bulk transfer of bytes to the echoing node
+ * @return true if all segments were acked
+ */
+static bool link_bulk(link_bench_t *bench, uint32_t bytes)
+{
+    link_node_t *node = &bench->nodes[0];
+    uint32_t segments = (bytes + LINK_SEGMENT_SIZE - 1) / LINK_SEGMENT_SIZE;
+    uint8_t frame[LINK_HEADER_SIZE + LINK_SEGMENT_SIZE];
+    uint32_t next = 0;
+    uint32_t timeouts = 0;
+    for (uint32_t i = LINK_HEADER_SIZE; i < sizeof(frame); i++) {
+        frame[i] = i & 0xFF;
+    }
+    pthread_mutex_lock(&bench->lock);
+    bench->expected = 0;
+    bench->unacked = 0;
+    bench->segments = segments;
+    bench->acked = 0;
+    bench->dup_acks = 0;
+    bench->fast_retransmit = false;
+    int64_t progress = link_now_us();
+    while (bench->acked < segments && timeouts < LINK_MAX_RTOS) {
+        if (bench->fast_retransmit) {
+            // go-back-N from the first unacked segment
+            bench->fast_retransmit = false;
+            next = bench->acked;
+        }
+        if (next < bench->acked) {
+            next = bench->acked;
+        }
+        if (next < segments && next < bench->acked + LINK_WINDOW) {
+            uint32_t seq = next++;
+            uint32_t length = seq == segments - 1 ? bytes - seq * LINK_SEGMENT_SIZE : LINK_SEGMENT_SIZE;
+            pthread_mutex_unlock(&bench->lock);
+            link_frame(frame, LINK_HEADER_SIZE + length, node, LINK_DATA, seq, length);
+            host_eth_transmit(node->eth, frame, LINK_HEADER_SIZE + length);
+            pthread_mutex_lock(&bench->lock);
+            continue;
+        }
+        uint32_t acked = bench->acked;
+        link_wait_until(bench, progress + LINK_RTO_US);
+        if (bench->acked != acked) {
+            progress = link_now_us();
+            timeouts = 0;
+        } else if (!bench->fast_retransmit && link_now_us() - progress >= LINK_RTO_US) {
+            progress = link_now_us();
+            timeouts++;
+            next = bench->acked;
+        }
+    }
+    bool ok = bench->acked == segments;
+    pthread_mutex_unlock(&bench->lock);
+    return ok;
+}
+
+static const char *link_usage =
+    "usage: %s [--runs n] [--bandwidth-kbps b] [--latency-us l] [--loss-pct p] [--spi-mhz f]\n"
+    "       [--transaction-us t] [--bytes n] [--pings n] [--double-buffer]\n";
+
+int main(int argc, char **argv)
+{
+    link_options_t options = {
+        .runs = 5,
+        .bandwidth_kbps = 10000,
+        .spi_mhz = 20,
+        .transaction_us = 2,
+        .bytes = 1000000,
+        .pings = 200,
+    };
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            options.runs = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--bandwidth-kbps") && i + 1 < argc) {
+            options.bandwidth_kbps = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--latency-us") && i + 1 < argc) {
+            options.latency_us = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--loss-pct") && i + 1 < argc) {
+            options.loss_pct = strtod(argv[++i], NULL);
+        } else if (!strcmp(argv[i], "--spi-mhz") && i + 1 < argc) {
+            options.spi_mhz = strtod(argv[++i], NULL);
+        } else if (!strcmp(argv[i], "--transaction-us") && i + 1 < argc) {
+            options.transaction_us = strtod(argv[++i], NULL);
+        } else if (!strcmp(argv[i], "--bytes") && i + 1 < argc) {
+            options.bytes = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--pings") && i + 1 < argc) {
+            options.pings = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--double-buffer")) {
+            options.double_buffer = true;
+        } else {
+            fprintf(stderr, link_usage, argv[0]);
+            return 2;
+        }
+    }
+    if (!options.bandwidth_kbps || options.spi_mhz < 0 || options.loss_pct < 0 || options.loss_pct >= 100 || !options.bytes) {
+        fprintf(stderr, "bandwidth-kbps and bytes must be positive, spi-mhz not negative and loss-pct below 100\n");
+        return 2;
+    }
+    link_bench_t *bench = link_bench_new(&options);
+    if (!bench) {
+        fprintf(stderr, "link setup failed\n");
+        return 1;
+    }
+    uint32_t *times = calloc(options.pings ? options.pings : 1, sizeof(uint32_t));
+    const char *config = options.double_buffer ? "double_buffer" : "single_buffer";
+    bool ok = times != NULL;
+    printf("run,config,bandwidth_kbps,latency_us,loss_pct,spi_mhz,udp_p50_us,udp_p99_us,udp_lost,tcp_kBps,cpu_ms,cpu_pct\n");
+    for (uint32_t run = 0; ok && run < options.runs; run++) {
+        pthread_mutex_lock(&bench->lock);
+        bench->pong_seq = UINT32_MAX;
+        pthread_mutex_unlock(&bench->lock);
+        uint32_t received = link_ping_pong(bench, options.pings, times);
+        uint32_t p50 = received ? times[received / 2] : 0;
+        uint32_t p99 = received ? times[received * 99 / 100] : 0;
+        // the CPU time is of the whole process: both nodes, the models and the wire
+        int64_t cpu_start = link_cpu_us();
+        int64_t start = link_now_us();
+        bool done = link_bulk(bench, options.bytes);
+        int64_t elapsed = link_now_us() - start;
+        int64_t cpu = link_cpu_us() - cpu_start;
+        if (!done) {
+            fprintf(stderr, "run %u: bulk transfer stalled\n", (unsigned)run);
+            ok = false;
+        }
+        unsigned long kBps = done && elapsed ? (unsigned long)((uint64_t)options.bytes * 1000 / elapsed) : 0;
+        printf("%u,%s,%u,%u,%.2f,%.1f,%u,%u,%u,%lu,%.1f,%.1f\n", (unsigned)run, config, (unsigned)options.bandwidth_kbps,
+               (unsigned)options.latency_us, options.loss_pct, options.spi_mhz, (unsigned)p50, (unsigned)p99,
+               (unsigned)(options.pings - received), kBps, cpu / 1000.0, elapsed ? cpu * 100.0 / elapsed : 0.0);
+        fflush(stdout);
+    }
+    link_node_check(&bench->nodes[0]);
+    link_node_check(&bench->nodes[1]);
+    free(times);
+    link_bench_delete(bench);
+    return ok ? 0 : 1;
+}
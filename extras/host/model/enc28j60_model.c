@@ -0,0 +1,721 @@
+/*
+ * Register and buffer model of the ENC28J60, see enc28j60_model.h.
+ * Register addresses and bits are the driver's, from enc28j60.h. The behaviour follows the
+ * datasheet (DS39662E) and the B7 errata sheet (DS80349C).
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "enc28j60.h"
+#include "enc28j60_model.h"
+
+#define MODEL_BUF_SIZE (0x2000)
+#define MODEL_BUF_MASK (0x1FFF)
+#define MODEL_REV_B7 (0x06)
+#define MODEL_MIN_FRAME (60)
+#define MODEL_MAX_FRAME (1536)
+#define MODEL_TSV_SIZE (7)
+#define MODEL_RSV_SIZE (6)
+
+#define EIE_SOURCES (EIE_PKTIE | EIE_DMAIE | EIE_LINKIE | EIE_TXIE | EIE_TXERIE | EIE_RXERIE)
+#define ECON2_WRITABLE (ECON2_AUTOINC | ECON2_PWRSV | ECON2_VRPS)
+#define ESTAT_CLEARABLE (ESTAT_BUFER | ESTAT_LATECOL | ESTAT_TXABRT)
+
+// PHY registers
+#define PHCON1  (0x00)
+#define PHSTAT1 (0x01)
+#define PHID1   (0x02)
+#define PHID2   (0x03)
+#define PHCON2  (0x10)
+#define PHSTAT2 (0x11)
+#define PHIE    (0x12)
+#define PHIR    (0x13)
+#define PHLCON  (0x14)
+
+#define PHCON1_PDPXMD  (1 << 8)
+#define PHSTAT1_PFDPX  (1 << 12)
+#define PHSTAT1_PHDPX  (1 << 11)
+#define PHSTAT1_LLSTAT (1 << 2)
+#define PHSTAT2_LSTAT  (1 << 10)
+#define PHSTAT2_DPXSTAT (1 << 9)
+
+// TSV and RSV bits
+#define TSV_DONE       (1 << 7)  // byte 2
+#define TSV_MULTICAST  (1 << 0)  // byte 3
+#define TSV_BROADCAST  (1 << 1)
+#define TSV_LATE_COL   (1 << 5)
+#define RSV_RX_OK      (1 << 7)  // byte 4
+#define RSV_MULTICAST  (1 << 0)  // byte 5
+#define RSV_BROADCAST  (1 << 1)
+
+struct enc28j60_model {
+    pthread_mutex_t lock;
+    enc28j60_model_config_t config;
+    esp_timer_handle_t tx_timer;
+    uint8_t regs[4][0x1B];   /*!< banked registers, 0x1B-0x1F are the common ones below */
+    uint8_t eie;
+    uint8_t eir;             /*!< without PKTIF, which follows EPKTCNT */
+    uint8_t estat;
+    uint8_t econ2;
+    uint8_t econ1;
+    uint16_t erdpt;
+    uint16_t ewrpt;
+    uint16_t erxwrpt;
+    uint16_t erxrdpt;
+    uint8_t erxrdptl;        /*!< written low byte of ERXRDPT, latched by the high byte write */
+    uint8_t epktcnt;
+    uint16_t phy[0x20];
+    bool tx_pending;
+    bool tx_fail;
+    uint32_t tx_count;
+    int int_level;
+    uint8_t mem[MODEL_BUF_SIZE];
+    enc28j60_model_stats_t stats;
+};
+
+static inline uint8_t model_bank(enc28j60_model_t *m)
+{
+    return m->econ1 & (ECON1_BSEL1 | ECON1_BSEL0);
+}
+
+static inline uint16_t model_reg16(enc28j60_model_t *m, uint16_t reg)
+{
+    uint8_t bank = (reg & 0x300) >> 8;
+    uint8_t addr = reg & 0x1F;
+    return (m->regs[bank][addr] | (m->regs[bank][addr + 1] << 8)) & MODEL_BUF_MASK;
+}
+
+static inline void model_set_reg16(enc28j60_model_t *m, uint16_t reg, uint16_t value)
+{
+    uint8_t bank = (reg & 0x300) >> 8;
+    uint8_t addr = reg & 0x1F;
+    m->regs[bank][addr] = value & 0xFF;
+    m->regs[bank][addr + 1] = value >> 8;
+}
+
+/**
+ * @brief MAC and MII registers return a dummy byte before the value on RCR
+ */
+static bool model_is_mac_mii(uint8_t bank, uint8_t addr)
+{
+    return (bank == 2 && addr <= 0x19) || (bank == 3 && (addr <= 0x05 || addr == 0x0A));
+}
+
+static inline uint8_t model_eir(enc28j60_model_t *m)
+{
+    return m->eir | (m->epktcnt ? EIR_PKTIF : 0);
+}
+
+static inline bool model_int_asserted(enc28j60_model_t *m)
+{
+    return (m->eie & EIE_INTIE) && (model_eir(m) & m->eie & EIE_SOURCES);
+}
+
+static void model_update_int(enc28j60_model_t *m)
+{
+    int level = model_int_asserted(m) ? 0 : 1; // active low
+    if (level != m->int_level) {
+        m->int_level = level;
+        if (m->config.int_gpio_num >= 0) {
+            host_gpio_set_level(m->config.int_gpio_num, level);
+        }
+    }
+}
+
+/**
+ * @brief Next buffer address after addr, the read pointer and the DMA wrap at the end of the RX buffer
+ */
+static inline uint16_t model_next_addr(enc28j60_model_t *m, uint16_t addr, bool rx_wrap)
+{
+    if (rx_wrap && addr == model_reg16(m, ENC28J60_ERXNDL)) {
+        return model_reg16(m, ENC28J60_ERXSTL);
+    }
+    return (addr + 1) & MODEL_BUF_MASK;
+}
+
+static void model_reset(enc28j60_model_t *m)
+{
+    memset(m->regs, 0, sizeof(m->regs));
+    m->eie = 0;
+    m->eir = 0;
+    m->estat = ESTAT_CLKRDY;
+    m->econ2 = ECON2_AUTOINC;
+    m->econ1 = 0;
+    model_set_reg16(m, ENC28J60_ERXSTL, 0x05FA);
+    model_set_reg16(m, ENC28J60_ERXNDL, 0x1FFF);
+    m->erdpt = 0x05FA;
+    m->ewrpt = 0;
+    m->erxrdpt = 0x05FA;
+    m->erxrdptl = 0xFA;
+    m->erxwrpt = 0;
+    m->epktcnt = 0;
+    m->regs[1][ENC28J60_ERXFCON & 0x1F] = ERXFCON_UCEN | ERXFCON_CRCEN | ERXFCON_BCEN;
+    m->regs[2][ENC28J60_MACLCON1 & 0x1F] = 0x0F;
+    m->regs[2][ENC28J60_MACLCON2 & 0x1F] = 0x37;
+    m->regs[2][ENC28J60_MAMXFLL & 0x1F] = 0x00;
+    m->regs[2][ENC28J60_MAMXFLH & 0x1F] = 0x06;
+    m->regs[3][ENC28J60_ECOCON & 0x1F] = 0x04;
+    m->regs[3][ENC28J60_EPAUSH & 0x1F] = 0x10;
+    memset(m->phy, 0, sizeof(m->phy));
+    m->phy[PHSTAT1] = PHSTAT1_PFDPX | PHSTAT1_PHDPX | PHSTAT1_LLSTAT; // link is always up
+    m->phy[PHID1] = 0x0083;
+    m->phy[PHID2] = 0x1400;
+    m->phy[PHSTAT2] = PHSTAT2_LSTAT;
+    m->phy[PHLCON] = 0x3422;
+    m->tx_pending = false;
+    if (m->tx_timer) {
+        esp_timer_stop(m->tx_timer);
+    }
+}
+
+static uint8_t model_reg_read(enc28j60_model_t *m, uint8_t addr)
+{
+    uint8_t bank = model_bank(m);
+    switch (addr) {
+    case ENC28J60_EIE: return m->eie;
+    case ENC28J60_EIR: return model_eir(m);
+    case ENC28J60_ESTAT: return m->estat | (model_int_asserted(m) ? ESTAT_INT : 0);
+    case ENC28J60_ECON2: return m->econ2;
+    case ENC28J60_ECON1: return m->econ1;
+    default: break;
+    }
+    if (bank == 0) {
+        switch (addr) {
+        case ENC28J60_ERDPTL: return m->erdpt & 0xFF;
+        case ENC28J60_ERDPTH: return m->erdpt >> 8;
+        case ENC28J60_EWRPTL: return m->ewrpt & 0xFF;
+        case ENC28J60_EWRPTH: return m->ewrpt >> 8;
+        case ENC28J60_ERXRDPTL: return m->erxrdpt & 0xFF;
+        case ENC28J60_ERXRDPTH: return m->erxrdpt >> 8;
+        case ENC28J60_ERXWRPTL: return m->erxwrpt & 0xFF;
+        case ENC28J60_ERXWRPTH: return m->erxwrpt >> 8;
+        default: break;
+        }
+    } else if (bank == 1 && addr == (ENC28J60_EPKTCNT & 0x1F)) {
+        return m->epktcnt;
+    } else if (bank == 3 && addr == (ENC28J60_EREVID & 0x1F)) {
+        return m->config.revision;
+    } else if (bank == 3 && addr == (ENC28J60_MISTAT & 0x1F)) {
+        return 0; // PHY accesses complete before the next SPI access
+    }
+    return m->regs[bank][addr];
+}
+
+static uint16_t model_checksum(enc28j60_model_t *m, uint16_t start, uint16_t end)
+{
+    uint32_t sum = 0;
+    uint16_t addr = start;
+    for (uint32_t i = 0; i < MODEL_BUF_SIZE; i++) {
+        sum += (i & 1) ? m->mem[addr] : m->mem[addr] << 8;
+        if (addr == end) {
+            break;
+        }
+        addr = model_next_addr(m, addr, true);
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return ~sum & 0xFFFF;
+}
+
+static void model_dma(enc28j60_model_t *m)
+{
+    uint16_t start = model_reg16(m, ENC28J60_EDMASTL);
+    uint16_t end = model_reg16(m, ENC28J60_EDMANDL);
+    if (m->econ1 & ECON1_CSUMEN) {
+        uint16_t checksum = model_checksum(m, start, end);
+        m->regs[0][ENC28J60_EDMACSL & 0x1F] = checksum & 0xFF;
+        m->regs[0][ENC28J60_EDMACSH & 0x1F] = checksum >> 8;
+    } else {
+        uint16_t dest = model_reg16(m, ENC28J60_EDMADSTL);
+        uint16_t addr = start;
+        for (uint32_t i = 0; i < MODEL_BUF_SIZE; i++) {
+            m->mem[dest] = m->mem[addr];
+            if (addr == end) {
+                break;
+            }
+            addr = model_next_addr(m, addr, true);
+            dest = model_next_addr(m, dest, true);
+        }
+    }
+    // the copy takes 1 us per byte on the chip, the model completes it before the next SPI access
+    m->econ1 &= ~ECON1_DMAST;
+    m->eir |= EIR_DMAIF;
+}
+
+static void model_tx_begin(enc28j60_model_t *m)
+{
+    uint8_t frame[MODEL_MAX_FRAME];
+    uint16_t start = model_reg16(m, ENC28J60_ETXSTL);
+    uint16_t end = model_reg16(m, ENC28J60_ETXNDL);
+    uint32_t length = ((end - start) & MODEL_BUF_MASK);
+    if (length > sizeof(frame)) {
+        length = sizeof(frame); // giant frame, the MAC truncates it
+    }
+    uint16_t addr = (start + 1) & MODEL_BUF_MASK;
+    for (uint32_t i = 0; i < length; i++) {
+        frame[i] = m->mem[addr];
+        addr = (addr + 1) & MODEL_BUF_MASK;
+    }
+    // the control byte overrides MACON3 if POVERRIDE is set
+    uint8_t control = m->mem[start];
+    bool pad = (control & 0x01) ? (control & 0x04) : (m->regs[2][ENC28J60_MACON3 & 0x1F] & MACON3_PADCFG0);
+    if (pad && length < MODEL_MIN_FRAME) {
+        memset(frame + length, 0, MODEL_MIN_FRAME - length);
+        length = MODEL_MIN_FRAME;
+    }
+    m->tx_count++;
+    m->tx_fail = m->config.tx_error_every && m->tx_count % m->config.tx_error_every == 0;
+    uint32_t time_us;
+    if (m->tx_fail) {
+        time_us = 52; // the collision is seen in the first 64 bytes
+    } else if (m->config.transmit) {
+        time_us = m->config.transmit(m->config.transmit_ctx, frame, length);
+    } else {
+        time_us = (8 + length + 4 + 12) * 8 / 10; // preamble, frame, FCS and gap at 10 Mbps
+    }
+    m->tx_pending = true;
+    esp_timer_start_once(m->tx_timer, time_us ? time_us : 1);
+}
+
+static void model_tx_abort(enc28j60_model_t *m)
+{
+    if (m->tx_pending) {
+        m->tx_pending = false;
+        esp_timer_stop(m->tx_timer);
+    }
+}
+
+static void model_tx_done(void *arg)
+{
+    enc28j60_model_t *m = (enc28j60_model_t *)arg;
+    pthread_mutex_lock(&m->lock);
+    if (m->tx_pending) {
+        m->tx_pending = false;
+        uint16_t start = model_reg16(m, ENC28J60_ETXSTL);
+        uint16_t end = model_reg16(m, ENC28J60_ETXNDL);
+        uint16_t length = (end - start) & MODEL_BUF_MASK;
+        const uint8_t *dest = &m->mem[(start + 1) & MODEL_BUF_MASK];
+        uint8_t tsv[MODEL_TSV_SIZE] = {0};
+        tsv[0] = length & 0xFF;
+        tsv[1] = length >> 8;
+        if (dest[0] & 0x01) {
+            tsv[3] |= memcmp(dest, "\xff\xff\xff\xff\xff\xff", 6) == 0 ? TSV_BROADCAST : TSV_MULTICAST;
+        }
+        uint16_t wire_len = (length < MODEL_MIN_FRAME ? MODEL_MIN_FRAME : length) + 4;
+        if (m->tx_fail) {
+            tsv[3] |= TSV_LATE_COL;
+            m->eir |= EIR_TXERIF | EIR_TXIF; // B7 sets TXIF together with TXERIF
+            m->estat |= ESTAT_TXABRT | ESTAT_LATECOL;
+            m->stats.tx_errors++;
+        } else {
+            tsv[2] |= TSV_DONE;
+            tsv[4] = wire_len & 0xFF;
+            tsv[5] = wire_len >> 8;
+            m->eir |= EIR_TXIF;
+            m->stats.tx_frames++;
+        }
+        // the TSV is written after the frame, the 7th byte is not read by the drivers
+        for (int i = 0; i < MODEL_TSV_SIZE; i++) {
+            m->mem[(end + 1 + i) & MODEL_BUF_MASK] = tsv[i];
+        }
+        m->econ1 &= ~ECON1_TXRTS;
+        model_update_int(m);
+    }
+    pthread_mutex_unlock(&m->lock);
+}
+
+static void model_econ1_write(enc28j60_model_t *m, uint8_t value)
+{
+    uint8_t old = m->econ1;
+    m->econ1 = value;
+    if ((old ^ value) & (ECON1_BSEL1 | ECON1_BSEL0)) {
+        m->stats.bank_switches++;
+    }
+    if (value & ECON1_TXRST) {
+        // the transmit logic is held in reset
+        model_tx_abort(m);
+        m->econ1 &= ~ECON1_TXRTS;
+    } else if ((value & ECON1_TXRTS) && !(old & ECON1_TXRTS)) {
+        model_tx_begin(m);
+    } else if (!(value & ECON1_TXRTS) && (old & ECON1_TXRTS)) {
+        model_tx_abort(m);
+    }
+    if (value & ECON1_RXRST) {
+        m->econ1 &= ~ECON1_RXEN;
+    }
+    if ((value & ECON1_DMAST) && !(old & ECON1_DMAST)) {
+        model_dma(m);
+    }
+}
+
+static void model_reg_write(enc28j60_model_t *m, uint8_t addr, uint8_t value)
+{
+    uint8_t bank = model_bank(m);
+    switch (addr) {
+    case ENC28J60_EIE:
+        m->eie = value;
+        return;
+    case ENC28J60_EIR:
+        m->eir = value & ~EIR_PKTIF; // PKTIF is cleared by decrementing EPKTCNT only
+        return;
+    case ENC28J60_ESTAT:
+        m->estat = (m->estat & ~ESTAT_CLEARABLE) | (value & ESTAT_CLEARABLE);
+        return;
+    case ENC28J60_ECON2:
+        if ((value & ECON2_PKTDEC) && m->epktcnt > 0) {
+            m->epktcnt--;
+        }
+        m->econ2 = value & ECON2_WRITABLE;
+        return;
+    case ENC28J60_ECON1:
+        model_econ1_write(m, value);
+        return;
+    default:
+        break;
+    }
+    if (bank == 0) {
+        switch (addr) {
+        case ENC28J60_ERDPTL:
+            m->erdpt = (m->erdpt & 0xFF00) | value;
+            return;
+        case ENC28J60_ERDPTH:
+            m->erdpt = ((value << 8) | (m->erdpt & 0xFF)) & MODEL_BUF_MASK;
+            return;
+        case ENC28J60_EWRPTL:
+            m->ewrpt = (m->ewrpt & 0xFF00) | value;
+            return;
+        case ENC28J60_EWRPTH:
+            m->ewrpt = ((value << 8) | (m->ewrpt & 0xFF)) & MODEL_BUF_MASK;
+            return;
+        case ENC28J60_ERXRDPTL:
+            m->erxrdptl = value; // takes effect with the high byte
+            return;
+        case ENC28J60_ERXRDPTH:
+            m->erxrdpt = ((value << 8) | m->erxrdptl) & MODEL_BUF_MASK;
+            if (!(m->erxrdpt & 1)) {
+                m->stats.even_erxrdpt++;
+            }
+            return;
+        case ENC28J60_ERXWRPTL:
+        case ENC28J60_ERXWRPTH:
+        case ENC28J60_EDMACSL:
+        case ENC28J60_EDMACSH:
+            return; // read only
+        case ENC28J60_ERXSTL:
+        case ENC28J60_ERXSTH:
+            m->regs[0][addr] = value;
+            m->erxwrpt = model_reg16(m, ENC28J60_ERXSTL); // ERXWRPT follows ERXST
+            return;
+        default:
+            break;
+        }
+    } else if (bank == 1 && addr == (ENC28J60_EPKTCNT & 0x1F)) {
+        return;
+    } else if (bank == 2) {
+        switch (addr) {
+        case ENC28J60_MICMD & 0x1F:
+            if ((value & MICMD_MIIRD) && !(m->regs[2][addr] & MICMD_MIIRD)) {
+                uint16_t phy = m->phy[m->regs[2][ENC28J60_MIREGADR & 0x1F] & 0x1F];
+                m->regs[2][ENC28J60_MIRDL & 0x1F] = phy & 0xFF;
+                m->regs[2][ENC28J60_MIRDH & 0x1F] = phy >> 8;
+            }
+            break;
+        case ENC28J60_MIWRH & 0x1F: {
+            uint8_t reg = m->regs[2][ENC28J60_MIREGADR & 0x1F] & 0x1F;
+            uint16_t phy = m->regs[2][ENC28J60_MIWRL & 0x1F] | (value << 8);
+            if (reg == PHCON1) {
+                m->phy[PHCON1] = phy & ~0x8000; // PRST self clears
+                m->phy[PHSTAT2] = PHSTAT2_LSTAT | ((phy & PHCON1_PDPXMD) ? PHSTAT2_DPXSTAT : 0);
+            } else if (reg == PHCON2 || reg == PHIE || reg == PHLCON) {
+                m->phy[reg] = phy;
+            }
+            break;
+        }
+        case ENC28J60_MIRDL & 0x1F:
+        case ENC28J60_MIRDH & 0x1F:
+            return;
+        default:
+            break;
+        }
+    } else if (bank == 3 && (addr == (ENC28J60_EREVID & 0x1F) || addr == (ENC28J60_MISTAT & 0x1F))) {
+        return;
+    }
+    m->regs[bank][addr] = value;
+}
+
+enc28j60_model_t *enc28j60_model_new(const enc28j60_model_config_t *config)
+{
+    enc28j60_model_t *m = calloc(1, sizeof(enc28j60_model_t));
+    if (!m) {
+        return NULL;
+    }
+    m->config = *config;
+    if (!m->config.revision) {
+        m->config.revision = MODEL_REV_B7;
+    }
+    pthread_mutex_init(&m->lock, NULL);
+    const esp_timer_create_args_t tx_timer_args = {
+        .callback = model_tx_done,
+        .arg = m,
+        .name = "enc28j60_model_tx",
+    };
+    if (esp_timer_create(&tx_timer_args, &m->tx_timer) != ESP_OK) {
+        free(m);
+        return NULL;
+    }
+    model_reset(m);
+    m->int_level = 1;
+    if (m->config.int_gpio_num >= 0) {
+        host_gpio_set_level(m->config.int_gpio_num, 1);
+    }
+    return m;
+}
+
+void enc28j60_model_delete(enc28j60_model_t *model)
+{
+    pthread_mutex_lock(&model->lock);
+    model_tx_abort(model);
+    pthread_mutex_unlock(&model->lock);
+    esp_timer_delete(model->tx_timer);
+    pthread_mutex_destroy(&model->lock);
+    free(model);
+}
+
+esp_err_t enc28j60_model_spi(enc28j60_model_t *model, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len)
+{
+    enc28j60_model_t *m = model;
+    esp_err_t ret = ESP_OK;
+    uint8_t reg = addr & 0x1F;
+    pthread_mutex_lock(&m->lock);
+    m->stats.spi_transactions++;
+    m->stats.spi_bytes += 1 + len;
+    bool is_read = cmd == ENC28J60_SPI_CMD_RCR || cmd == ENC28J60_SPI_CMD_RBM;
+    if (is_read == write) {
+        m->stats.invalid_accesses++;
+        ret = ESP_ERR_INVALID_ARG;
+        goto out;
+    }
+    switch (cmd) {
+    case ENC28J60_SPI_CMD_RCR: {
+        uint8_t value = model_reg_read(m, reg);
+        bool dummy = model_is_mac_mii(model_bank(m), reg);
+        if (dummy && len < 2) {
+            m->stats.invalid_accesses++; // the driver gets the dummy byte
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            data[i] = (dummy && i == 0) ? 0x00 : value;
+        }
+        break;
+    }
+    case ENC28J60_SPI_CMD_RBM:
+        for (uint32_t i = 0; i < len; i++) {
+            data[i] = m->mem[m->erdpt];
+            if (m->econ2 & ECON2_AUTOINC) {
+                m->erdpt = model_next_addr(m, m->erdpt, true);
+            }
+        }
+        break;
+    case ENC28J60_SPI_CMD_WCR:
+        if (len) {
+            model_reg_write(m, reg, data[0]);
+        }
+        break;
+    case ENC28J60_SPI_CMD_WBM:
+        for (uint32_t i = 0; i < len; i++) {
+            m->mem[m->ewrpt] = data[i];
+            if (m->econ2 & ECON2_AUTOINC) {
+                m->ewrpt = (m->ewrpt + 1) & MODEL_BUF_MASK;
+            }
+        }
+        break;
+    case ENC28J60_SPI_CMD_BFS:
+    case ENC28J60_SPI_CMD_BFC:
+        if (model_is_mac_mii(model_bank(m), reg)) {
+            m->stats.invalid_accesses++; // bit field operations are for ETH registers only
+        }
+        if (len) {
+            uint8_t value = model_reg_read(m, reg);
+            value = cmd == ENC28J60_SPI_CMD_BFS ? value | data[0] : value & ~data[0];
+            model_reg_write(m, reg, value);
+        }
+        break;
+    case ENC28J60_SPI_CMD_SRC:
+        model_reset(m);
+        break;
+    default:
+        m->stats.invalid_accesses++;
+        ret = ESP_ERR_INVALID_ARG;
+        break;
+    }
+    model_update_int(m);
+out:
+    pthread_mutex_unlock(&m->lock);
+    return ret;
+}
+
+static uint32_t model_crc32(const uint8_t *data, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static bool model_hash_match(enc28j60_model_t *m, const uint8_t *dest)
+{
+    // bits 28:23 of the CRC of the destination address, MSB first
+    uint32_t crc = 0xFFFFFFFF;
+    for (int i = 0; i < 6; i++) {
+        uint8_t byte = dest[i];
+        for (int j = 0; j < 8; j++) {
+            bool bit = ((crc >> 31) ^ byte) & 0x01;
+            crc <<= 1;
+            if (bit) {
+                crc ^= 0x04C11DB7;
+            }
+            byte >>= 1;
+        }
+    }
+    uint8_t index = (crc >> 23) & 0x3F;
+    return m->regs[1][(ENC28J60_EHT0 & 0x1F) + (index >> 3)] & (1 << (index & 0x07));
+}
+
+static bool model_pattern_match(enc28j60_model_t *m, const uint8_t *frame, uint32_t length)
+{
+    uint16_t offset = model_reg16(m, ENC28J60_EPMOL);
+    if (offset + 64 > length) {
+        return false;
+    }
+    uint32_t sum = 0;
+    bool high_byte = true;
+    for (int i = 0; i < 64; i++) {
+        if (m->regs[1][(ENC28J60_EPMM0 & 0x1F) + (i >> 3)] & (1 << (i & 0x07))) {
+            sum += high_byte ? frame[offset + i] << 8 : frame[offset + i];
+            high_byte = !high_byte;
+        }
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    uint16_t checksum = m->regs[1][ENC28J60_EPMCSL & 0x1F] | (m->regs[1][ENC28J60_EPMCSH & 0x1F] << 8);
+    return (uint16_t)~sum == checksum;
+}
+
+static bool model_rx_filter(enc28j60_model_t *m, const uint8_t *frame, uint32_t length)
+{
+    uint8_t erxfcon = m->regs[1][ENC28J60_ERXFCON & 0x1F];
+    const uint8_t *dest = frame;
+    const uint8_t maadr[6] = {
+        m->regs[3][ENC28J60_MAADR1 & 0x1F], m->regs[3][ENC28J60_MAADR2 & 0x1F], m->regs[3][ENC28J60_MAADR3 & 0x1F],
+        m->regs[3][ENC28J60_MAADR4 & 0x1F], m->regs[3][ENC28J60_MAADR5 & 0x1F], m->regs[3][ENC28J60_MAADR6 & 0x1F],
+    };
+    bool broadcast = memcmp(dest, "\xff\xff\xff\xff\xff\xff", 6) == 0;
+    struct {
+        uint8_t bit;
+        bool match;
+    } filters[] = {
+        { ERXFCON_UCEN, memcmp(dest, maadr, 6) == 0 },
+        { ERXFCON_PMEN, (erxfcon & ERXFCON_PMEN) && model_pattern_match(m, frame, length) },
+        { ERXFCON_MPEN, false }, // magic packets are not modelled
+        { ERXFCON_HTEN, (erxfcon & ERXFCON_HTEN) && model_hash_match(m, dest) },
+        { ERXFCON_MCEN, dest[0] & 0x01 },
+        { ERXFCON_BCEN, broadcast },
+    };
+    bool any_enabled = false;
+    bool any = false;
+    bool all = true;
+    for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+        if (erxfcon & filters[i].bit) {
+            any_enabled = true;
+            any |= filters[i].match;
+            all &= filters[i].match;
+        }
+    }
+    if (!any_enabled) {
+        return true; // promiscuous
+    }
+    return (erxfcon & ERXFCON_ANDOR) ? all : any;
+}
+
+bool enc28j60_model_receive(enc28j60_model_t *model, const uint8_t *frame, uint32_t length)
+{
+    enc28j60_model_t *m = model;
+    bool stored = false;
+    pthread_mutex_lock(&m->lock);
+    if (!(m->econ1 & ECON1_RXEN) || !(m->regs[2][ENC28J60_MACON1 & 0x1F] & MACON1_MARXEN)) {
+        m->stats.rx_disabled++;
+        goto out;
+    }
+    if (length < 6 || !model_rx_filter(m, frame, length)) {
+        m->stats.rx_filtered++;
+        goto out;
+    }
+    uint16_t start = model_reg16(m, ENC28J60_ERXSTL);
+    uint16_t end = model_reg16(m, ENC28J60_ERXNDL);
+    uint32_t size = end >= start ? end - start + 1 : 0;
+    uint32_t byte_count = length + 4; // with FCS
+    uint32_t need = (MODEL_RSV_SIZE + byte_count + 1) & ~1; // the next packet starts at an even address
+    uint32_t free_space = 0;
+    if (size && m->erxrdpt >= start && m->erxrdpt <= end && m->erxwrpt >= start && m->erxwrpt <= end) {
+        // the receiver writes up to ERXRDPT, excluding it
+        free_space = (m->erxrdpt - m->erxwrpt + size) % size;
+    }
+    if (need > free_space || m->epktcnt == 255) {
+        m->eir |= EIR_RXERIF;
+        m->estat |= ESTAT_BUFER;
+        m->stats.rx_overflows++;
+        goto out_int;
+    }
+    uint16_t next = start + (m->erxwrpt - start + need) % size;
+    uint8_t rsv[MODEL_RSV_SIZE] = { next & 0xFF, next >> 8, byte_count & 0xFF, byte_count >> 8, RSV_RX_OK, 0 };
+    if (frame[0] & 0x01) {
+        rsv[5] |= memcmp(frame, "\xff\xff\xff\xff\xff\xff", 6) == 0 ? RSV_BROADCAST : RSV_MULTICAST;
+    }
+    uint32_t fcs = model_crc32(frame, length);
+    uint8_t fcs_bytes[4] = { fcs & 0xFF, (fcs >> 8) & 0xFF, (fcs >> 16) & 0xFF, fcs >> 24 };
+    uint16_t addr = m->erxwrpt;
+    for (uint32_t i = 0; i < MODEL_RSV_SIZE + byte_count; i++) {
+        uint8_t byte;
+        if (i < MODEL_RSV_SIZE) {
+            byte = rsv[i];
+        } else if (i < MODEL_RSV_SIZE + length) {
+            byte = frame[i - MODEL_RSV_SIZE];
+        } else {
+            byte = fcs_bytes[i - MODEL_RSV_SIZE - length];
+        }
+        m->mem[addr] = byte;
+        addr = addr == end ? start : addr + 1;
+    }
+    m->erxwrpt = next;
+    m->epktcnt++;
+    m->stats.rx_frames++;
+    stored = true;
+out_int:
+    model_update_int(m);
+out:
+    pthread_mutex_unlock(&m->lock);
+    return stored;
+}
+
+bool enc28j60_model_idle(enc28j60_model_t *model)
+{
+    pthread_mutex_lock(&model->lock);
+    bool idle = !model->tx_pending && !(model->econ1 & ECON1_TXRTS) && (model->eie & EIE_INTIE) &&
+                !(model_eir(model) & model->eie & EIE_SOURCES);
+    pthread_mutex_unlock(&model->lock);
+    return idle;
+}
+
+void enc28j60_model_get_stats(enc28j60_model_t *model, enc28j60_model_stats_t *stats)
+{
+    pthread_mutex_lock(&model->lock);
+    *stats = model->stats;
+    pthread_mutex_unlock(&model->lock);
+}
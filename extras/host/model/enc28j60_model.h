@@ -0,0 +1,83 @@
+/*
+ * Register and buffer model of the ENC28J60 for the host build of the driver.
+ *
+ * The model is driven by the SPI accesses of the driver and by frames from the wire. It has
+ * the banked control registers, the 8 KB buffer with the circular RX buffer, RSV and TSV,
+ * EPKTCNT, ERXRDPT latched by the high byte write, TXRTS/TXIF/TXERIF, the DMA checksum,
+ * the MII registers, the receive filters and the INT pin. It counts SPI transactions and
+ * bytes like the chip sees them: the opcode byte and the data bytes.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct enc28j60_model enc28j60_model_t;
+
+/**
+ * @brief Called when the chip transmits a frame (without FCS, padded to 60 bytes)
+ * @return time in us the frame occupies the wire, TXIF is set after it
+ */
+typedef uint32_t (*enc28j60_model_tx_cb_t)(void *ctx, const uint8_t *frame, uint32_t length);
+
+typedef struct {
+    int int_gpio_num;                   /*!< GPIO driven by the INT pin, -1 if not connected */
+    uint8_t revision;                   /*!< EREVID value, 0 for B7 */
+    enc28j60_model_tx_cb_t transmit;    /*!< Wire of the chip, NULL to drop the frames after the time at 10 Mbps */
+    void *transmit_ctx;                 /*!< Argument of transmit */
+    uint32_t tx_error_every;            /*!< Errata #12/#13: every n-th transmit aborts with a late collision, 0 never */
+} enc28j60_model_config_t;
+
+typedef struct {
+    uint32_t spi_transactions;          /*!< SPI transactions, one opcode each */
+    uint64_t spi_bytes;                 /*!< SPI bytes, opcode included */
+    uint32_t bank_switches;             /*!< Writes of ECON1 which changed the bank */
+    uint32_t rx_frames;                 /*!< Frames stored in the RX buffer */
+    uint32_t rx_filtered;               /*!< Frames dropped by the receive filters */
+    uint32_t rx_overflows;              /*!< Frames dropped for a full RX buffer or EPKTCNT at 255 (RXERIF) */
+    uint32_t rx_disabled;               /*!< Frames dropped while the receiver was disabled */
+    uint32_t tx_frames;                 /*!< Frames transmitted */
+    uint32_t tx_errors;                 /*!< Transmits aborted with TXERIF */
+    uint32_t even_erxrdpt;              /*!< Errata #14: ERXRDPT latched with an even value, may corrupt the RX buffer */
+    uint32_t invalid_accesses;          /*!< SPI accesses the chip doesn't support, e.g. RCR of a MAC register with one byte */
+} enc28j60_model_stats_t;
+
+/**
+ * @brief Create the model, in the state after power-on reset
+ */
+enc28j60_model_t *enc28j60_model_new(const enc28j60_model_config_t *config);
+
+void enc28j60_model_delete(enc28j60_model_t *model);
+
+/**
+ * @brief One SPI transaction, arguments as in the read and write hooks of eth_spi_custom_driver_config_t
+ *
+ * @param cmd opcode (RCR, RBM, WCR, WBM, BFS, BFC, SRC)
+ * @param addr register address in the selected bank
+ * @param data written data or buffer for the read data
+ * @param len data length
+ */
+esp_err_t enc28j60_model_spi(enc28j60_model_t *model, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len);
+
+/**
+ * @brief Frame from the wire, without FCS
+ * @return true if the frame was stored in the RX buffer
+ */
+bool enc28j60_model_receive(enc28j60_model_t *model, const uint8_t *frame, uint32_t length);
+
+/**
+ * @brief No transmit in progress, no interrupt flag pending with its interrupt enabled and INTIE set,
+ *        so the driver has finished all work the chip gave it
+ */
+bool enc28j60_model_idle(enc28j60_model_t *model);
+
+void enc28j60_model_get_stats(enc28j60_model_t *model, enc28j60_model_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,457 @@
+/*
+ * Register and buffer model of the W5500 in MACRAW mode, see w5500_model.h.
+ * The behaviour follows the W5500 datasheet (version 1.1.0).
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "driver/gpio.h"
+#include "w5500_model.h"
+
+#define MODEL_SOCKETS (8)
+#define MODEL_COMMON_SIZE (0x40)
+#define MODEL_SOCKET_REG_SIZE (0x30)
+#define MODEL_BUF_SIZE (16 * 1024)
+#define MODEL_MIN_FRAME (60)
+#define MODEL_MAX_FRAME (1514)
+#define MODEL_VERSION (0x04)
+#define MODEL_PHYCFGR_DEFAULT (0xBF) // no reset, all capable auto-negotiation, full duplex, 100 Mbps, link up
+
+// control byte
+#define CTRL_BSB_SHIFT (3)
+#define CTRL_RWB (1 << 2)
+#define CTRL_OM_MASK (0x03)
+
+#define BSB_COMMON (0)
+#define BSB_REG(bsb) (((bsb) & 0x03) == 1)
+#define BSB_TX_BUF(bsb) (((bsb) & 0x03) == 2)
+#define BSB_RX_BUF(bsb) (((bsb) & 0x03) == 3)
+#define BSB_SOCKET(bsb) ((bsb) >> 2)
+
+// common registers
+#define MR      (0x00)
+#define SHAR    (0x09)
+#define IR      (0x15)
+#define IMR     (0x16)
+#define SIR     (0x17)
+#define SIMR    (0x18)
+#define PHYCFGR (0x2E)
+#define VERSIONR (0x39)
+
+#define MR_RST (1 << 7)
+
+// socket registers
+#define Sn_MR         (0x00)
+#define Sn_CR         (0x01)
+#define Sn_IR         (0x02)
+#define Sn_SR         (0x03)
+#define Sn_RXBUF_SIZE (0x1E)
+#define Sn_TXBUF_SIZE (0x1F)
+#define Sn_TX_FSR     (0x20)
+#define Sn_TX_RD      (0x22)
+#define Sn_TX_WR      (0x24)
+#define Sn_RX_RSR     (0x26)
+#define Sn_RX_RD      (0x28)
+#define Sn_RX_WR      (0x2A)
+#define Sn_IMR        (0x2C)
+
+#define Sn_MR_MACRAW (0x04)
+#define Sn_MR_MIP6B  (1 << 4)
+#define Sn_MR_MMB    (1 << 5)
+#define Sn_MR_BCASTB (1 << 6)
+#define Sn_MR_MFEN   (1 << 7)
+
+#define Sn_CR_OPEN  (0x01)
+#define Sn_CR_CLOSE (0x10)
+#define Sn_CR_SEND  (0x20)
+#define Sn_CR_RECV  (0x40)
+
+#define Sn_IR_RECV    (1 << 2)
+#define Sn_IR_SEND_OK (1 << 4)
+
+#define Sn_SR_CLOSED (0x00)
+#define Sn_SR_MACRAW (0x42)
+
+struct w5500_model {
+    pthread_mutex_t lock;
+    w5500_model_config_t config;
+    uint8_t common[MODEL_COMMON_SIZE];
+    uint8_t sockets[MODEL_SOCKETS][MODEL_SOCKET_REG_SIZE];
+    uint16_t tx_rd;             /*!< socket 0 pointers, free running like in the chip */
+    uint16_t tx_wr;
+    uint16_t rx_rd;             /*!< RX_RD register, the driver's read pointer */
+    uint16_t rx_rd_done;        /*!< RX_RD at the last RECV command, the chip frees the buffer up to it */
+    uint16_t rx_wr;
+    int int_level;
+    uint8_t tx_buf[MODEL_BUF_SIZE];
+    uint8_t rx_buf[MODEL_BUF_SIZE];
+    w5500_model_stats_t stats;
+};
+
+/**
+ * @brief Size of a socket 0 buffer in bytes, from Sn_RXBUF_SIZE or Sn_TXBUF_SIZE in KB
+ */
+static uint16_t model_buf_size(w5500_model_t *m, uint8_t reg)
+{
+    uint8_t kb = m->sockets[0][reg];
+    if (kb != 1 && kb != 2 && kb != 4 && kb != 8 && kb != 16) {
+        return 0; // socket 0 has no memory
+    }
+    return kb * 1024;
+}
+
+static uint16_t model_tx_fsr(w5500_model_t *m)
+{
+    return model_buf_size(m, Sn_TXBUF_SIZE) - (uint16_t)(m->tx_wr - m->tx_rd);
+}
+
+static uint16_t model_rx_rsr(w5500_model_t *m)
+{
+    return m->rx_wr - m->rx_rd_done;
+}
+
+static uint8_t model_sir(w5500_model_t *m)
+{
+    uint8_t sir = 0;
+    for (int s = 0; s < MODEL_SOCKETS; s++) {
+        if (m->sockets[s][Sn_IR] & m->sockets[s][Sn_IMR]) {
+            sir |= 1 << s;
+        }
+    }
+    return sir;
+}
+
+static inline bool model_int_asserted(w5500_model_t *m)
+{
+    return (model_sir(m) & m->common[SIMR]) || (m->common[IR] & m->common[IMR]);
+}
+
+static void model_update_int(w5500_model_t *m)
+{
+    int level = model_int_asserted(m) ? 0 : 1; // active low
+    if (level != m->int_level) {
+        m->int_level = level;
+        if (m->config.int_gpio_num >= 0) {
+            host_gpio_set_level(m->config.int_gpio_num, level);
+        }
+    }
+}
+
+static void model_reset(w5500_model_t *m)
+{
+    memset(m->common, 0, sizeof(m->common));
+    memset(m->sockets, 0, sizeof(m->sockets));
+    m->common[0x19] = 0x07; // RTR 200 ms
+    m->common[0x1A] = 0xD0;
+    m->common[0x1B] = 0x08; // RCR
+    m->common[PHYCFGR] = MODEL_PHYCFGR_DEFAULT;
+    for (int s = 0; s < MODEL_SOCKETS; s++) {
+        m->sockets[s][Sn_RXBUF_SIZE] = 2;
+        m->sockets[s][Sn_TXBUF_SIZE] = 2;
+        m->sockets[s][Sn_IMR] = 0xFF;
+    }
+    m->tx_rd = 0;
+    m->tx_wr = 0;
+    m->rx_rd = 0;
+    m->rx_rd_done = 0;
+    m->rx_wr = 0;
+}
+
+static uint8_t model_common_read(w5500_model_t *m, uint16_t addr)
+{
+    switch (addr) {
+    case SIR: return model_sir(m);
+    case VERSIONR: return MODEL_VERSION;
+    default: break;
+    }
+    return addr < MODEL_COMMON_SIZE ? m->common[addr] : 0;
+}
+
+static void model_common_write(w5500_model_t *m, uint16_t addr, uint8_t value)
+{
+    if (addr >= MODEL_COMMON_SIZE) {
+        m->stats.invalid_accesses++;
+        return;
+    }
+    switch (addr) {
+    case MR:
+        if (value & MR_RST) {
+            model_reset(m); // the reset completes before the next SPI access, RST reads as 0
+            return;
+        }
+        break;
+    case IR:
+        m->common[IR] &= ~value; // write 1 to clear
+        return;
+    case SIR:
+    case VERSIONR:
+        return; // read only
+    case PHYCFGR:
+        value |= 0x07 & m->common[PHYCFGR]; // the link status bits are read only
+        break;
+    default:
+        break;
+    }
+    m->common[addr] = value;
+}
+
+static uint8_t model_socket_read(w5500_model_t *m, uint8_t s, uint16_t addr)
+{
+    if (addr >= MODEL_SOCKET_REG_SIZE) {
+        return 0;
+    }
+    if (s == 0) {
+        uint16_t value16;
+        switch (addr & ~1) {
+        case Sn_TX_FSR: value16 = model_tx_fsr(m); break;
+        case Sn_TX_RD: value16 = m->tx_rd; break;
+        case Sn_TX_WR: value16 = m->tx_wr; break;
+        case Sn_RX_RSR: value16 = model_rx_rsr(m); break;
+        case Sn_RX_RD: value16 = m->rx_rd; break;
+        case Sn_RX_WR: value16 = m->rx_wr; break;
+        default: return m->sockets[0][addr];
+        }
+        return (addr & 1) ? value16 & 0xFF : value16 >> 8; // big endian
+    }
+    return m->sockets[s][addr];
+}
+
+static void model_send(w5500_model_t *m)
+{
+    uint8_t frame[MODEL_MAX_FRAME];
+    uint16_t size = model_buf_size(m, Sn_TXBUF_SIZE);
+    uint16_t length = m->tx_wr - m->tx_rd;
+    if (!size || length > size) {
+        m->stats.invalid_accesses++;
+        return;
+    }
+    if (length > sizeof(frame)) {
+        length = sizeof(frame); // the MAC sends at most a maximum frame
+    }
+    for (uint16_t i = 0; i < length; i++) {
+        frame[i] = m->tx_buf[(uint16_t)(m->tx_rd + i) & (size - 1)];
+    }
+    if (length < MODEL_MIN_FRAME) {
+        memset(frame + length, 0, MODEL_MIN_FRAME - length);
+        length = MODEL_MIN_FRAME;
+    }
+    if (m->config.transmit) {
+        m->config.transmit(m->config.transmit_ctx, frame, length);
+    }
+    // the buffer is free when the frame is in the MAC, SEND_OK doesn't wait for the wire
+    m->tx_rd = m->tx_wr;
+    m->sockets[0][Sn_IR] |= Sn_IR_SEND_OK;
+    m->stats.tx_frames++;
+}
+
+static void model_command(w5500_model_t *m, uint8_t s, uint8_t command)
+{
+    uint8_t *regs = m->sockets[s];
+    switch (command) {
+    case Sn_CR_OPEN:
+        if (s == 0 && (regs[Sn_MR] & 0x0F) == Sn_MR_MACRAW) {
+            regs[Sn_SR] = Sn_SR_MACRAW;
+            m->tx_rd = m->tx_wr = 0;
+            m->rx_rd = m->rx_rd_done = m->rx_wr = 0;
+        } else {
+            m->stats.invalid_accesses++; // only the MACRAW mode of socket 0 is modelled
+        }
+        break;
+    case Sn_CR_CLOSE:
+        regs[Sn_SR] = Sn_SR_CLOSED;
+        break;
+    case Sn_CR_SEND:
+        if (s == 0 && regs[Sn_SR] == Sn_SR_MACRAW) {
+            model_send(m);
+        }
+        break;
+    case Sn_CR_RECV:
+        if (s == 0 && regs[Sn_SR] == Sn_SR_MACRAW) {
+            m->rx_rd_done = m->rx_rd;
+        }
+        break;
+    default:
+        m->stats.invalid_accesses++;
+        break;
+    }
+    // the command completes before the next SPI access, Sn_CR reads as 0
+}
+
+static void model_socket_write(w5500_model_t *m, uint8_t s, uint16_t addr, uint8_t value)
+{
+    if (addr >= MODEL_SOCKET_REG_SIZE) {
+        m->stats.invalid_accesses++;
+        return;
+    }
+    switch (addr) {
+    case Sn_CR:
+        model_command(m, s, value);
+        return;
+    case Sn_IR:
+        m->sockets[s][Sn_IR] &= ~value; // write 1 to clear
+        return;
+    case Sn_SR:
+    case Sn_TX_FSR:
+    case Sn_TX_FSR + 1:
+    case Sn_TX_RD:
+    case Sn_TX_RD + 1:
+    case Sn_RX_RSR:
+    case Sn_RX_RSR + 1:
+    case Sn_RX_WR:
+    case Sn_RX_WR + 1:
+        return; // read only
+    default:
+        break;
+    }
+    if (s == 0) {
+        switch (addr) {
+        case Sn_TX_WR: m->tx_wr = (m->tx_wr & 0x00FF) | (value << 8); return;
+        case Sn_TX_WR + 1: m->tx_wr = (m->tx_wr & 0xFF00) | value; return;
+        case Sn_RX_RD: m->rx_rd = (m->rx_rd & 0x00FF) | (value << 8); return;
+        case Sn_RX_RD + 1: m->rx_rd = (m->rx_rd & 0xFF00) | value; return;
+        default: break;
+        }
+    }
+    m->sockets[s][addr] = value;
+}
+
+w5500_model_t *w5500_model_new(const w5500_model_config_t *config)
+{
+    w5500_model_t *m = calloc(1, sizeof(w5500_model_t));
+    if (!m) {
+        return NULL;
+    }
+    m->config = *config;
+    pthread_mutex_init(&m->lock, NULL);
+    model_reset(m);
+    m->int_level = 1;
+    if (m->config.int_gpio_num >= 0) {
+        host_gpio_set_level(m->config.int_gpio_num, 1);
+    }
+    return m;
+}
+
+void w5500_model_delete(w5500_model_t *model)
+{
+    pthread_mutex_destroy(&model->lock);
+    free(model);
+}
+
+esp_err_t w5500_model_spi(w5500_model_t *model, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len)
+{
+    w5500_model_t *m = model;
+    esp_err_t ret = ESP_OK;
+    uint8_t bsb = (addr >> CTRL_BSB_SHIFT) & 0x1F;
+    uint8_t socket = BSB_SOCKET(bsb);
+    uint16_t offset = cmd & 0xFFFF;
+    pthread_mutex_lock(&m->lock);
+    m->stats.spi_transactions++;
+    m->stats.spi_bytes += 3 + len;
+    if (!(addr & CTRL_RWB) != !write || (addr & CTRL_OM_MASK) || (bsb != BSB_COMMON && (bsb & 0x03) == 0)) {
+        // direction doesn't match RWB, fixed length data mode or a reserved block
+        m->stats.invalid_accesses++;
+        ret = ESP_ERR_INVALID_ARG;
+        goto out;
+    }
+    if (BSB_TX_BUF(bsb) || BSB_RX_BUF(bsb)) {
+        uint16_t size = model_buf_size(m, BSB_TX_BUF(bsb) ? Sn_TXBUF_SIZE : Sn_RXBUF_SIZE);
+        uint8_t *buf = BSB_TX_BUF(bsb) ? m->tx_buf : m->rx_buf;
+        if (socket != 0 || !size) {
+            m->stats.invalid_accesses++; // the sockets other than 0 have no memory in the model
+            ret = ESP_ERR_INVALID_ARG;
+            goto out;
+        }
+        // the address wraps in the socket buffer
+        for (uint32_t i = 0; i < len; i++) {
+            uint16_t index = (uint16_t)(offset + i) & (size - 1);
+            if (write) {
+                buf[index] = data[i];
+            } else {
+                data[i] = buf[index];
+            }
+        }
+    } else {
+        for (uint32_t i = 0; i < len; i++) {
+            uint16_t reg = offset + i;
+            if (bsb == BSB_COMMON) {
+                if (write) {
+                    model_common_write(m, reg, data[i]);
+                } else {
+                    data[i] = model_common_read(m, reg);
+                }
+            } else if (write) {
+                model_socket_write(m, socket, reg, data[i]);
+            } else {
+                data[i] = model_socket_read(m, socket, reg);
+            }
+        }
+    }
+    model_update_int(m);
+out:
+    pthread_mutex_unlock(&m->lock);
+    return ret;
+}
+
+static bool model_rx_filter(w5500_model_t *m, const uint8_t *dest)
+{
+    uint8_t mode = m->sockets[0][Sn_MR];
+    if (!(mode & Sn_MR_MFEN)) {
+        return true;
+    }
+    if (memcmp(dest, "\xff\xff\xff\xff\xff\xff", 6) == 0) {
+        return !(mode & Sn_MR_BCASTB);
+    }
+    if (dest[0] & 0x01) {
+        return !(mode & Sn_MR_MMB);
+    }
+    return memcmp(dest, &m->common[SHAR], 6) == 0;
+}
+
+bool w5500_model_receive(w5500_model_t *model, const uint8_t *frame, uint32_t length)
+{
+    w5500_model_t *m = model;
+    bool stored = false;
+    pthread_mutex_lock(&m->lock);
+    uint16_t size = model_buf_size(m, Sn_RXBUF_SIZE);
+    if (m->sockets[0][Sn_SR] != Sn_SR_MACRAW || !size) {
+        m->stats.rx_disabled++;
+        goto out;
+    }
+    if (length < 6 || !model_rx_filter(m, frame)) {
+        m->stats.rx_filtered++;
+        goto out;
+    }
+    uint32_t need = length + 2; // PACKET-INFO: the length of the data with the 2 bytes of itself
+    if (need > (uint32_t)(size - model_rx_rsr(m))) {
+        m->stats.rx_overflows++;
+        goto out;
+    }
+    m->rx_buf[m->rx_wr & (size - 1)] = need >> 8;
+    m->rx_buf[(uint16_t)(m->rx_wr + 1) & (size - 1)] = need & 0xFF;
+    for (uint32_t i = 0; i < length; i++) {
+        m->rx_buf[(uint16_t)(m->rx_wr + 2 + i) & (size - 1)] = frame[i];
+    }
+    m->rx_wr += need;
+    m->sockets[0][Sn_IR] |= Sn_IR_RECV;
+    m->stats.rx_frames++;
+    stored = true;
+    model_update_int(m);
+out:
+    pthread_mutex_unlock(&m->lock);
+    return stored;
+}
+
+bool w5500_model_idle(w5500_model_t *model)
+{
+    pthread_mutex_lock(&model->lock);
+    bool idle = model_rx_rsr(model) == 0 && model->sockets[0][Sn_IR] == 0 && model->int_level == 1;
+    pthread_mutex_unlock(&model->lock);
+    return idle;
+}
+
+void w5500_model_get_stats(w5500_model_t *model, w5500_model_stats_t *stats)
+{
+    pthread_mutex_lock(&model->lock);
+    *stats = model->stats;
+    pthread_mutex_unlock(&model->lock);
+}
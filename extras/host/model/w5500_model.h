@@ -0,0 +1,78 @@
+/*
+ * Register and buffer model of the W5500 in MACRAW mode for the host build of the drivers.
+ *
+ * The model has the common registers, socket 0 with the 16 KB RX and TX buffers, the free
+ * running RX_RD/RX_WR and TX_RD/TX_WR pointers with RX_RSR and TX_FSR, the OPEN, SEND, RECV and
+ * CLOSE commands, the MAC filter of MACRAW mode and the INT pin. Sockets 1-7 keep their
+ * registers but have no buffers. It counts SPI transactions and bytes like the chip sees them:
+ * the 3 header bytes (address and control byte) and the data bytes.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct w5500_model w5500_model_t;
+
+/**
+ * @brief Called when the chip transmits a frame (without FCS, padded to 60 bytes)
+ * @return time in us the frame occupies the wire, unused by the model
+ */
+typedef uint32_t (*w5500_model_tx_cb_t)(void *ctx, const uint8_t *frame, uint32_t length);
+
+typedef struct {
+    int int_gpio_num;                   /*!< GPIO driven by the INT pin, -1 if not connected */
+    w5500_model_tx_cb_t transmit;       /*!< Wire of the chip, NULL to drop the frames */
+    void *transmit_ctx;                 /*!< Argument of transmit */
+} w5500_model_config_t;
+
+typedef struct {
+    uint32_t spi_transactions;          /*!< SPI transactions, one header each */
+    uint64_t spi_bytes;                 /*!< SPI bytes, header included */
+    uint32_t rx_frames;                 /*!< Frames stored in the RX buffer */
+    uint32_t rx_filtered;               /*!< Frames dropped by the MAC filter */
+    uint32_t rx_overflows;              /*!< Frames dropped for a full RX buffer */
+    uint32_t rx_disabled;               /*!< Frames dropped while socket 0 wasn't open */
+    uint32_t tx_frames;                 /*!< Frames transmitted */
+    uint32_t invalid_accesses;          /*!< SPI accesses the chip doesn't support, e.g. a reserved block */
+} w5500_model_stats_t;
+
+/**
+ * @brief Create the model, in the state after power-on reset
+ */
+w5500_model_t *w5500_model_new(const w5500_model_config_t *config);
+
+void w5500_model_delete(w5500_model_t *model);
+
+/**
+ * @brief One SPI transaction, arguments as in the read and write hooks of eth_spi_custom_driver_config_t
+ *
+ * @param cmd 16-bit offset address
+ * @param addr control byte: block select in bits 7-3, RWB in bit 2, operation mode in bits 1-0
+ * @param data written data or buffer for the read data
+ * @param len data length
+ */
+esp_err_t w5500_model_spi(w5500_model_t *model, bool write, uint32_t cmd, uint32_t addr, uint8_t *data, uint32_t len);
+
+/**
+ * @brief Frame from the wire, without FCS
+ * @return true if the frame was stored in the RX buffer
+ */
+bool w5500_model_receive(w5500_model_t *model, const uint8_t *frame, uint32_t length);
+
+/**
+ * @brief No command pending, socket 0 has no received data and the INT pin is released,
+ *        so the driver has finished all work the chip gave it
+ */
+bool w5500_model_idle(w5500_model_t *model);
+
+void w5500_model_get_stats(w5500_model_t *model, w5500_model_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Host shim of the Arduino core parts which EthDriver.h uses: Print, SPIClass and the pin
+ * functions, and the FreeRTOS task API which Arduino.h includes. They do nothing, the host
+ * build doesn't run the SPIClass backend.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SS 5
+#define OUTPUT 0x03
+#define HIGH 0x1
+
+#define log_w(format, ...) ESP_LOGW("arduino", format, ##__VA_ARGS__)
+
+class Print {
+};
+
+class SPIClass {
+public:
+  void begin() {
+  }
+};
+
+extern SPIClass SPI;
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t val) {
+}
@@ -0,0 +1,443 @@
+/*
+ * ESP-IDF services on the host: logging, esp_timer, GPIO levels and interrupts, heap_caps,
+ * delays and the CPU cycle counter. The SPI master driver is not available, the drivers
+ * must be created with a custom SPI driver.
+ */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "esp_heap_caps.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+
+static int64_t host_time_ns(void)
+{
+    static int64_t s_start;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    if (!s_start) {
+        s_start = now - 1;
+    }
+    return now - s_start;
+}
+
+__attribute__((constructor)) static void host_time_init(void)
+{
+    host_time_ns();
+}
+
+/* logging */
+
+static esp_log_level_t s_log_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag; // one level for all tags
+    s_log_level = level;
+}
+
+void host_log(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "NEWIDV";
+    if (level > s_log_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(host_time_ns() / 1000000), tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+/* esp_timer, all callbacks run in one thread */
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    bool skip_unhandled_events;
+    bool armed;
+    int64_t alarm;     /*!< us */
+    uint64_t period;   /*!< us, 0 for one shot */
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t s_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_timer_cond;
+static pthread_t s_timer_thread;
+static bool s_timer_started;
+static struct esp_timer *s_timers;
+static struct esp_timer *s_timer_running;
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_ns() / 1000;
+}
+
+static void *host_timer_thread(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&s_timer_lock);
+    while (1) {
+        struct esp_timer *due = NULL;
+        for (struct esp_timer *t = s_timers; t; t = t->next) {
+            if (t->armed && (!due || t->alarm < due->alarm)) {
+                due = t;
+            }
+        }
+        if (!due) {
+            pthread_cond_wait(&s_timer_cond, &s_timer_lock);
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (due->alarm > now) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            int64_t ns = ts.tv_nsec + (due->alarm - now) * 1000;
+            ts.tv_sec += ns / 1000000000;
+            ts.tv_nsec = ns % 1000000000;
+            pthread_cond_timedwait(&s_timer_cond, &s_timer_lock, &ts);
+            continue; // the timers may have changed
+        }
+        if (due->period) {
+            due->alarm += due->period;
+            if (due->skip_unhandled_events && due->alarm < now) {
+                due->alarm = now + due->period;
+            }
+        } else {
+            due->armed = false;
+        }
+        s_timer_running = due;
+        pthread_mutex_unlock(&s_timer_lock);
+        due->callback(due->arg);
+        pthread_mutex_lock(&s_timer_lock);
+        s_timer_running = NULL;
+        pthread_cond_broadcast(&s_timer_cond);
+    }
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *timer = calloc(1, sizeof(struct esp_timer));
+    if (!timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    timer->name = create_args->name;
+    timer->skip_unhandled_events = create_args->skip_unhandled_events;
+    pthread_mutex_lock(&s_timer_lock);
+    if (!s_timer_started) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&s_timer_cond, &attr);
+        pthread_condattr_destroy(&attr);
+        pthread_create(&s_timer_thread, NULL, host_timer_thread, NULL);
+        pthread_detach(s_timer_thread);
+        s_timer_started = true;
+    }
+    timer->next = s_timers;
+    s_timers = timer;
+    pthread_mutex_unlock(&s_timer_lock);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t host_timer_start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_timer_lock);
+    if (timer->armed) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        timer->alarm = esp_timer_get_time() + timeout_us;
+        timer->period = period;
+        timer->armed = true;
+        pthread_cond_broadcast(&s_timer_cond);
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    return ret;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return host_timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return host_timer_start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_timer_lock);
+    if (!timer->armed) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    pthread_mutex_unlock(&s_timer_lock);
+    return ret;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_timer_lock);
+    if (timer->armed) {
+        pthread_mutex_unlock(&s_timer_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    // wait for a running callback, unless it deletes its own timer
+    while (s_timer_running == timer && !pthread_equal(pthread_self(), s_timer_thread)) {
+        pthread_cond_wait(&s_timer_cond, &s_timer_lock);
+    }
+    for (struct esp_timer **t = &s_timers; *t; t = &(*t)->next) {
+        if (*t == timer) {
+            *t = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_timer_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&s_timer_lock);
+    bool armed = timer->armed;
+    pthread_mutex_unlock(&s_timer_lock);
+    return armed;
+}
+
+/* GPIO */
+
+typedef struct {
+    int level;
+    gpio_int_type_t intr_type;
+    bool intr_enabled;
+    gpio_isr_t isr;
+    void *isr_arg;
+} host_gpio_t;
+
+static pthread_mutex_t s_gpio_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_gpio_t s_gpio[GPIO_NUM_MAX];
+
+static bool host_gpio_valid(gpio_num_t gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < GPIO_NUM_MAX;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    if (!host_gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_gpio_lock);
+    s_gpio[gpio_num].intr_type = GPIO_INTR_DISABLE;
+    s_gpio[gpio_num].intr_enabled = false;
+    pthread_mutex_unlock(&s_gpio_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    (void)mode;
+    return host_gpio_valid(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+    (void)pull; // the harness drives the inputs
+    return host_gpio_valid(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+    if (!host_gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_gpio_lock);
+    s_gpio[gpio_num].intr_type = intr_type;
+    pthread_mutex_unlock(&s_gpio_lock);
+    return ESP_OK;
+}
+
+static esp_err_t host_gpio_intr_set(gpio_num_t gpio_num, bool enabled)
+{
+    if (!host_gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_gpio_lock);
+    s_gpio[gpio_num].intr_enabled = enabled;
+    pthread_mutex_unlock(&s_gpio_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    return host_gpio_intr_set(gpio_num, true);
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+{
+    return host_gpio_intr_set(gpio_num, false);
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    if (!host_gpio_valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_gpio_lock);
+    s_gpio[gpio_num].isr = isr_handler;
+    s_gpio[gpio_num].isr_arg = args;
+    pthread_mutex_unlock(&s_gpio_lock);
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    return gpio_isr_handler_add(gpio_num, NULL, NULL);
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (!host_gpio_valid(gpio_num)) {
+        return 0;
+    }
+    pthread_mutex_lock(&s_gpio_lock);
+    int level = s_gpio[gpio_num].level;
+    pthread_mutex_unlock(&s_gpio_lock);
+    return level;
+}
+
+void host_gpio_set_level(gpio_num_t gpio_num, int level)
+{
+    if (!host_gpio_valid(gpio_num)) {
+        return;
+    }
+    gpio_isr_t isr = NULL;
+    void *isr_arg = NULL;
+    pthread_mutex_lock(&s_gpio_lock);
+    host_gpio_t *pin = &s_gpio[gpio_num];
+    int old = pin->level;
+    pin->level = level != 0;
+    bool fire = false;
+    switch (pin->intr_type) {
+    case GPIO_INTR_POSEDGE: fire = !old && pin->level; break;
+    case GPIO_INTR_NEGEDGE: fire = old && !pin->level; break;
+    case GPIO_INTR_ANYEDGE: fire = old != pin->level; break;
+    case GPIO_INTR_LOW_LEVEL: fire = !pin->level; break;
+    case GPIO_INTR_HIGH_LEVEL: fire = pin->level; break;
+    default: break;
+    }
+    if (fire && pin->intr_enabled) {
+        isr = pin->isr;
+        isr_arg = pin->isr_arg;
+    }
+    pthread_mutex_unlock(&s_gpio_lock);
+    if (isr) {
+        isr(isr_arg);
+    }
+}
+
+/* heap, delay, CPU */
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    int64_t end = host_time_ns() + (int64_t)us * 1000;
+    if (us >= 100) {
+        struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+        while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+    }
+    while (host_time_ns() < end); // busy wait like the ROM function for short delays
+}
+
+int esp_cpu_get_core_id(void)
+{
+    return 0;
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+    return (uint32_t)(host_time_ns() * 240 / 1000);
+}
+
+/* SPI master, not available on the host */
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config, spi_device_handle_t *handle)
+{
+    (void)host_id;
+    (void)dev_config;
+    *handle = NULL;
+    ESP_LOGE("spi_master", "no SPI bus on the host, use a custom SPI driver");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    (void)handle;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    (void)handle;
+    (void)trans_desc;
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,379 @@
+/*
+ * FreeRTOS task, notification and semaphore API on POSIX threads.
+ *
+ * Only the semantics the SPI Ethernet drivers rely on are implemented: blocking with timeout
+ * in ticks of 1 ms, task notification counters, mutexes with an owner, recursive mutexes,
+ * binary and counting semaphores which refuse a give above their maximum count.
+ * vTaskDelete() of another task cancels its thread, the waits are cancellation points.
+ * A task can only suspend itself, eTaskGetState() tells eSuspended from eBlocked only.
+ */
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    UBaseType_t priority;
+    char name[16];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_value;
+    bool suspended;
+};
+
+typedef enum {
+    HOST_SEM_MUTEX,
+    HOST_SEM_RECURSIVE,
+    HOST_SEM_COUNTING,
+} host_sem_type_t;
+
+struct host_sem {
+    host_sem_type_t type;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max_count;
+    TaskHandle_t owner;
+    UBaseType_t depth;
+};
+
+static __thread struct host_task *s_current_task;
+
+static void host_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void host_deadline(struct timespec *ts, TickType_t ticks)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/**
+ * @brief Wait on cond until signaled or the deadline, portMAX_DELAY waits forever
+ * @return false on timeout
+ */
+static bool host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t ticks, const struct timespec *deadline)
+{
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static void host_unlock(void *lock)
+{
+    pthread_mutex_unlock((pthread_mutex_t *)lock);
+}
+
+static void host_task_free(void *arg)
+{
+    struct host_task *task = (struct host_task *)arg;
+    pthread_mutex_destroy(&task->lock);
+    pthread_cond_destroy(&task->cond);
+    free(task);
+}
+
+static struct host_task *host_task_new(const char *name, UBaseType_t priority)
+{
+    struct host_task *task = calloc(1, sizeof(struct host_task));
+    if (!task) {
+        return NULL;
+    }
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    task->priority = priority;
+    pthread_mutex_init(&task->lock, NULL);
+    host_cond_init(&task->cond);
+    return task;
+}
+
+static struct host_task *host_task_current(void)
+{
+    if (!s_current_task) {
+        // a thread not created by xTaskCreate, e.g. main or the esp_timer thread.
+        // its record lives as long as the process
+        s_current_task = host_task_new("host", 1);
+        s_current_task->thread = pthread_self();
+    }
+    return s_current_task;
+}
+
+static void *host_task_entry(void *arg)
+{
+    struct host_task *task = (struct host_task *)arg;
+    s_current_task = task;
+    task->fn(task->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *created_task, BaseType_t core_id)
+{
+    (void)stack_depth;
+    (void)core_id;
+    struct host_task *task = host_task_new(name, priority);
+    if (!task) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    if (created_task) {
+        *created_task = task; // before the task runs, like FreeRTOS
+    }
+    if (pthread_create(&task->thread, NULL, host_task_entry, task) != 0) {
+        if (created_task) {
+            *created_task = NULL;
+        }
+        host_task_free(task);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                           UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb, BaseType_t core_id)
+{
+    (void)stack;
+    (void)tcb;
+    TaskHandle_t task = NULL;
+    xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, &task, core_id);
+    return task;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (!task || task == s_current_task) {
+        // the record of the exiting task is leaked, its handle may still be in use
+        pthread_exit(NULL);
+    }
+    pthread_cancel(task->thread);
+    pthread_join(task->thread, NULL);
+    host_task_free(task);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    uint64_t ms = (uint64_t)ticks * portTICK_PERIOD_MS;
+    struct timespec ts = {
+        .tv_sec = ms / 1000,
+        .tv_nsec = (ms % 1000) * 1000000,
+    };
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+void host_task_yield(void)
+{
+    sched_yield();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(((uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000) / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return host_task_current();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    (void)task;
+    return 0; // not measured on the host
+}
+
+void vTaskSuspend(TaskHandle_t task)
+{
+    struct host_task *current = host_task_current();
+    if (task && task != current) {
+        abort(); // not used by the drivers
+    }
+    pthread_mutex_lock(&current->lock);
+    current->suspended = true;
+    pthread_cleanup_push(host_unlock, &current->lock);
+    while (1) {
+        pthread_cond_wait(&current->cond, &current->lock); // until vTaskDelete cancels the thread
+    }
+    pthread_cleanup_pop(0);
+}
+
+eTaskState eTaskGetState(TaskHandle_t task)
+{
+    if (task == host_task_current()) {
+        return eRunning;
+    }
+    pthread_mutex_lock(&task->lock);
+    eTaskState state = task->suspended ? eSuspended : eBlocked;
+    pthread_mutex_unlock(&task->lock);
+    return state;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return (task ? task : host_task_current())->priority;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *task = host_task_current();
+    struct timespec deadline;
+    host_deadline(&deadline, ticks);
+    pthread_mutex_lock(&task->lock);
+    pthread_cleanup_push(host_unlock, &task->lock);
+    while (task->notify_value == 0 && ticks != 0) {
+        if (!host_cond_wait(&task->cond, &task->lock, ticks, &deadline)) {
+            break;
+        }
+    }
+    pthread_cleanup_pop(0);
+    uint32_t value = task->notify_value;
+    if (value) {
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify_value++;
+    pthread_cond_signal(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+}
+
+static SemaphoreHandle_t host_sem_new(host_sem_type_t type, UBaseType_t max_count, UBaseType_t initial_count)
+{
+    struct host_sem *sem = calloc(1, sizeof(struct host_sem));
+    if (!sem) {
+        return NULL;
+    }
+    sem->type = type;
+    sem->max_count = max_count;
+    sem->count = initial_count;
+    pthread_mutex_init(&sem->lock, NULL);
+    host_cond_init(&sem->cond);
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return host_sem_new(HOST_SEM_MUTEX, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return host_sem_new(HOST_SEM_RECURSIVE, 1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return host_sem_new(HOST_SEM_COUNTING, 1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    if (initial_count > max_count) {
+        return NULL;
+    }
+    return host_sem_new(HOST_SEM_COUNTING, max_count, initial_count);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    if (sem) {
+        pthread_mutex_destroy(&sem->lock);
+        pthread_cond_destroy(&sem->cond);
+        free(sem);
+    }
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    struct timespec deadline;
+    BaseType_t ret = pdTRUE;
+    host_deadline(&deadline, ticks);
+    pthread_mutex_lock(&sem->lock);
+    pthread_cleanup_push(host_unlock, &sem->lock);
+    if (sem->type == HOST_SEM_RECURSIVE && sem->count == 0 && sem->owner == host_task_current()) {
+        sem->depth++;
+    } else {
+        while (sem->count == 0) {
+            if (ticks == 0 || !host_cond_wait(&sem->cond, &sem->lock, ticks, &deadline)) {
+                ret = pdFALSE;
+                break;
+            }
+        }
+        if (ret == pdTRUE) {
+            sem->count--;
+            if (sem->type != HOST_SEM_COUNTING) {
+                sem->owner = host_task_current();
+                sem->depth = 1;
+            }
+        }
+    }
+    pthread_cleanup_pop(1);
+    return ret;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    BaseType_t ret = pdTRUE;
+    pthread_mutex_lock(&sem->lock);
+    if (sem->type != HOST_SEM_COUNTING) {
+        if (sem->owner != host_task_current()) {
+            ret = pdFALSE;
+        } else if (--sem->depth == 0) {
+            sem->owner = NULL;
+            sem->count = 1;
+            pthread_cond_signal(&sem->cond);
+        }
+    } else if (sem->count >= sem->max_count) {
+        ret = pdFALSE;
+    } else {
+        sem->count++;
+        pthread_cond_signal(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return xSemaphoreTake(sem, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    return xSemaphoreGive(sem);
+}
@@ -0,0 +1,14 @@
+/*
+ * Host shim of the ESP-IDF attributes.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+// newlib's sys/cdefs.h defines it, glibc's doesn't
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif
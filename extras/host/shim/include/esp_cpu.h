@@ -0,0 +1,17 @@
+/*
+ * Host shim of esp_cpu.h, the cycle counter counts at 240 MHz of the host's monotonic clock.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int esp_cpu_get_core_id(void);
+uint32_t esp_cpu_get_cycle_count(void);
+
+#ifdef __cplusplus
+}
+#endif
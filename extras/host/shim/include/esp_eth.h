@@ -0,0 +1,8 @@
+/*
+ * Host shim of esp_eth.h.
+ */
+#pragma once
+
+#include "esp_eth_com.h"
+#include "esp_eth_mac.h"
+#include "esp_eth_phy.h"
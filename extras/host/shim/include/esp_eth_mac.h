@@ -0,0 +1,76 @@
+/*
+ * Host shim of the esp_eth MAC interface, with the MAC filter methods of ESP-IDF 5.4.
+ */
+#pragma once
+
+#include "esp_eth_com.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_eth_mac_s esp_eth_mac_t;
+
+struct esp_eth_mac_s {
+    esp_err_t (*set_mediator)(esp_eth_mac_t *mac, esp_eth_mediator_t *eth);
+    esp_err_t (*init)(esp_eth_mac_t *mac);
+    esp_err_t (*deinit)(esp_eth_mac_t *mac);
+    esp_err_t (*start)(esp_eth_mac_t *mac);
+    esp_err_t (*stop)(esp_eth_mac_t *mac);
+    esp_err_t (*transmit)(esp_eth_mac_t *mac, uint8_t *buf, uint32_t length);
+    esp_err_t (*receive)(esp_eth_mac_t *mac, uint8_t *buf, uint32_t *length);
+    esp_err_t (*read_phy_reg)(esp_eth_mac_t *mac, uint32_t phy_addr, uint32_t phy_reg, uint32_t *reg_value);
+    esp_err_t (*write_phy_reg)(esp_eth_mac_t *mac, uint32_t phy_addr, uint32_t phy_reg, uint32_t reg_value);
+    esp_err_t (*set_addr)(esp_eth_mac_t *mac, uint8_t *addr);
+    esp_err_t (*get_addr)(esp_eth_mac_t *mac, uint8_t *addr);
+    esp_err_t (*add_mac_filter)(esp_eth_mac_t *mac, uint8_t *addr);
+    esp_err_t (*rm_mac_filter)(esp_eth_mac_t *mac, uint8_t *addr);
+    esp_err_t (*set_speed)(esp_eth_mac_t *mac, eth_speed_t speed);
+    esp_err_t (*set_duplex)(esp_eth_mac_t *mac, eth_duplex_t duplex);
+    esp_err_t (*set_link)(esp_eth_mac_t *mac, eth_link_t link);
+    esp_err_t (*set_promiscuous)(esp_eth_mac_t *mac, bool enable);
+    esp_err_t (*set_all_multicast)(esp_eth_mac_t *mac, bool enable);
+    esp_err_t (*enable_flow_ctrl)(esp_eth_mac_t *mac, bool enable);
+    esp_err_t (*set_peer_pause_ability)(esp_eth_mac_t *mac, uint32_t ability);
+    esp_err_t (*custom_ioctl)(esp_eth_mac_t *mac, uint32_t cmd, void *data);
+    esp_err_t (*del)(esp_eth_mac_t *mac);
+};
+
+#define ETH_MAC_FLAG_WORK_WITH_CACHE_DISABLE (1 << 0)
+#define ETH_MAC_FLAG_PIN_TO_CORE (1 << 1)
+
+typedef struct {
+    uint32_t sw_reset_timeout_ms;
+    uint32_t rx_task_stack_size;
+    uint32_t rx_task_prio;
+    uint32_t flags;
+} eth_mac_config_t;
+
+#define ETH_MAC_DEFAULT_CONFIG()    \
+    {                               \
+        .sw_reset_timeout_ms = 100, \
+        .rx_task_stack_size = 4096, \
+        .rx_task_prio = 15,         \
+        .flags = 0,                 \
+    }
+
+typedef struct {
+    void *config;
+    void *(*init)(const void *spi_config);
+    esp_err_t (*deinit)(void *spi_ctx);
+    esp_err_t (*read)(void *spi_ctx, uint32_t cmd, uint32_t addr, void *data, uint32_t data_len);
+    esp_err_t (*write)(void *spi_ctx, uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len);
+} eth_spi_custom_driver_config_t;
+
+#define ETH_DEFAULT_SPI     \
+    {                       \
+        .config = NULL,     \
+        .init = NULL,       \
+        .deinit = NULL,     \
+        .read = NULL,       \
+        .write = NULL       \
+    }
+
+#ifdef __cplusplus
+}
+#endif
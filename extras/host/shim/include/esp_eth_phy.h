@@ -0,0 +1,26 @@
+/*
+ * Host shim of the esp_eth PHY interface. The harness sets the link of the MACs directly,
+ * so only the types are needed.
+ */
+#pragma once
+
+#include "esp_eth_com.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_ETH_PHY_ADDR_AUTO (-1)
+
+typedef struct esp_eth_phy_s esp_eth_phy_t;
+
+typedef struct {
+    int32_t phy_addr;
+    uint32_t reset_timeout_ms;
+    uint32_t autonego_timeout_ms;
+    int reset_gpio_num;
+} eth_phy_config_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,4 @@
+/*
+ * Host shim of esp_intr_alloc.h, the drivers include it but use nothing of it.
+ */
+#pragma once
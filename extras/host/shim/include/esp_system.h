@@ -0,0 +1,7 @@
+/*
+ * Host shim of esp_system.h, the drivers include it but use nothing of it.
+ */
+#pragma once
+
+#include "esp_err.h"
+#include "esp_attr.h"
@@ -0,0 +1,52 @@
+/*
+ * Host shim of FreeRTOS on POSIX threads, only what the SPI Ethernet drivers use.
+ * The tick is 1 ms. Critical sections are mutexes, there are no real interrupts:
+ * an "ISR" runs in the thread which changes the level of the GPIO.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+#define configTICK_RATE_HZ  CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define portNUM_PROCESSORS  CONFIG_FREERTOS_NUMBER_OF_CORES
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+typedef struct {
+    pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { PTHREAD_MUTEX_INITIALIZER }
+#define portMUX_INITIALIZE(mux) pthread_mutex_init(&(mux)->mutex, NULL)
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL(mux) pthread_mutex_unlock(&(mux)->mutex)
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+#define portYIELD_FROM_ISR() do {} while (0)
+
+typedef struct {
+    uint8_t unused;
+} StaticTask_t;
+
+#ifdef __cplusplus
+}
+#endif
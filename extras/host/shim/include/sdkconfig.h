@@ -0,0 +1,7 @@
+/*
+ * Host shim of the sdkconfig, a dual core target with 1 kHz tick.
+ */
+#pragma once
+
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_FREERTOS_NUMBER_OF_CORES 2
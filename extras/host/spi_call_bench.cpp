@@ -0,0 +1,151 @@
+/*
+ * Calls per second of the SPI access path from a MAC driver into EthSpiDriver, on the host.
+ *
+ * The MAC drivers access the chip through the read and write hooks of their custom SPI driver.
+ * eth_spi_read and eth_spi_write cast the context and make a virtual call of read or write.
+ * The trampolines EthSpiDriver::spiRead<D> and spiWrite<D> of EthDriver.h call D::read and
+ * D::write directly, so the command encoding is inlined into them. The bench calls both hooks
+ * through a function pointer like the MAC driver does, for driver classes with the command
+ * encoding of ENC28J60Driver and W5500Driver. spiTransfer (harness/host_eth_driver.cpp) only
+ * copies the data, so the time is the cost of the calls, not of the SPI bus. Every row is
+ * the best of 5 runs.
+ *
+ * usage: spi_call_bench [--calls n]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "EthDriver.h"
+
+#define BENCH_RUNS (5)
+
+typedef esp_err_t (*bench_read_t)(void *ctx, uint32_t cmd, uint32_t addr, void *data, uint32_t data_len);
+typedef esp_err_t (*bench_write_t)(void *ctx, uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len);
+
+class BenchEnc28j60Driver : public EthSpiDriver {
+public:
+
+  virtual bool read(uint32_t cmd, uint32_t addr, void *data, uint32_t data_len) {
+    // op. code is in bits 5,6,7, argument in bits 0 to 4
+    uint8_t header = (cmd << 5) | addr;
+    spiTransfer(&header, sizeof(header), (uint8_t*) data, NULL, data_len);
+    return ESP_OK;
+  }
+
+  virtual bool write(uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len) {
+    uint8_t header = (cmd << 5) | addr;
+    spiTransfer(&header, sizeof(header), NULL, (const uint8_t*) data, data_len);
+    return ESP_OK;
+  }
+
+  static void trampolines(eth_spi_custom_driver_config_t &config) {
+    config.read = spiRead<BenchEnc28j60Driver>;
+    config.write = spiWrite<BenchEnc28j60Driver>;
+  }
+
+protected:
+  virtual esp_eth_mac_t* newMAC() {
+    return nullptr;
+  }
+  virtual esp_eth_phy_t* newPHY() {
+    return nullptr;
+  }
+};
+
+class BenchW5500Driver : public EthSpiDriver {
+public:
+
+  virtual bool read(uint32_t cmd, uint32_t addr, void *data, uint32_t data_len) {
+    uint8_t header[] = {(uint8_t) (cmd >> 8), (uint8_t) cmd, (uint8_t) addr};
+    spiTransfer(header, sizeof(header), (uint8_t*) data, NULL, data_len);
+    return ESP_OK;
+  }
+
+  virtual bool write(uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len) {
+    uint8_t header[] = {(uint8_t) (cmd >> 8), (uint8_t) cmd, (uint8_t) addr};
+    spiTransfer(header, sizeof(header), NULL, (const uint8_t*) data, data_len);
+    return ESP_OK;
+  }
+
+  static void trampolines(eth_spi_custom_driver_config_t &config) {
+    config.read = spiRead<BenchW5500Driver>;
+    config.write = spiWrite<BenchW5500Driver>;
+  }
+
+protected:
+  virtual esp_eth_mac_t* newMAC() {
+    return nullptr;
+  }
+  virtual esp_eth_phy_t* newPHY() {
+    return nullptr;
+  }
+};
+
+static double bench_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @return ns per call, best of BENCH_RUNS
+ */
+static double bench_calls(void *ctx, bench_read_t read, bench_write_t write, uint32_t len, uint32_t calls) {
+  // the MAC driver holds the hooks in a struct, the pointer is loaded for every call
+  static bench_read_t volatile readHook;
+  static bench_write_t volatile writeHook;
+  readHook = read;
+  writeHook = write;
+  uint8_t data[64] = {};
+  double best = 0;
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    double start = bench_now_ns();
+    for (uint32_t i = 0; i < calls; i++) {
+      if (readHook) {
+        readHook(ctx, 0, i & 0x1F, data, len);
+      } else {
+        writeHook(ctx, 2, i & 0x1F, data, len);
+      }
+    }
+    double ns = (bench_now_ns() - start) / calls;
+    if (run == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+template<class D> static void bench_driver(const char *chip, uint32_t calls) {
+  D driver;
+  eth_spi_custom_driver_config_t direct = {};
+  D::trampolines(direct);
+  void *ctx = (EthSpiDriver*) &driver;
+  static const uint32_t sizes[] = {1, 64};
+  for (uint32_t len : sizes) {
+    double virtualRead = bench_calls(ctx, eth_spi_read, NULL, len, calls);
+    double directRead = bench_calls(ctx, direct.read, NULL, len, calls);
+    double virtualWrite = bench_calls(ctx, NULL, eth_spi_write, len, calls);
+    double directWrite = bench_calls(ctx, NULL, direct.write, len, calls);
+    printf("%s,read,%u,virtual,%.2f,%.1f\n", chip, (unsigned) len, virtualRead, 1e3 / virtualRead);
+    printf("%s,read,%u,trampoline,%.2f,%.1f\n", chip, (unsigned) len, directRead, 1e3 / directRead);
+    printf("%s,write,%u,virtual,%.2f,%.1f\n", chip, (unsigned) len, virtualWrite, 1e3 / virtualWrite);
+    printf("%s,write,%u,trampoline,%.2f,%.1f\n", chip, (unsigned) len, directWrite, 1e3 / directWrite);
+  }
+}
+
+int main(int argc, char **argv) {
+  uint32_t calls = 10000000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--calls") && i + 1 < argc) {
+      calls = strtoul(argv[++i], NULL, 0);
+    } else {
+      fprintf(stderr, "usage: %s [--calls n]\n", argv[0]);
+      return 2;
+    }
+  }
+  printf("chip,access,bytes,path,ns_per_call,mcalls_per_sec\n");
+  bench_driver<BenchEnc28j60Driver>("enc28j60", calls);
+  bench_driver<BenchW5500Driver>("w5500", calls);
+  return 0;
+}
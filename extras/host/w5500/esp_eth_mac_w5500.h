@@ -0,0 +1,50 @@
+/*
+ * W5500 MAC of the host build, a replica of the ESP-IDF 5.x driver (esp_eth_mac_w5500.c).
+ *
+ * W5500Driver uses the driver of the ESP-IDF framework, which isn't part of this library. The
+ * replica does the same SPI accesses in the same order for initialization, transmit and the
+ * RX task, so the SPI cost measured with it is the cost of the IDF driver. It supports the
+ * custom SPI driver and the interrupt mode only.
+ */
+#pragma once
+
+#include "esp_eth_mac.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief W5500 specific configuration
+ *
+ */
+typedef struct {
+    int int_gpio_num;                                   /*!< Interrupt GPIO number */
+    eth_spi_custom_driver_config_t custom_spi_driver;   /*!< Custom SPI driver definitions */
+} eth_w5500_config_t;
+
+/**
+ * @brief Default W5500 specific configuration
+ *
+ */
+#define ETH_W5500_DEFAULT_CONFIG()                  \
+    {                                               \
+        .int_gpio_num = 4,                          \
+        .custom_spi_driver = ETH_DEFAULT_SPI,       \
+    }
+
+/**
+* @brief Create W5500 Ethernet MAC instance
+*
+* @param w5500_config: W5500 specific configuration
+* @param mac_config: Ethernet MAC configuration
+*
+* @return
+*      - instance: create MAC instance successfully
+*      - NULL: create MAC instance failed because some error occurred
+*/
+esp_eth_mac_t *esp_eth_mac_new_w5500(const eth_w5500_config_t *w5500_config, const eth_mac_config_t *mac_config);
+
+#ifdef __cplusplus
+}
+#endif
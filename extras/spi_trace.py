@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+Breaks a SPI trace of EthSpiDriver::dumpSpiTrace down per frame.
+
+The accesses are grouped into sequences, which are separated by a pause
+longer than --gap microseconds. A sequence with a payload transfer
+of at least 60 bytes is one received or transmitted frame. For every frame
+the time spent with payload, register bank switches and other register
+accesses is printed, followed by the averages for RX and TX frames.
+
+usage: spi_trace.py --chip enc28j60 trace.csv
+"""
+
+import argparse
+import csv
+import sys
+
+MIN_FRAME = 60
+
+
+def classify_enc28j60(cmd, addr, length):
+    if cmd in (1, 3):  # RBM, WBM
+        return "payload"
+    if cmd in (4, 5) and addr == 0x1F:  # BFS, BFC on ECON1
+        return "bank"
+    return "register"
+
+
+def classify_w5500(cmd, addr, length):
+    # cmd is the register address, addr the control byte with the block select bits
+    block = addr >> 3
+    if block == 3 or block == 2:  # socket 0 RX and TX buffer
+        return "payload"
+    return "register"
+
+
+def classify_dm9051(cmd, addr, length):
+    if addr in (0x72, 0x78):  # MRCMD, MWCMD
+        return "payload"
+    return "register"
+
+
+def classify_ksz8851(cmd, addr, length):
+    if cmd > 1:  # RXQ and TXQ FIFO
+        return "payload"
+    return "register"
+
+
+CLASSIFIERS = {
+    "enc28j60": classify_enc28j60,
+    "w5500": classify_w5500,
+    "dm9051": classify_dm9051,
+    "ksz8851": classify_ksz8851,
+}
+
+
+def read_trace(f):
+    cpu_mhz = 240
+    rows = []
+    lines = []
+    for line in f:
+        if line.startswith("# "):
+            for item in line[2:].split():
+                key, _, value = item.partition("=")
+                if key == "cpu_mhz":
+                    cpu_mhz = int(value)
+        elif line.strip():
+            lines.append(line)
+    for row in csv.DictReader(lines):
+        rows.append({
+            "start": int(row["start"]),
+            "cycles": int(row["cycles"]),
+            "write": row["dir"] == "W",
+            "cmd": int(row["cmd"]),
+            "addr": int(row["addr"]),
+            "len": int(row["len"]),
+        })
+    return cpu_mhz, rows
+
+
+def sequences(rows, gap_cycles):
+    seq = []
+    last_end = None
+    for row in rows:
+        # the cycle counter is 32 bits and wraps
+        if last_end is not None and (row["start"] - last_end) % 2**32 > gap_cycles:
+            yield seq
+            seq = []
+        seq.append(row)
+        last_end = (row["start"] + row["cycles"]) % 2**32
+    if seq:
+        yield seq
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--chip", choices=CLASSIFIERS.keys(), required=True)
+    parser.add_argument("--gap", type=float, default=20, help="pause in us which separates two frames")
+    parser.add_argument("trace", nargs="?", type=argparse.FileType("r"), default=sys.stdin)
+    args = parser.parse_args()
+
+    classify = CLASSIFIERS[args.chip]
+    cpu_mhz, rows = read_trace(args.trace)
+    totals = {"RX": [], "TX": []}
+
+    print("frame,dir,bytes,accesses,total_us,payload_us,bank_us,register_us")
+    n = 0
+    for seq in sequences(rows, args.gap * cpu_mhz):
+        times = {"payload": 0, "bank": 0, "register": 0}
+        payload = [row for row in seq if classify(row["cmd"], row["addr"], row["len"]) == "payload"]
+        size = sum(row["len"] for row in payload)
+        if size < MIN_FRAME:
+            continue
+        for row in seq:
+            times[classify(row["cmd"], row["addr"], row["len"])] += row["cycles"] / cpu_mhz
+        direction = "TX" if payload[0]["write"] else "RX"
+        total = sum(times.values())
+        print("%d,%s,%d,%d,%.1f,%.1f,%.1f,%.1f" % (n, direction, size, len(seq), total,
+                                                  times["payload"], times["bank"], times["register"]))
+        totals[direction].append((total, times, len(seq)))
+        n += 1
+
+    for direction, frames in totals.items():
+        if not frames:
+            continue
+        count = len(frames)
+        print("# %s frames: %d, avg %.1f us, payload %.1f us, bank switches %.1f us, registers %.1f us, %.1f accesses"
+              % (direction, count,
+                 sum(f[0] for f in frames) / count,
+                 sum(f[1]["payload"] for f in frames) / count,
+                 sum(f[1]["bank"] for f in frames) / count,
+                 sum(f[1]["register"] for f in frames) / count,
+                 sum(f[2] for f in frames) / count), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -24,13 +24,263 @@
 #include "esp_eth_mac.h"
 #include "esp_event.h"
 #include "esp_mac.h"
+#include "esp_netif_net_stack.h"
+#include "lwip/netif.h"
+#include "lwip/igmp.h"
+#include "lwip/mld6.h"
+#include "lwip/dhcp.h"
+#if LWIP_ACD
+#include "lwip/acd.h"
+#endif
+#include "nvs.h"
+#include <time.h>
 #include "driver/gpio.h"
 
 static uint8_t nextIndex = 0;
+static EthernetClass* interfaces[3] = {};
+
+// created by beginAll. serializes the creation of the MAC and PHY objects, which initializes the shared SPI bus
+static SemaphoreHandle_t driverBeginLock = NULL;
+static StaticSemaphore_t driverBeginLockBuffer;
+
+struct BeginTaskArgs {
+  EthernetClass* eth;
+  SemaphoreHandle_t done;
+};
 
 EthernetClass::EthernetClass() {
   index = nextIndex;
   nextIndex++;
+  if (index < 3) {
+    interfaces[index] = this;
+  }
+}
+
+static EthernetClass* ethernetForNetif(struct netif *lwipNetif) {
+  for (EthernetClass* eth : interfaces) {
+    if (eth != nullptr && eth->netif() != NULL && esp_netif_get_netif_impl(eth->netif()) == lwipNetif) {
+      return eth;
+    }
+  }
+  return nullptr;
+}
+
+// DHCP lease stored in NVS by the interface index
+struct EthernetLease {
+  uint8_t mac[ETH_ADDR_LEN];
+  uint32_t ip;
+  uint32_t netmask;
+  uint32_t gateway;
+  uint32_t dns;
+  uint32_t server;
+  uint32_t leaseTime; // s
+  time_t obtained; // 0 if the system time was not set
+};
+
+static const char* LEASE_NVS_NAMESPACE = "eth_lease";
+static const time_t VALID_TIME = 1700000000; // system time is set if it is later
+
+#if LWIP_ACD
+static struct acd leaseAcd[3];
+static bool leaseAcdAdded[3] = {};
+#endif
+
+static bool loadLease(uint8_t index, EthernetLease &lease) {
+  nvs_handle_t nvs;
+  if (nvs_open(LEASE_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+    return false;
+  }
+  char key[8];
+  snprintf(key, sizeof(key), "eth%d", index);
+  size_t len = sizeof(lease);
+  esp_err_t ret = nvs_get_blob(nvs, key, &lease, &len);
+  nvs_close(nvs);
+  return ret == ESP_OK && len == sizeof(lease);
+}
+
+static void storeLease(uint8_t index, const EthernetLease *lease) {
+  nvs_handle_t nvs;
+  esp_err_t ret = nvs_open(LEASE_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+  if (ret != ESP_OK) {
+    log_e("NVS open failed: %d", ret);
+    return;
+  }
+  char key[8];
+  snprintf(key, sizeof(key), "eth%d", index);
+  ret = (lease != nullptr) ? nvs_set_blob(nvs, key, lease, sizeof(EthernetLease)) : nvs_erase_key(nvs, key);
+  if (ret == ESP_OK) {
+    ret = nvs_commit(nvs);
+  }
+  nvs_close(nvs);
+  if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND) {
+    log_e("storing the DHCP lease failed: %d", ret);
+  }
+}
+
+struct DhcpLeaseArgs {
+  struct netif *lwipNetif;
+  EthernetLease *lease;
+};
+
+// runs in lwIP thread
+static esp_err_t readDhcpLease(void *ctx) {
+  DhcpLeaseArgs* args = (DhcpLeaseArgs*) ctx;
+  struct dhcp *dhcp = netif_dhcp_data(args->lwipNetif);
+  if (dhcp == NULL || dhcp->offered_t0_lease == 0) {
+    return ESP_FAIL;
+  }
+  args->lease->leaseTime = dhcp->offered_t0_lease;
+  args->lease->server = ip4_addr_get_u32(ip_2_ip4(&dhcp->server_ip_addr));
+  return ESP_OK;
+}
+
+#if LWIP_ACD
+static void leaseConflictCB(struct netif *lwipNetif, acd_callback_enum_t state) {
+  EthernetClass* eth = ethernetForNetif(lwipNetif);
+  if (eth == nullptr) {
+    return;
+  }
+  if (state == ACD_IP_OK) {
+    eth->_onLeaseChecked();
+  } else {
+    eth->_onLeaseConflict();
+  }
+}
+
+// runs in lwIP thread. probes the address of the cached lease with ARP
+static esp_err_t startLeaseCheck(void *ctx) {
+  EthernetClass* eth = (EthernetClass*) ctx;
+  struct netif *lwipNetif = (struct netif*) esp_netif_get_netif_impl(eth->netif());
+  if (lwipNetif == NULL) {
+    return ESP_FAIL;
+  }
+  if (!leaseAcdAdded[eth->index]) {
+    acd_add(lwipNetif, &leaseAcd[eth->index], leaseConflictCB);
+    leaseAcdAdded[eth->index] = true;
+  }
+  return acd_start(lwipNetif, &leaseAcd[eth->index], *netif_ip4_addr(lwipNetif)) == ERR_OK ? ESP_OK : ESP_FAIL;
+}
+
+// runs in lwIP thread. DHCP does its own check of the address
+static esp_err_t stopLeaseCheck(void *ctx) {
+  EthernetClass* eth = (EthernetClass*) ctx;
+  struct netif *lwipNetif = (struct netif*) esp_netif_get_netif_impl(eth->netif());
+  if (lwipNetif != NULL && leaseAcdAdded[eth->index]) {
+    acd_remove(lwipNetif, &leaseAcd[eth->index]);
+  }
+  leaseAcdAdded[eth->index] = false;
+  return ESP_OK;
+}
+#endif
+
+// runs in lwIP thread. starts DHCP with the address of the cached lease kept on the netif.
+// esp_netif clears the netif's address when it starts DHCP, it is restored before lwIP handles
+// the next packet. if DHCP confirms the address, lwIP sees no address change and the connections
+// opened with the cached lease stay open
+static esp_err_t startDhcpWithLease(void *ctx) {
+  EthernetClass* eth = (EthernetClass*) ctx;
+  struct netif *lwipNetif = (struct netif*) esp_netif_get_netif_impl(eth->netif());
+  if (lwipNetif == NULL) {
+    return ESP_FAIL;
+  }
+  ip4_addr_t ip = *netif_ip4_addr(lwipNetif);
+  ip4_addr_t netmask = *netif_ip4_netmask(lwipNetif);
+  ip4_addr_t gw = *netif_ip4_gw(lwipNetif);
+  esp_err_t ret = esp_netif_dhcpc_start(eth->netif());
+  if (ret != ESP_OK) {
+    return ret;
+  }
+  ip_addr_copy_from_ip4(lwipNetif->ip_addr, ip);
+  ip_addr_copy_from_ip4(lwipNetif->netmask, netmask);
+  ip_addr_copy_from_ip4(lwipNetif->gw, gw);
+  return ESP_OK;
+}
+
+#if LWIP_IGMP
+static err_t igmpMacFilter(struct netif *lwipNetif, const ip4_addr_t *group, enum netif_mac_filter_action action) {
+  EthernetClass* eth = ethernetForNetif(lwipNetif);
+  if (eth == nullptr) {
+    return ERR_IF;
+  }
+  // 01:00:5e and low 23 bits of the group address
+  uint32_t addr = lwip_ntohl(ip4_addr_get_u32(group));
+  uint8_t mac[ETH_ADDR_LEN] = {0x01, 0x00, 0x5e, (uint8_t) ((addr >> 16) & 0x7f), (uint8_t) (addr >> 8), (uint8_t) addr};
+  return eth->_setMacFilter(mac, action == NETIF_ADD_MAC_FILTER) ? ERR_OK : ERR_IF;
+}
+#endif
+
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+static err_t mldMacFilter(struct netif *lwipNetif, const ip6_addr_t *group, enum netif_mac_filter_action action) {
+  EthernetClass* eth = ethernetForNetif(lwipNetif);
+  if (eth == nullptr) {
+    return ERR_IF;
+  }
+  // 33:33 and low 32 bits of the group address
+  uint32_t addr = lwip_ntohl(group->addr[3]);
+  uint8_t mac[ETH_ADDR_LEN] = {0x33, 0x33, (uint8_t) (addr >> 24), (uint8_t) (addr >> 16), (uint8_t) (addr >> 8), (uint8_t) addr};
+  return eth->_setMacFilter(mac, action == NETIF_ADD_MAC_FILTER) ? ERR_OK : ERR_IF;
+}
+#endif
+
+// runs in lwIP thread. groups joined before the netif was started are added to the MAC filter
+static esp_err_t installMacFilters(void *ctx) {
+  struct netif *lwipNetif = (struct netif*) ctx;
+#if LWIP_IGMP
+  netif_set_igmp_mac_filter(lwipNetif, igmpMacFilter);
+  for (struct igmp_group *group = netif_igmp_data(lwipNetif); group != NULL; group = group->next) {
+    igmpMacFilter(lwipNetif, &group->group_address, NETIF_ADD_MAC_FILTER);
+  }
+#endif
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+  netif_set_mld_mac_filter(lwipNetif, mldMacFilter);
+  // lwIP doesn't join the all-nodes group with MLD
+  ip6_addr_t allNodes;
+  ip6_addr_set_allnodes_linklocal(&allNodes);
+  mldMacFilter(lwipNetif, &allNodes, NETIF_ADD_MAC_FILTER);
+  for (struct mld_group *group = netif_mld6_data(lwipNetif); group != NULL; group = group->next) {
+    mldMacFilter(lwipNetif, &group->group_address, NETIF_ADD_MAC_FILTER);
+  }
+#endif
+  return ESP_OK;
+}
+
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+// runs in lwIP thread. TX checksums are computed by the driver, for IPv4 and IPv6
+static esp_err_t disableTxChecksums(void *ctx) {
+  struct netif *lwipNetif = (struct netif*) ctx;
+  NETIF_SET_CHECKSUM_CTRL(lwipNetif, NETIF_CHECKSUM_ENABLE_ALL & ~(NETIF_CHECKSUM_GEN_IP | NETIF_CHECKSUM_GEN_UDP | NETIF_CHECKSUM_GEN_TCP));
+  return ESP_OK;
+}
+#endif
+
+// runs in lwIP thread. routing and DHCP see the link down, the netif and its DHCP lease stay
+static esp_err_t setNetifLinkDown(void *ctx) {
+  netif_set_link_down((struct netif*) ctx);
+  return ESP_OK;
+}
+
+// input path of esp_eth, the netif gets the frames from it
+static esp_err_t ethInput(esp_eth_handle_t ethHandle, uint8_t *buffer, uint32_t length, void *priv) {
+  return ((EthernetClass*) priv)->_input(buffer, length);
+}
+
+// transmit function of the netif. the netif's driver handle stays the esp_eth handle
+static esp_err_t ethTransmit(void *h, void *buffer, size_t length) {
+  for (EthernetClass* eth : interfaces) {
+    if (eth != nullptr && eth->getEthHandle() == h) {
+      return eth->_transmit(buffer, length);
+    }
+  }
+  return esp_eth_transmit(h, buffer, length);
+}
+
+static esp_err_t ethTransmitWrap(void *h, void *buffer, size_t length, void *netstackBuffer) {
+  return ethTransmit(h, buffer, length);
+}
+
+// esp_eth allocates the received frames from heap
+static void ethFreeRxBuffer(void *h, void *buffer) {
+  free(buffer);
 }
 
 static void ethEventCB(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
@@ -43,27 +293,54 @@ static void ethEventCB(void *arg, esp_event_base_t event_base, int32_t event_id,
   }
 }
 
+static void ipEventCB(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
+  EthernetClass* eth = (EthernetClass*) arg;
+  ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+  if (eth != NULL && event->esp_netif == eth->netif()) {
+    eth->_onGotIP();
+  }
+}
+
+static void beginTimeoutCB(void *arg) {
+  ((EthernetClass*) arg)->_onBeginTimeout();
+}
+
+static void leaseTimerCB(void *arg) {
+  ((EthernetClass*) arg)->_onLeaseTimer();
+}
+
 void EthernetClass::init(EthDriver& ethDriver) {
   driver = &ethDriver;
 }
 
 int EthernetClass::begin(uint8_t *mac, unsigned long timeout) {
+  if (beginAsync(mac) && timeout) {
+    waitForIP(timeout);
+  }
+  return hasIP();
+}
+
+void EthernetClass::begin(uint8_t *mac, IPAddress localIP, IPAddress dnsIP, IPAddress gatewayIP, IPAddress netmask) {
+  if (beginAsync(mac, localIP, dnsIP, gatewayIP, netmask)) {
+    waitStatusBits(ESP_NETIF_CONNECTED_BIT, 3000);
+  }
+}
+
+bool EthernetClass::beginAsync(uint8_t *mac) {
   if (netif() != NULL) {
     config(INADDR_NONE);
   }
-  if (beginETH(mac)) {
-    hwStatus = EthernetHardwareFound;
-    if (timeout) {
-      const unsigned long start = millis();
-      while (!hasIP() && ((millis() - start) < timeout)) {
-        delay(10);
-      }
-    }
+  if (!beginETH(mac)) {
+    return false;
   }
-  return hasIP();
+  hwStatus = EthernetHardwareFound;
+  if (leaseCache) {
+    useCachedLease();
+  }
+  return true;
 }
 
-void EthernetClass::begin(uint8_t *mac, IPAddress localIP, IPAddress dnsIP, IPAddress gatewayIP, IPAddress netmask) {
+bool EthernetClass::beginAsync(uint8_t *mac, IPAddress localIP, IPAddress dnsIP, IPAddress gatewayIP, IPAddress netmask) {
 
   if (localIP.type() == IPv4) {
     // setting auto values
@@ -80,12 +357,215 @@ void EthernetClass::begin(uint8_t *mac, IPAddress localIP, IPAddress dnsIP, IPAd
     }
   }
 //  if (config(localIP, gatewayIP, netmask, dnsIP) && beginETH(mac)) {
-  if (beginETH(mac) && config(localIP, gatewayIP, netmask, dnsIP) ) {
-    hwStatus = EthernetHardwareFound;
+  if (!beginETH(mac) || !config(localIP, gatewayIP, netmask, dnsIP)) {
+    return false;
+  }
+  hwStatus = EthernetHardwareFound;
+  return true;
+}
+
+bool EthernetClass::beginAsync(IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet) {
+  return beginAsync(nullptr, ip, dns, gateway, subnet);
+}
+
+void EthernetClass::onBegin(EthernetBeginCallback callback, unsigned long timeout) {
+  beginCallback = callback;
+  beginTimeout = timeout;
+}
+
+bool EthernetClass::waitForIP(unsigned long timeout) {
+  if (netif() == NULL) {
+    return false;
+  }
+  return (waitStatusBits(ESP_NETIF_HAS_IP_BIT, timeout) & ESP_NETIF_HAS_IP_BIT) != 0;
+}
+
+static void beginTask(void *arg) {
+  BeginTaskArgs* args = (BeginTaskArgs*) arg;
+  args->eth->beginAsync();
+  xSemaphoreGive(args->done);
+  vTaskDelete(NULL);
+}
+
+uint8_t EthernetClass::beginAll(EthernetClass *eths[], uint8_t count, unsigned long timeout) {
+  if (driverBeginLock == NULL) {
+    driverBeginLock = xSemaphoreCreateMutexStatic(&driverBeginLockBuffer);
   }
+  if (count > 3) {
+    log_e("More than 3 Ethernet interfaces");
+    count = 3;
+  }
+  Network.begin();
+
+  // driver install with the chip and PHY reset runs in parallel
+  StaticSemaphore_t doneBuffer;
+  SemaphoreHandle_t done = xSemaphoreCreateCountingStatic(count, 0, &doneBuffer);
+  BeginTaskArgs args[3];
+  uint8_t started = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    args[i] = {eths[i], done};
+    if (xTaskCreate(beginTask, "eth_begin", 4096, &args[i], uxTaskPriorityGet(NULL), NULL) == pdPASS) {
+      started++;
+    } else {
+      log_e("Failed to create begin task for interface %d", eths[i]->index);
+      eths[i]->beginAsync();
+    }
+  }
+  for (uint8_t i = 0; i < started; i++) {
+    xSemaphoreTake(done, portMAX_DELAY);
+  }
+  vSemaphoreDelete(done);
+
+  // the interfaces wait for DHCP in parallel, so the total wait is the wait of the slowest one
   const unsigned long start = millis();
-  while (!linkUp() && ((millis() - start) < 3000)) {
-    delay(10);
+  uint8_t ready = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    unsigned long elapsed = millis() - start;
+    if (eths[i]->waitForIP(elapsed < timeout ? timeout - elapsed : 0)) {
+      ready++;
+    }
+  }
+  return ready;
+}
+
+void EthernetClass::beginNotify(EthernetBeginEvent event) {
+  if (beginCallback != nullptr) {
+    beginCallback(*this, event);
+  }
+}
+
+void EthernetClass::_onGotIP() {
+  if (beginTimer != NULL) {
+    esp_timer_stop(beginTimer);
+  }
+  if (leaseCache && !leaseInUse) {
+    saveLease();
+  }
+  beginNotify(EthernetBeginGotIP);
+}
+
+// configures the address of the stored lease as static IP until the half of the remaining lease time.
+// without system time the lease can't be verified and DHCP is started right after link up and the ARP check.
+// DHCP starts with the address kept, so it is replaced only if the DHCP server assigns an other one
+bool EthernetClass::useCachedLease() {
+  EthernetLease lease;
+  if (!loadLease(index, lease)) {
+    return false;
+  }
+  uint8_t mac[ETH_ADDR_LEN];
+  macAddress(mac);
+  if (memcmp(mac, lease.mac, ETH_ADDR_LEN) != 0) {
+    return false;
+  }
+  uint32_t remaining = 0;
+  time_t now = time(NULL);
+  bool verified = lease.obtained > VALID_TIME && now > VALID_TIME;
+  if (verified) {
+    if (now < lease.obtained || now - lease.obtained >= (time_t) lease.leaseTime) {
+      log_i("stored DHCP lease expired");
+      return false;
+    }
+    remaining = lease.leaseTime - (now - lease.obtained);
+  }
+  if (leaseTimer == NULL) {
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = leaseTimerCB;
+    timerArgs.arg = this;
+    timerArgs.name = "eth_lease";
+    if (esp_timer_create(&timerArgs, &leaseTimer) != ESP_OK) {
+      log_e("lease timer create failed");
+      return false;
+    }
+  }
+  if (!config(IPAddress(lease.ip), IPAddress(lease.gateway), IPAddress(lease.netmask), IPAddress(lease.dns))) {
+    return false;
+  }
+  leaseInUse = true;
+  leaseConflict = false;
+  leaseVerified = verified;
+  esp_timer_stop(leaseTimer);
+  if (verified) {
+    esp_timer_start_once(leaseTimer, (uint64_t) remaining * 1000000 / 2);
+    log_i("using stored DHCP lease %s for %lu s", IPAddress(lease.ip).toString().c_str(), (unsigned long) remaining / 2);
+  } else {
+    log_i("using stored DHCP lease %s until DHCP confirms it", IPAddress(lease.ip).toString().c_str());
+  }
+  return true;
+}
+
+void EthernetClass::saveLease() {
+  esp_netif_dhcp_status_t status;
+  if (esp_netif_dhcpc_get_status(_esp_netif, &status) != ESP_OK || status != ESP_NETIF_DHCP_STARTED) {
+    return;
+  }
+  EthernetLease lease = {};
+  DhcpLeaseArgs args = {(struct netif*) esp_netif_get_netif_impl(_esp_netif), &lease};
+  if (args.lwipNetif == NULL || esp_netif_tcpip_exec(readDhcpLease, &args) != ESP_OK) {
+    return;
+  }
+  macAddress(lease.mac);
+  lease.ip = localIP();
+  lease.netmask = subnetMask();
+  lease.gateway = gatewayIP();
+  lease.dns = dnsIP();
+  time_t now = time(NULL);
+  lease.obtained = (now > VALID_TIME) ? now : 0;
+
+  // a renew of the same lease without system time doesn't change the stored lease
+  EthernetLease stored;
+  if (lease.obtained == 0 && loadLease(index, stored) && memcmp(&stored, &lease, sizeof(lease)) == 0) {
+    return;
+  }
+  storeLease(index, &lease);
+}
+
+void EthernetClass::_onLeaseConflict() {
+  // from lwIP thread, so the switch to DHCP is done in the timer task
+  leaseConflict = true;
+  if (leaseTimer != NULL) {
+    esp_timer_stop(leaseTimer);
+    esp_timer_start_once(leaseTimer, 0);
+  }
+}
+
+void EthernetClass::_onLeaseChecked() {
+  // from lwIP thread. a lease which couldn't be checked for expiration is requested again right away
+  if (!leaseVerified && leaseTimer != NULL) {
+    esp_timer_stop(leaseTimer);
+    esp_timer_start_once(leaseTimer, 0);
+  }
+}
+
+void EthernetClass::_onLeaseTimer() {
+  if (!leaseInUse) {
+    return;
+  }
+  if (leaseConflict) {
+    log_w("address of the stored DHCP lease is used by other host");
+    storeLease(index, nullptr);
+  }
+#if LWIP_ACD
+  esp_netif_tcpip_exec(stopLeaseCheck, this);
+#endif
+  leaseInUse = false;
+  if (leaseConflict) {
+    // the address can't be kept
+    config(INADDR_NONE);
+    return;
+  }
+  // renew with DHCP
+  esp_err_t ret = esp_netif_tcpip_exec(startDhcpWithLease, this);
+  if (ret != ESP_OK) {
+    log_e("DHCP start failed: %d", ret);
+    config(INADDR_NONE);
+    return;
+  }
+  clearStatusBits(ESP_NETIF_HAS_STATIC_IP_BIT);
+}
+
+void EthernetClass::_onBeginTimeout() {
+  if (!hasIP()) {
+    beginNotify(EthernetBeginTimeout);
   }
 }
 
@@ -106,22 +586,26 @@ void EthernetClass::end() {
   //  Network.removeEvent(onEthConnected, ARDUINO_EVENT_ETH_CONNECTED);
 
   if (ethHandle != NULL) {
-    if (esp_eth_stop(ethHandle) != ESP_OK) {
-      log_e("Failed to stop Ethernet");
-      return;
-    }
-    //wait for stop
-    while (getStatusBits() & ESP_NETIF_STARTED_BIT) {
-      delay(10);
-    }
-    //delete glue first
-    if (glueHandle != NULL) {
-      if (esp_eth_del_netif_glue(glueHandle) != ESP_OK) {
-        log_e("Failed to del_netif_glue Ethernet");
+    if (suspended) {
+      // esp_eth is stopped already, the netif was kept running
+      driver->phy->pwrctl(driver->phy, true);
+      suspended = false;
+      esp_netif_stop(_esp_netif);
+      clearStatusBits(ESP_NETIF_STARTED_BIT | ESP_NETIF_CONNECTED_BIT | ESP_NETIF_HAS_IP_BIT //
+          | ESP_NETIF_HAS_LOCAL_IP6_BIT | ESP_NETIF_HAS_GLOBAL_IP6_BIT | ESP_NETIF_HAS_STATIC_IP_BIT
+      );
+    } else {
+      if (esp_eth_stop(ethHandle) != ESP_OK) {
+        log_e("Failed to stop Ethernet");
         return;
       }
-      glueHandle = NULL;
+      //wait for stop of the netif
+      while (getStatusBits() & ESP_NETIF_STARTED_BIT) {
+        delay(10);
+      }
     }
+    // the MAC is stopped and ethInput stays the input path until the driver with its RX task is deleted.
+    // the stopped netif returns frames with the driver's free function, so pool buffers never reach free()
     //uninstall driver
     if (esp_eth_driver_uninstall(ethHandle) != ESP_OK) {
       log_e("Failed to uninstall Ethernet");
@@ -135,9 +619,84 @@ void EthernetClass::end() {
       _eth_ev_instance = NULL;
     }
   }
+  if (_ip_ev_instance != NULL) {
+    if (esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_ETH_GOT_IP, _ip_ev_instance) == ESP_OK) {
+      _ip_ev_instance = NULL;
+    }
+  }
+  // deleting a timer fails while its callback runs (for example end() from the timeout callback).
+  // then the timer is kept and used again by the next begin
+  if (beginTimer != NULL) {
+    esp_timer_stop(beginTimer);
+    if (esp_timer_delete(beginTimer) == ESP_OK) {
+      beginTimer = NULL;
+    }
+  }
+  if (leaseTimer != NULL) {
+    esp_timer_stop(leaseTimer);
+    if (esp_timer_delete(leaseTimer) == ESP_OK) {
+      leaseTimer = NULL;
+    }
+  }
+  leaseInUse = false;
+#if LWIP_ACD
+  leaseAcdAdded[index] = false; // the netif with the ACD list is destroyed
+#endif
   destroyNetif();
 }
 
+bool EthernetClass::suspend() {
+  if (ethHandle == NULL) {
+    return false;
+  }
+  if (suspended) {
+    return true;
+  }
+  // the STOP and DISCONNECTED events of esp_eth_stop don't stop the netif while suspended (see _onEthEvent),
+  // so the netif keeps the address and lwIP keeps the DHCP lease
+  suspended = true;
+  esp_err_t ret = esp_eth_stop(ethHandle);
+  if (ret != ESP_OK) {
+    log_e("Failed to stop Ethernet: %d", ret);
+    suspended = false;
+    return false;
+  }
+  while (getStatusBits() & ESP_NETIF_STARTED_BIT) {
+    delay(1);
+  }
+  void *lwipNetif = esp_netif_get_netif_impl(_esp_netif);
+  if (lwipNetif != NULL) {
+    esp_netif_tcpip_exec(setNetifLinkDown, lwipNetif);
+  }
+  // esp_eth_stop stopped the link check timer, so esp_eth doesn't access the PHY now
+  if (driver->phy->pwrctl(driver->phy, false) != ESP_OK) {
+    log_w("PHY power down failed");
+  }
+  return true;
+}
+
+bool EthernetClass::resume() {
+  if (!suspended) {
+    return ethHandle != NULL;
+  }
+  // esp_eth is stopped, so nothing else accesses the PHY
+  esp_err_t ret = driver->phy->pwrctl(driver->phy, true);
+  if (ret != ESP_OK) {
+    log_e("PHY power up failed: %d", ret);
+    return false;
+  }
+  // esp_eth's link check starts the MAC when the link is up. then the netif's link goes up
+  // and lwIP confirms the kept DHCP lease with an INIT-REBOOT request
+  ret = esp_eth_start(ethHandle);
+  if (ret != ESP_OK) {
+    log_e("Failed to start Ethernet: %d", ret);
+    return false;
+  }
+  // the handler of the START event ends the suspend, so it doesn't start the netif again
+  waitStatusBits(ESP_NETIF_STARTED_BIT, 1000);
+  return true;
+}
+
 EthernetLinkStatus EthernetClass::linkStatus() {
   if (netif() == NULL) {
     return Unknown;
@@ -172,8 +731,101 @@ int EthernetClass::hostByName(const char *hostname, IPAddress &result) {
   return Network.hostByName(hostname, result);
 }
 
+bool EthernetClass::joinMulticastGroup(IPAddress group) {
+  if (_esp_netif == NULL) {
+    return false;
+  }
+  esp_err_t ret;
+  if (group.type() == IPv6) {
+    esp_ip6_addr_t addr = {};
+    memcpy(addr.addr, group.raw_address(), sizeof(addr.addr));
+    ret = esp_netif_join_ip6_multicast_group(_esp_netif, &addr);
+  } else {
+    esp_ip4_addr_t addr;
+    addr.addr = (uint32_t) group;
+    ret = esp_netif_join_ip4_multicast_group(_esp_netif, &addr);
+  }
+  if (ret != ESP_OK) {
+    log_e("join multicast group failed: %d", ret);
+  }
+  return ret == ESP_OK;
+}
+
+bool EthernetClass::leaveMulticastGroup(IPAddress group) {
+  if (_esp_netif == NULL) {
+    return false;
+  }
+  esp_err_t ret;
+  if (group.type() == IPv6) {
+    esp_ip6_addr_t addr = {};
+    memcpy(addr.addr, group.raw_address(), sizeof(addr.addr));
+    ret = esp_netif_leave_ip6_multicast_group(_esp_netif, &addr);
+  } else {
+    esp_ip4_addr_t addr;
+    addr.addr = (uint32_t) group;
+    ret = esp_netif_leave_ip4_multicast_group(_esp_netif, &addr);
+  }
+  if (ret != ESP_OK) {
+    log_e("leave multicast group failed: %d", ret);
+  }
+  return ret == ESP_OK;
+}
+
+bool EthernetClass::_setMacFilter(const uint8_t *mac, bool add) {
+  if (driver == nullptr) {
+    return false;
+  }
+  return add ? driver->addMacFilter(mac) : driver->removeMacFilter(mac);
+}
+
+esp_err_t EthernetClass::_input(uint8_t *buffer, uint32_t length) {
+  stats.rxFrames++;
+  stats.rxBytes += length;
+  return esp_netif_receive(_esp_netif, buffer, length, NULL);
+}
+
+esp_err_t EthernetClass::_transmit(void *buffer, size_t length) {
+  if (suspended) {
+    stats.txFailed++;
+    return ESP_ERR_INVALID_STATE;
+  }
+  esp_err_t ret = esp_eth_transmit(ethHandle, buffer, length);
+  if (ret == ESP_OK) {
+    stats.txFrames++;
+    stats.txBytes += length;
+  } else {
+    stats.txFailed++;
+  }
+  return ret;
+}
+
+void EthernetClass::getStats(EthernetStats &stats) const {
+  stats = this->stats;
+  if (driver == nullptr || !driver->getDriverStats(stats.driver)) {
+    stats.driver = {};
+  }
+}
+
 size_t EthernetClass::printDriverInfo(Print &out) const {
-  return 0;
+  if (driver == nullptr) {
+    return 0;
+  }
+  EthernetStats stats;
+  getStats(stats);
+  size_t n = 0;
+  n += out.printf("RX: %lu frames, %llu bytes\n", (unsigned long) stats.rxFrames, (unsigned long long) stats.rxBytes);
+  n += out.printf("TX: %lu frames, %llu bytes, %lu failed\n", (unsigned long) stats.txFrames, (unsigned long long) stats.txBytes,
+      (unsigned long) stats.txFailed);
+  n += out.printf("link: %lu up, %lu down\n", (unsigned long) stats.linkUps, (unsigned long) stats.linkDowns);
+  EthDriverStats driverStats;
+  if (driver->getDriverStats(driverStats)) {
+    n += out.printf("RX dropped: %lu no buffer, %lu overflow, %lu filter\n", (unsigned long) driverStats.rxDropNoBuffer,
+        (unsigned long) driverStats.rxDropOverflow, (unsigned long) driverStats.rxDropFilter);
+    n += out.printf("TX: %lu timeouts, %lu errors\n", (unsigned long) driverStats.txTimeouts, (unsigned long) driverStats.txErrors);
+    n += out.printf("SPI errors: %lu\n", (unsigned long) driverStats.spiErrors);
+  }
+  n += driver->printInfo(out);
+  return n;
 }
 
 bool EthernetClass::beginETH(uint8_t *macAddrP) {
@@ -202,7 +854,13 @@ bool EthernetClass::beginETH(uint8_t *macAddrP) {
     }
   }
 
-  driver->begin();
+  if (driverBeginLock != NULL) {
+    xSemaphoreTake(driverBeginLock, portMAX_DELAY);
+    driver->begin();
+    xSemaphoreGive(driverBeginLock);
+  } else {
+    driver->begin();
+  }
 
   esp_eth_config_t eth_config = ETH_DEFAULT_CONFIG(driver->mac, driver->phy);
   ret = esp_eth_driver_install(&eth_config, &ethHandle);
@@ -254,16 +912,31 @@ bool EthernetClass::beginETH(uint8_t *macAddrP) {
     log_e("esp_netif_new failed");
     return false;
   }
-  // Attach Ethernet driver to TCP/IP stack
-  glueHandle = esp_eth_new_netif_glue(ethHandle);
-  if (glueHandle == NULL) {
-    log_e("esp_eth_new_netif_glue failed");
+  // Attach Ethernet driver to TCP/IP stack. instead of the netif glue of esp_eth, _onEthEvent does
+  // the netif actions on the esp_eth events, so suspend can keep the netif running
+  ret = esp_netif_set_mac(_esp_netif, macAddr);
+  if (ret != ESP_OK) {
+    log_e("esp_netif_set_mac failed: %d", ret);
     return false;
   }
 
-  ret = esp_netif_attach(_esp_netif, glueHandle);
+  // counting transmit
+  esp_netif_driver_ifconfig_t driverConfig = {};
+  driverConfig.handle = ethHandle;
+  driverConfig.transmit = ethTransmit;
+  driverConfig.transmit_wrap = ethTransmitWrap;
+  // if the driver provides received frames in own buffers, it frees them
+  eth_rx_buffer_free_t rxBufferFree = driver->rxBufferFree();
+  driverConfig.driver_free_rx_buffer = (rxBufferFree != nullptr) ? rxBufferFree : ethFreeRxBuffer;
+  ret = esp_netif_set_driver_config(_esp_netif, &driverConfig);
+  if (ret != ESP_OK) {
+    log_e("esp_netif_set_driver_config failed: %d", ret);
+    return false;
+  }
+  // counting receive
+  ret = esp_eth_update_input_path(ethHandle, ethInput, this);
   if (ret != ESP_OK) {
-    log_e("esp_netif_attach failed: %d", ret);
+    log_e("esp_eth_update_input_path failed: %d", ret);
     return false;
   }
 
@@ -271,6 +944,23 @@ bool EthernetClass::beginETH(uint8_t *macAddrP) {
     log_e("event_handler_instance_register for ETH_EVENT Failed!");
     return false;
   }
+  if (_ip_ev_instance == NULL && esp_event_handler_instance_register(IP_EVENT, IP_EVENT_ETH_GOT_IP, &ipEventCB, this, &_ip_ev_instance)) {
+    log_e("event_handler_instance_register for IP_EVENT Failed!");
+    return false;
+  }
+  if (beginCallback != nullptr && beginTimeout > 0) {
+    if (beginTimer == NULL) {
+      esp_timer_create_args_t timerArgs = {};
+      timerArgs.callback = beginTimeoutCB;
+      timerArgs.arg = this;
+      timerArgs.name = "eth_begin";
+      if (esp_timer_create(&timerArgs, &beginTimer) != ESP_OK) {
+        log_e("begin timeout timer create failed");
+        return false;
+      }
+    }
+    esp_timer_start_once(beginTimer, (uint64_t) beginTimeout * 1000);
+  }
 
   initNetif((Network_Interface_ID)(ESP_NETIF_ID_ETH + index));
 
@@ -291,20 +981,67 @@ void EthernetClass::_onEthEvent(int32_t eventId, void *eventData) {
 
   if (eventId == ETHERNET_EVENT_CONNECTED) {
     log_v("%s Connected", desc());
+    esp_netif_action_connected(_esp_netif, ETH_EVENT, eventId, eventData);
     arduino_event.event_id = ARDUINO_EVENT_ETH_CONNECTED;
     arduino_event.event_info.eth_connected = ethHandle;
     setStatusBits(ESP_NETIF_CONNECTED_BIT);
+    stats.linkUps++;
+    if (leaseInUse) {
+#if LWIP_ACD
+      if (esp_netif_tcpip_exec(startLeaseCheck, this) != ESP_OK) {
+        _onLeaseChecked();
+      }
+#else
+      _onLeaseChecked();
+#endif
+    }
+    beginNotify(EthernetBeginLinkUp);
   } else if (eventId == ETHERNET_EVENT_DISCONNECTED) {
     log_v("%s Disconnected", desc());
     arduino_event.event_id = ARDUINO_EVENT_ETH_DISCONNECTED;
-    clearStatusBits(ESP_NETIF_CONNECTED_BIT | ESP_NETIF_HAS_IP_BIT | ESP_NETIF_HAS_LOCAL_IP6_BIT | ESP_NETIF_HAS_GLOBAL_IP6_BIT);
+    stats.linkDowns++;
+    if (suspended) {
+      // the netif keeps the address
+      clearStatusBits(ESP_NETIF_CONNECTED_BIT);
+    } else {
+      esp_netif_action_disconnected(_esp_netif, ETH_EVENT, eventId, eventData);
+      clearStatusBits(ESP_NETIF_CONNECTED_BIT | ESP_NETIF_HAS_IP_BIT | ESP_NETIF_HAS_LOCAL_IP6_BIT | ESP_NETIF_HAS_GLOBAL_IP6_BIT);
+    }
   } else if (eventId == ETHERNET_EVENT_START) {
     log_v("%s Started", desc());
     arduino_event.event_id = ARDUINO_EVENT_ETH_START;
+    if (suspended) {
+      // resume, the netif is running with its configuration and MAC filters
+      suspended = false;
+      setStatusBits(ESP_NETIF_STARTED_BIT);
+      Network.postEvent(&arduino_event);
+      return;
+    }
+    esp_netif_action_start(_esp_netif, ETH_EVENT, eventId, eventData);
     setStatusBits(ESP_NETIF_STARTED_BIT);
+    void *lwipNetif = esp_netif_get_netif_impl(_esp_netif);
+    if (driver->txChecksumOffload()) {
+      // lwIP netif was added on start, which enabled all checksums
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+      if (lwipNetif != NULL) {
+        esp_netif_tcpip_exec(disableTxChecksums, lwipNetif);
+      }
+#else
+      log_w("lwIP can't disable TX checksums per netif");
+#endif
+    }
+    if (lwipNetif != NULL) {
+      esp_netif_tcpip_exec(installMacFilters, lwipNetif);
+    }
   } else if (eventId == ETHERNET_EVENT_STOP) {
     log_v("%s Stopped", desc());
     arduino_event.event_id = ARDUINO_EVENT_ETH_STOP;
+    if (suspended) {
+      clearStatusBits(ESP_NETIF_STARTED_BIT | ESP_NETIF_CONNECTED_BIT);
+      Network.postEvent(&arduino_event);
+      return;
+    }
+    esp_netif_action_stop(_esp_netif, ETH_EVENT, eventId, eventData);
     clearStatusBits(ESP_NETIF_STARTED_BIT | ESP_NETIF_CONNECTED_BIT | ESP_NETIF_HAS_IP_BIT //
         | ESP_NETIF_HAS_LOCAL_IP6_BIT | ESP_NETIF_HAS_GLOBAL_IP6_BIT | ESP_NETIF_HAS_STATIC_IP_BIT
     );
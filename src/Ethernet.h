@@ -23,6 +23,7 @@
 
 #include "Network.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "utility/EthDriver.h"
 
 enum EthernetLinkStatus {
@@ -33,6 +34,24 @@ enum EthernetHardwareStatus {
   EthernetNoHardware, EthernetHardwareFound
 };
 
+enum EthernetBeginEvent {
+  EthernetBeginLinkUp, EthernetBeginGotIP, EthernetBeginTimeout
+};
+
+struct EthernetStats {
+  uint32_t rxFrames;
+  uint64_t rxBytes;
+  uint32_t txFrames;
+  uint64_t txBytes;
+  uint32_t txFailed;
+  uint32_t linkUps;
+  uint32_t linkDowns;
+  EthDriverStats driver; // zero if the driver doesn't count errors
+};
+
+class EthernetClass;
+typedef void (*EthernetBeginCallback)(EthernetClass &eth, EthernetBeginEvent event);
+
 class EthernetClass : public NetworkInterface {
 
 public:
@@ -47,9 +66,35 @@ public:
   int begin(unsigned long timeout = 60000);
   void begin(IPAddress ip, IPAddress dns = INADDR_NONE, IPAddress gateway = INADDR_NONE, IPAddress subnet = INADDR_NONE);
 
+  // start without waiting for the link and the IP address
+  bool beginAsync(uint8_t *mac = nullptr);
+  bool beginAsync(uint8_t *mac, IPAddress ip, IPAddress dns = INADDR_NONE, IPAddress gateway = INADDR_NONE, IPAddress subnet = INADDR_NONE);
+  bool beginAsync(IPAddress ip, IPAddress dns = INADDR_NONE, IPAddress gateway = INADDR_NONE, IPAddress subnet = INADDR_NONE);
+
+  // the callback is called from the event task on link up and when the interface gets an IPv4 address,
+  // and from the esp_timer task if it has no address 'timeout' ms after begin or beginAsync
+  void onBegin(EthernetBeginCallback callback, unsigned long timeout = 60000);
+  // blocks without polling until the interface has an IPv4 address. returns false on timeout
+  bool waitForIP(unsigned long timeout);
+
+  // stores the DHCP lease in NVS. begin with DHCP then uses a stored lease which is not expired right away
+  void setLeaseCache(bool enable) {
+    leaseCache = enable;
+  }
+
+  // starts the interfaces in parallel and waits until all have an IPv4 address or the timeout expires.
+  // returns the count of interfaces with an address. check each with hasIP()
+  static uint8_t beginAll(EthernetClass *eths[], uint8_t count, unsigned long timeout = 60000);
+
   void end();
   int maintain();
 
+  // stops receiving and transmitting and powers the PHY down. the driver, the netif and the DHCP lease are kept
+  bool suspend();
+  // powers the PHY up and starts esp_eth again. the MAC starts when esp_eth's link check sees the link up,
+  // then with DHCP lwIP confirms the kept lease with an INIT-REBOOT request
+  bool resume();
+
   // Ethernet API functions
   EthernetLinkStatus linkStatus();
   EthernetHardwareStatus hardwareStatus();
@@ -63,9 +108,24 @@ public:
   void setDNS(IPAddress dns, IPAddress dns2 = INADDR_NONE);
   int hostByName(const char *hostname, IPAddress &result);
 
+  // receive multicast frames of the group. the MAC's multicast filter is kept in sync with lwIP IGMP/MLD
+  bool joinMulticastGroup(IPAddress group);
+  bool leaveMulticastGroup(IPAddress group);
+
+  // snapshot of the traffic and error counters of the interface
+  void getStats(EthernetStats &stats) const;
+
   virtual size_t printDriverInfo(Print &out) const;
 
   void _onEthEvent(int32_t eventId, void *eventData);
+  esp_err_t _input(uint8_t *buffer, uint32_t length);
+  esp_err_t _transmit(void *buffer, size_t length);
+  void _onGotIP();
+  void _onBeginTimeout();
+  void _onLeaseConflict();
+  void _onLeaseChecked();
+  void _onLeaseTimer();
+  bool _setMacFilter(const uint8_t *mac, bool add);
 
   esp_eth_handle_t getEthHandle() {
     return ethHandle;
@@ -77,11 +137,26 @@ protected:
   EthDriver* driver = nullptr;
   esp_eth_handle_t ethHandle = NULL;
   esp_event_handler_instance_t _eth_ev_instance = NULL;
-  esp_eth_netif_glue_handle_t glueHandle = NULL;
+  esp_event_handler_instance_t _ip_ev_instance = NULL;
+
+  EthernetBeginCallback beginCallback = nullptr;
+  unsigned long beginTimeout = 0;
+  esp_timer_handle_t beginTimer = NULL;
+
+  bool suspended = false;
+  bool leaseCache = false;
+  bool leaseInUse = false;
+  bool leaseConflict = false;
+  bool leaseVerified = false;
+  esp_timer_handle_t leaseTimer = NULL;
 
   EthernetHardwareStatus hwStatus = EthernetNoHardware;
+  EthernetStats stats = {};
 
   bool beginETH(uint8_t *mac);
+  void beginNotify(EthernetBeginEvent event);
+  bool useCachedLease();
+  void saveLease();
 };
 
 extern EthernetClass Ethernet;
@@ -1,6 +1,7 @@
 
 #include "Ethernet.h"
 
+#include "utility/EthSpiArbiter.h"
 #include "utility/EMACDriver.h"
 #include "utility/W5500Driver.h"
 #include "utility/ENC28J60Driver.h"
@@ -25,17 +25,15 @@
 
 esp_eth_mac_t* DM9051Driver::newMAC() {
 
-  pinMode(pinCS, OUTPUT);
-  digitalWrite(pinCS, HIGH);
-
-  spi->begin();
-
   eth_dm9051_config_t mac_config;
+  if (!initSPI<DM9051Driver>(mac_config)) {
+    return NULL;
+  }
   mac_config.int_gpio_num = digitalPinToGPIONumber(pinIRQ);
   mac_config.poll_period_ms = (pinIRQ < 0) ? 10 : 0;
-  initCustomSPI(mac_config.custom_spi_driver);
 
   eth_mac_config_t eth_mac_config = ETH_MAC_DEFAULT_CONFIG();
+  initMacConfig(eth_mac_config);
   return esp_eth_mac_new_dm9051(&mac_config, &eth_mac_config);
 }
 
@@ -47,26 +45,29 @@ esp_eth_phy_t* DM9051Driver::newPHY() {
   return esp_eth_phy_new_dm9051(&phy_config);
 }
 
-bool DM9051Driver::read(uint32_t cmd, uint32_t addr, void* data, uint32_t data_len) {
-  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
-  digitalWrite(pinCS, LOW);
-
-  spi->write(((cmd & 0x01) << 7) | (addr & 0x7F));
-  spi->transferBytes(NULL, (uint8_t*) data, data_len);
+bool DM9051Driver::spiTest(uint8_t pattern) {
+  // multicast address registers, the MAC driver initializes them
+  const uint8_t MAR = 0x16;
+  uint8_t data[2] = {pattern, (uint8_t) ~pattern};
+  for (int i = 0; i < 2; i++) {
+    uint8_t readback;
+    write(1, MAR + i, &data[i], 1);
+    read(0, MAR + i, &readback, 1);
+    if (readback != data[i]) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  digitalWrite(pinCS, HIGH);
-  spi->endTransaction();
+bool DM9051Driver::read(uint32_t cmd, uint32_t addr, void* data, uint32_t data_len) {
+  uint8_t header = ((cmd & 0x01) << 7) | (addr & 0x7F);
+  spiTransfer(&header, sizeof(header), (uint8_t*) data, NULL, data_len);
   return ESP_OK;
 }
 
 bool DM9051Driver::write(uint32_t cmd, uint32_t addr, const void* data, uint32_t data_len) {
-  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
-  digitalWrite(pinCS, LOW);
-
-  spi->write(((cmd & 0x01) << 7) | (addr & 0x7F));
-  spi->writeBytes((const uint8_t*) data, data_len);
-
-  digitalWrite(pinCS, HIGH);
-  spi->endTransaction();
+  uint8_t header = ((cmd & 0x01) << 7) | (addr & 0x7F);
+  spiTransfer(&header, sizeof(header), NULL, (const uint8_t*) data, data_len);
   return ESP_OK;
 }
@@ -36,6 +36,13 @@ public:
 protected:
   virtual esp_eth_mac_t* newMAC();
   virtual esp_eth_phy_t* newPHY();
+  virtual const char* rxTaskName() {
+    return "dm9051_tsk";
+  }
+  virtual bool spiTest(uint8_t pattern);
+  virtual bool spiTestSupported() {
+    return true;
+  }
 };
 
 #endif
@@ -42,6 +42,7 @@ esp_eth_mac_t* EMACDriver::newMAC() {
 
   eth_mac_config_t eth_mac_config = ETH_MAC_DEFAULT_CONFIG();
   eth_mac_config.sw_reset_timeout_ms = 1000;
+  initMacConfig(eth_mac_config);
 
   return esp_eth_mac_new_esp32(&mac_config, &eth_mac_config);
 }
@@ -49,6 +49,9 @@ public:
 protected:
   virtual esp_eth_mac_t* newMAC();
   virtual esp_eth_phy_t* newPHY();
+  virtual const char* rxTaskName() {
+    return "emac_rx";
+  }
 
 private:
 
@@ -20,22 +20,36 @@
 
 #include "ENC28J60Driver.h"
 
-#include "enc28j60/esp_eth_enc28j60.h"
 #include <Arduino.h>
+#include "enc28j60/enc28j60.h"
 
 esp_eth_mac_t* ENC28J60Driver::newMAC() {
 
-  pinMode(pinCS, OUTPUT);
-  digitalWrite(pinCS, HIGH);
-
-  spi->begin();
-
   eth_enc28j60_config_t mac_config;
+  if (!initSPI<ENC28J60Driver>(mac_config)) {
+    return NULL;
+  }
+  spiDevCfg.cs_ena_posttrans = enc28j60_cal_spi_cs_hold_time(spiFreq);
+  if (spiHost < 0) {
+    mac_config.spi_burst.begin = eth_spi_burst_begin;
+    mac_config.spi_burst.end = eth_spi_burst_end;
+  } else {
+    mac_config.spi_burst.begin = NULL;
+    mac_config.spi_burst.end = NULL;
+  }
   mac_config.int_gpio_num = digitalPinToGPIONumber(pinIRQ);
   mac_config.poll_period_ms = (pinIRQ < 0) ? 10 : 0;
-  initCustomSPI(mac_config.custom_spi_driver);
+  mac_config.rx_poll_budget = rxPollBudget;
+  mac_config.rx_buf_pool_size = rxBufferPoolSize;
+  mac_config.tx_buf_size = txBufferSize;
+  mac_config.tx_double_buffer = txDoubleBuffer;
+  mac_config.tx_checksum_offload = txChecksumOffloadEnabled;
+  mac_config.rx_filter = rxFilter;
+  mac_config.rx_pattern = &rxPattern;
+  mac_config.rx_task_stack = rxTaskStack;
 
   eth_mac_config_t eth_mac_config = ETH_MAC_DEFAULT_CONFIG();
+  initMacConfig(eth_mac_config);
   return esp_eth_mac_new_enc28j60(&mac_config, &eth_mac_config);
 }
 
@@ -47,28 +61,84 @@ esp_eth_phy_t* ENC28J60Driver::newPHY() {
   return esp_eth_phy_new_enc28j60(&phy_config);
 }
 
-bool ENC28J60Driver::read(uint32_t cmd, uint32_t addr, void* data, uint32_t data_len) {
-  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
-  digitalWrite(pinCS, LOW);
+eth_rx_buffer_free_t ENC28J60Driver::rxBufferFree() {
+  return (rxBufferPoolSize > 0) ? emac_enc28j60_free_rx_buffer : nullptr;
+}
 
-  // op. code is in bits 5,6,7, argument in bits 0 to 4
-  spi->write((cmd << 5) | addr);
-  spi->transferBytes(NULL, (uint8_t*) data, data_len);
+bool ENC28J60Driver::setRxFilter(eth_enc28j60_rx_filter_t filter, const eth_enc28j60_rx_pattern_t *pattern) {
+  if (filter == ENC28J60_RX_FILTER_PATTERN && pattern == nullptr) {
+    return false;
+  }
+  rxFilter = filter;
+  if (pattern != nullptr) {
+    rxPattern = *pattern;
+  }
+  if (mac == NULL) {
+    return true; // applied in begin
+  }
+  return emac_enc28j60_set_rx_filter(mac, rxFilter, &rxPattern) == ESP_OK;
+}
 
-  digitalWrite(pinCS, HIGH);
-  spi->endTransaction();
-  return ESP_OK;
+bool ENC28J60Driver::addMacFilter(const uint8_t *addr) {
+  if (mac == NULL) {
+    return false;
+  }
+  return emac_enc28j60_add_mac_filter(mac, (uint8_t*) addr) == ESP_OK;
 }
 
-bool ENC28J60Driver::write(uint32_t cmd, uint32_t addr, const void* data, uint32_t data_len) {
-  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
-  digitalWrite(pinCS, LOW);
+bool ENC28J60Driver::removeMacFilter(const uint8_t *addr) {
+  if (mac == NULL) {
+    return false;
+  }
+  return emac_enc28j60_rm_mac_filter(mac, (uint8_t*) addr) == ESP_OK;
+}
+
+bool ENC28J60Driver::getStats(eth_enc28j60_stats_t& stats) {
+  if (mac == NULL) {
+    return false;
+  }
+  return emac_enc28j60_get_stats(mac, &stats) == ESP_OK;
+}
 
+uint32_t ENC28J60Driver::rxTaskStackHighWaterMark() {
+  eth_enc28j60_stats_t stats;
+  return getStats(stats) ? stats.rx_task_stack_free : 0;
+}
+
+bool ENC28J60Driver::getDriverStats(EthDriverStats &driverStats) {
+  eth_enc28j60_stats_t stats;
+  if (!getStats(stats)) {
+    return false;
+  }
+  driverStats.rxDropNoBuffer = stats.rx_no_buffer;
+  driverStats.rxDropOverflow = stats.rx_overflows;
+  driverStats.rxDropFilter = stats.rx_filter_rejected;
+  driverStats.txTimeouts = stats.tx_timeouts;
+  driverStats.txErrors = stats.tx_errors;
+  driverStats.spiErrors = stats.spi_errors;
+  return true;
+}
+
+bool ENC28J60Driver::spiTest(uint8_t pattern) {
+  // the read pointer in bank 0, the MAC driver sets it
+  uint8_t bankBits = ECON1_BSEL1 | ECON1_BSEL0;
+  write(ENC28J60_SPI_CMD_BFC, ENC28J60_ECON1, &bankBits, 1);
+  uint8_t readback;
+  write(ENC28J60_SPI_CMD_WCR, ENC28J60_ERDPTL, &pattern, 1);
+  read(ENC28J60_SPI_CMD_RCR, ENC28J60_ERDPTL, &readback, 1);
+  return readback == pattern;
+}
+
+bool ENC28J60Driver::read(uint32_t cmd, uint32_t addr, void* data, uint32_t data_len) {
   // op. code is in bits 5,6,7, argument in bits 0 to 4
-  spi->write((cmd << 5) | addr);
-  spi->writeBytes((const uint8_t*) data, data_len);
+  uint8_t header = (cmd << 5) | addr;
+  spiTransfer(&header, sizeof(header), (uint8_t*) data, NULL, data_len);
+  return ESP_OK;
+}
 
-  digitalWrite(pinCS, HIGH);
-  spi->endTransaction();
+bool ENC28J60Driver::write(uint32_t cmd, uint32_t addr, const void* data, uint32_t data_len) {
+  // op. code is in bits 5,6,7, argument in bits 0 to 4
+  uint8_t header = (cmd << 5) | addr;
+  spiTransfer(&header, sizeof(header), NULL, (const uint8_t*) data, data_len);
   return ESP_OK;
 }
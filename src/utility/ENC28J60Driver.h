@@ -22,6 +22,7 @@
 #define _ENC28J60_DRIVER_H_
 
 #include "EthDriver.h"
+#include "enc28j60/esp_eth_enc28j60.h"
 
 class ENC28J60Driver : public EthSpiDriver {
 public:
@@ -33,10 +34,57 @@ public:
   virtual bool read(uint32_t cmd, uint32_t addr, void *data, uint32_t data_len);
   virtual bool write(uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len);
 
+  void setRxBufferPoolSize(uint8_t count) {
+    rxBufferPoolSize = count;
+  }
+
+  // size of the TX part of the chip's 8 kB buffer, the rest is for RX
+  void setTxBufferSize(uint16_t size) {
+    txBufferSize = size;
+  }
+
+  // upload next frame to the chip while the previous one is transmitted
+  void setTxDoubleBuffer(bool enable) {
+    txDoubleBuffer = enable;
+  }
+
+  // compute IP, TCP and UDP checksums of transmitted frames with the chip's DMA engine instead of lwIP
+  void setTxChecksumOffload(bool enable) {
+    txChecksumOffloadEnabled = enable;
+  }
+
+  // which frames the chip receives. the pattern is required for ENC28J60_RX_FILTER_PATTERN
+  bool setRxFilter(eth_enc28j60_rx_filter_t filter, const eth_enc28j60_rx_pattern_t *pattern = nullptr);
+
+  virtual bool addMacFilter(const uint8_t *addr);
+  virtual bool removeMacFilter(const uint8_t *addr);
+
+  bool getStats(eth_enc28j60_stats_t& stats);
+
+  virtual uint32_t rxTaskStackHighWaterMark();
+  virtual bool getDriverStats(EthDriverStats &stats);
+
 protected:
   virtual esp_eth_mac_t* newMAC();
   virtual esp_eth_phy_t* newPHY();
+  virtual eth_rx_buffer_free_t rxBufferFree();
+  virtual bool txChecksumOffload() {
+    return txChecksumOffloadEnabled;
+  }
+  virtual bool spiTest(uint8_t pattern);
+  virtual bool spiTestSupported() {
+    return true;
+  }
+  virtual bool rxPollSupported() {
+    return true;
+  }
 
+  uint8_t rxBufferPoolSize = 0;
+  uint16_t txBufferSize = 0;
+  bool txDoubleBuffer = false;
+  bool txChecksumOffloadEnabled = false;
+  eth_enc28j60_rx_filter_t rxFilter = ENC28J60_RX_FILTER_DEFAULT;
+  eth_enc28j60_rx_pattern_t rxPattern = {};
 };
 
 #endif
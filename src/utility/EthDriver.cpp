@@ -21,9 +21,32 @@
 #include "EthDriver.h"
 
 #include <Arduino.h>
+#include "esp_timer.h"
+
+struct NewMACTaskArgs {
+  EthDriver* driver;
+  TaskHandle_t caller;
+};
+
+void EthDriver::newMACTask(void *arg) {
+  NewMACTaskArgs* args = (NewMACTaskArgs*) arg;
+  args->driver->mac = args->driver->newMAC();
+  args->driver->phy = args->driver->newPHY();
+  xTaskNotifyGive(args->caller);
+  vTaskDelete(NULL);
+}
 
 void EthDriver::begin() {
   if (mac == NULL) {
+    if (rxTaskCore >= 0 && rxTaskCore != xPortGetCoreID()) {
+      // ESP-IDF pins the RX task to the core which creates the MAC
+      NewMACTaskArgs args = {this, xTaskGetCurrentTaskHandle()};
+      if (xTaskCreatePinnedToCore(newMACTask, "eth_new_mac", 4096, &args, uxTaskPriorityGet(NULL), NULL, rxTaskCore) == pdPASS) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        return;
+      }
+      log_e("Failed to create MAC on core %d", rxTaskCore);
+    }
     mac = newMAC();
     phy = newPHY();
   }
@@ -43,6 +66,49 @@ void EthDriver::setPhyAddress(int32_t addr) {
   phyAddr = addr;
 }
 
+void EthDriver::initMacConfig(eth_mac_config_t& macConfig) {
+  if (rxTaskPriority > 0) {
+    macConfig.rx_task_prio = rxTaskPriority;
+  }
+  if (rxTaskStackSize > 0) {
+    macConfig.rx_task_stack_size = rxTaskStackSize;
+  }
+  if (rxTaskCore >= 0) {
+    macConfig.flags |= ETH_MAC_FLAG_PIN_TO_CORE;
+  }
+}
+
+uint32_t EthDriver::rxTaskStackHighWaterMark() {
+  if (mac == NULL || rxTaskName() == nullptr) {
+    return 0;
+  }
+  // with more interfaces of the same type, this is the first one's task
+  TaskHandle_t task = xTaskGetHandle(rxTaskName());
+  return (task != NULL) ? uxTaskGetStackHighWaterMark(task) : 0;
+}
+
+bool EthDriver::addMacFilter(const uint8_t *addr) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+  if (mac != NULL && mac->add_mac_filter != NULL) {
+    return mac->add_mac_filter(mac, (uint8_t*) addr) == ESP_OK;
+  }
+#endif
+  return false;
+}
+
+bool EthDriver::removeMacFilter(const uint8_t *addr) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+  if (mac != NULL && mac->rm_mac_filter != NULL) {
+    return mac->rm_mac_filter(mac, (uint8_t*) addr) == ESP_OK;
+  }
+#endif
+  return false;
+}
+
+size_t EthDriver::printInfo(Print &out) {
+  return 0;
+}
+
 EthDriver::~EthDriver() {
   end();
 };
@@ -63,6 +129,14 @@ esp_err_t eth_spi_write(void *ctx, uint32_t cmd, uint32_t addr, const void *data
   return ((EthSpiDriver*) ctx)->write(cmd, addr, data, data_len);
 }
 
+void eth_spi_burst_begin(void *ctx) {
+  ((EthSpiDriver*) ctx)->beginBurst();
+}
+
+void eth_spi_burst_end(void *ctx) {
+  ((EthSpiDriver*) ctx)->endBurst();
+}
+
 void EthSpiDriver::initCustomSPI(eth_spi_custom_driver_config_t& customSPI) {
   customSPI.config = this;
   customSPI.init = eth_spi_init;
@@ -71,3 +145,198 @@ void EthSpiDriver::initCustomSPI(eth_spi_custom_driver_config_t& customSPI) {
   customSPI.write = eth_spi_write;
 }
 
+
+bool EthSpiDriver::setArbiter(EthSpiArbiter &arbiter, uint8_t weight) {
+  arbiterId = arbiter.addDevice(weight);
+  this->arbiter = (arbiterId >= 0) ? &arbiter : nullptr;
+  return this->arbiter != nullptr;
+}
+
+bool EthSpiDriver::getBusStats(EthSpiArbiter::DeviceStats &stats) {
+  if (arbiter == nullptr) {
+    return false;
+  }
+  return arbiter->getStats(arbiterId, stats);
+}
+
+void EthSpiDriver::busAcquire() {
+  if (arbiter != nullptr) {
+    arbiter->acquire(arbiterId);
+  }
+  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
+}
+
+void EthSpiDriver::busRelease() {
+  spi->endTransaction();
+  if (arbiter != nullptr) {
+    arbiter->release(arbiterId);
+  }
+}
+
+void EthSpiDriver::beginBurst() {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  if (burstDepth > 0 && burstOwner == task) {
+    burstDepth++;
+    return;
+  }
+  // waits for the burst of other task too
+  busAcquire();
+  burstOwner = task;
+  burstDepth = 1;
+}
+
+void EthSpiDriver::endBurst() {
+  if (burstDepth == 0 || burstOwner != xTaskGetCurrentTaskHandle()) {
+    return;
+  }
+  burstDepth--;
+  if (burstDepth == 0) {
+    burstOwner = NULL;
+    busRelease();
+  }
+}
+
+void EthSpiDriver::spiTransfer(const uint8_t *header, uint8_t headerLen, uint8_t *rxData, const uint8_t *txData, uint32_t dataLen) {
+  bool inBurst = burstDepth > 0 && burstOwner == xTaskGetCurrentTaskHandle();
+  if (!inBurst) {
+    busAcquire();
+  } else if (arbiter != nullptr && arbiter->shouldYield(arbiterId)) {
+    // a long burst lets the waiting device in between two accesses
+    busRelease();
+    busAcquire();
+  }
+  // without the wait for the bus. not the CPU cycle counter, the task can move to the other core
+  int64_t start = esp_timer_get_time();
+  digitalWrite(pinCS, LOW);
+
+  uint32_t len = headerLen + dataLen;
+  if (len <= sizeof(spiScratch)) {
+    memcpy(spiScratch, header, headerLen);
+    if (txData != NULL) {
+      memcpy(spiScratch + headerLen, txData, dataLen);
+    } else {
+      memset(spiScratch + headerLen, 0xFF, dataLen);
+    }
+    spi->transferBytes(spiScratch, spiScratch, len);
+    if (rxData != NULL) {
+      memcpy(rxData, spiScratch + headerLen, dataLen);
+    }
+  } else {
+    // frame data. one more transfer costs little compared to the copy
+    spi->writeBytes(header, headerLen);
+    if (rxData != NULL) {
+      spi->transferBytes(NULL, rxData, dataLen);
+    } else {
+      spi->writeBytes(txData, dataLen);
+    }
+  }
+
+  digitalWrite(pinCS, HIGH);
+  spiAccesses++;
+  spiBits += 8 * len;
+  spiTime += esp_timer_get_time() - start;
+  if (!inBurst) {
+    busRelease();
+  }
+}
+
+uint32_t EthSpiDriver::spiAccessOverhead() {
+  if (spiAccesses == 0) {
+    return 0;
+  }
+  uint64_t ns = spiTime * 1000;
+  uint64_t bitsNs = spiBits * 1000 / spiFreq;
+  return (ns > bitsNs) ? (ns - bitsNs) / spiAccesses : 0;
+}
+
+void EthSpiDriver::resetSpiStats() {
+  spiAccesses = 0;
+  spiBits = 0;
+  spiTime = 0;
+}
+
+#if ETH_SPI_TRACE_SIZE > 0
+size_t EthSpiDriver::dumpSpiTrace(Print &out) {
+  uint32_t count = traceCount;
+  uint32_t first = (count > ETH_SPI_TRACE_SIZE) ? count - ETH_SPI_TRACE_SIZE : 0;
+  size_t n = out.printf("# cpu_mhz=%lu spi_mhz=%d\n", (unsigned long) getCpuFrequencyMhz(), spiFreq);
+  n += out.print("start,cycles,dir,cmd,addr,len\n");
+  for (uint32_t i = first; i < count; i++) {
+    const EthSpiTraceEntry &e = trace[i % ETH_SPI_TRACE_SIZE];
+    n += out.printf("%lu,%lu,%c,%u,%u,%u\n", (unsigned long) e.start, (unsigned long) e.cycles, e.write ? 'W' : 'R',
+        e.cmd, e.addr, e.len);
+  }
+  return n;
+}
+#endif
+
+// SPI clocks which the ESP32 SPI peripheral can generate exactly from 80 MHz
+static const uint8_t spiFreqSteps[] = {8, 10, 16, 20, 26, 40};
+
+void EthSpiDriver::tuneSpiFreq() {
+  if (!spiTestSupported()) {
+    log_w("SPI clock auto-tuning is not supported by the driver");
+    return;
+  }
+  static const uint8_t patterns[] = {0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC, 0x96, 0x69};
+  uint8_t configuredFreq = spiFreq;
+  int8_t lastGood = -1;
+  for (int step = 0; step < (int) sizeof(spiFreqSteps) && spiFreqSteps[step] <= spiFreqAutoTuneMax; step++) {
+    spiFreq = spiFreqSteps[step];
+    bool ok = true;
+    for (int i = 0; i < 8 && ok; i++) { // repeated to catch marginal clocks
+      for (uint8_t pattern : patterns) {
+        if (!spiTest(pattern)) {
+          ok = false;
+          break;
+        }
+      }
+    }
+    if (!ok && step == 0) {
+      delay(10); // the chip may not be ready after power-up
+      ok = spiTest(patterns[0]) && spiTest(patterns[1]);
+    }
+    if (!ok) {
+      break;
+    }
+    lastGood = step;
+  }
+  if (lastGood < 0) {
+    log_w("SPI clock auto-tuning failed, using %d MHz", configuredFreq);
+    spiFreq = configuredFreq;
+    return;
+  }
+  // one step below the highest good clock, if a higher clock failed
+  bool failedAbove = lastGood + 1 < (int) sizeof(spiFreqSteps) && spiFreqSteps[lastGood + 1] <= spiFreqAutoTuneMax;
+  spiFreq = spiFreqSteps[(failedAbove && lastGood > 0) ? lastGood - 1 : lastGood];
+  spiFreqTuned = true;
+  log_i("SPI clock auto-tuned to %d MHz", spiFreq);
+}
+
+size_t EthSpiDriver::printInfo(Print &out) {
+  size_t n = out.printf("SPI clock: %d MHz%s\n", spiFreq, spiFreqTuned ? " (auto-tuned)" : "");
+  if (spiHost >= 0) {
+    n += out.printf("SPI backend: ESP-IDF SPI host %d\n", spiHost);
+  }
+  return n;
+}
+
+bool EthSpiDriver::initSpiHost() {
+  spi_bus_config_t buscfg = {};
+  buscfg.mosi_io_num = digitalPinToGPIONumber(pinMOSI);
+  buscfg.miso_io_num = digitalPinToGPIONumber(pinMISO);
+  buscfg.sclk_io_num = digitalPinToGPIONumber(pinSCK);
+  buscfg.quadwp_io_num = -1;
+  buscfg.quadhd_io_num = -1;
+  esp_err_t ret = spi_bus_initialize((spi_host_device_t) spiHost, &buscfg, SPI_DMA_CH_AUTO);
+  if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) { // invalid state if other device initialized the bus
+    log_e("SPI bus initialize failed: %d", ret);
+    return false;
+  }
+  spiDevCfg = {};
+  spiDevCfg.mode = 0;
+  spiDevCfg.clock_speed_hz = 1000000L * spiFreq;
+  spiDevCfg.spics_io_num = digitalPinToGPIONumber(pinCS);
+  spiDevCfg.queue_size = 20;
+  return true;
+}
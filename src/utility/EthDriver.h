@@ -23,12 +23,50 @@
 
 #include "esp_system.h"
 #include "esp_eth.h"
+#include "esp_idf_version.h"
 #include "SPI.h"
+#include "driver/spi_master.h"
+#include "EthSpiArbiter.h"
 
 #ifndef ETH_PHY_SPI_FREQ_MHZ
 #define ETH_PHY_SPI_FREQ_MHZ 20
 #endif
 
+// accesses up to this size including the command header are sent as one transfer
+#ifndef ETH_SPI_SCRATCH_SIZE
+#define ETH_SPI_SCRATCH_SIZE 64
+#endif
+
+// count of SPI accesses of the MAC driver kept in the trace ring buffer. 0 compiles the tracing out
+#ifndef ETH_SPI_TRACE_SIZE
+#define ETH_SPI_TRACE_SIZE 0
+#endif
+
+#if ETH_SPI_TRACE_SIZE > 0
+#include "esp_cpu.h"
+
+struct EthSpiTraceEntry {
+  uint32_t start; // CPU cycle counter
+  uint32_t cycles;
+  uint16_t cmd;
+  uint16_t addr;
+  uint16_t len;
+  bool write;
+};
+#endif
+
+// error counters of the MAC driver
+struct EthDriverStats {
+  uint32_t rxDropNoBuffer;
+  uint32_t rxDropOverflow;
+  uint32_t rxDropFilter;
+  uint32_t txTimeouts;
+  uint32_t txErrors;
+  uint32_t spiErrors;
+};
+
+typedef void (*eth_rx_buffer_free_t)(void *h, void *buffer);
+
 class EthDriver {
 public:
 
@@ -39,18 +77,74 @@ public:
 
   void setPhyAddress(int32_t addr);
 
+  // RX task of the MAC driver. 0 keeps the ESP-IDF default
+  void setRxTaskPriority(uint8_t priority) {
+    rxTaskPriority = priority;
+  }
+  void setRxTaskStackSize(uint32_t size) {
+    rxTaskStackSize = size;
+  }
+  // pin the RX task to core 0 or 1. -1 for no affinity
+  void setRxTaskCore(int8_t core) {
+    rxTaskCore = core;
+  }
+  // static stack buffer for the RX task. only ENC28J60Driver can use it
+  void setRxTaskStack(StackType_t *buffer, uint32_t size) {
+    rxTaskStack = buffer;
+    rxTaskStackSize = size;
+  }
+
+  // minimum of free stack of the RX task in bytes since it was started, 0 if unknown
+  virtual uint32_t rxTaskStackHighWaterMark();
+
   virtual bool usesIRQ() = 0;
 
+  // prints driver settings and state
+  virtual size_t printInfo(Print &out);
+
+  // false if the MAC driver doesn't count errors
+  virtual bool getDriverStats(EthDriverStats &stats) {
+    return false;
+  }
+
+  // receive frames with the multicast MAC address. false if the MAC can't filter them
+  virtual bool addMacFilter(const uint8_t *addr);
+  virtual bool removeMacFilter(const uint8_t *addr);
+
 protected:
   virtual esp_eth_mac_t* newMAC() = 0;
   virtual esp_eth_phy_t* newPHY() = 0;
 
+  // name of the RX task created by the ESP-IDF MAC driver
+  virtual const char* rxTaskName() {
+    return nullptr;
+  }
+
+  void initMacConfig(eth_mac_config_t& macConfig);
+
+  // true if the driver computes IP, TCP and UDP checksums of transmitted frames
+  virtual bool txChecksumOffload() {
+    return false;
+  }
+
+  // function to free received frames in netif, if the driver doesn't allocate them from heap
+  virtual eth_rx_buffer_free_t rxBufferFree() {
+    return nullptr;
+  }
+
   friend class EthernetClass;
 
   int32_t phyAddr = ESP_ETH_PHY_ADDR_AUTO;
+  uint8_t rxTaskPriority = 0;
+  uint32_t rxTaskStackSize = 0;
+  int8_t rxTaskCore = -1;
+  StackType_t* rxTaskStack = nullptr;
 
   esp_eth_mac_t* mac = NULL;
   esp_eth_phy_t* phy = NULL;
+
+private:
+  static void newMACTask(void *arg);
 };
 
 class EthSpiDriver : public EthDriver {
@@ -66,10 +160,44 @@ public:
     spi = &spiObj;
   }
 
+  // use the ESP-IDF SPI master driver with hardware CS and DMA instead of SPIClass.
+  // the SPI host must not be used by SPIClass. other devices on it need the ESP-IDF driver too
+  void setSpiHost(spi_host_device_t host, int8_t sck, int8_t miso, int8_t mosi) {
+    spiHost = host;
+    pinSCK = sck;
+    pinMISO = miso;
+    pinMOSI = mosi;
+  }
+
   void setSpiFreq(uint8_t freqMHz) {
     spiFreq = freqMHz;
   }
 
+  // at begin, find the highest SPI clock up to maxMHz at which writes to a chip register read back correctly.
+  // the clock one step below it is used as safety margin. not supported by KSZ8851SNLDriver and with setSpiHost
+  void setSpiFreqAutoTune(uint8_t maxMHz) {
+    spiFreqAutoTuneMax = maxMHz;
+  }
+
+  uint8_t getSpiFreq() {
+    return spiFreq;
+  }
+
+  virtual size_t printInfo(Print &out);
+
+  // adaptive RX mode: under load the interrupt is masked and the chip is polled
+  // with max 'frames' per pass until it is empty. 0 disables. only ENC28J60Driver supports it,
+  // the other drivers return false. tasks with a lower priority than the RX task run only in the
+  // tick the RX task sleeps after every 2 ticks of polling
+  bool setRxPollBudget(uint8_t frames) {
+    if (!rxPollSupported()) {
+      log_w("adaptive RX mode is not supported by this driver");
+      return false;
+    }
+    rxPollBudget = frames;
+    return true;
+  }
+
   virtual bool usesIRQ() {
     return (pinIRQ >= 0);
   }
@@ -77,19 +205,151 @@ public:
   virtual bool read(uint32_t cmd, uint32_t addr, void *data, uint32_t data_len) = 0;
   virtual bool write(uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len) = 0;
 
+  // share the SPIClass bus with other drivers set to the same arbiter.
+  // weight is the count of turns in a round or the priority, depending on the arbiter's mode
+  bool setArbiter(EthSpiArbiter &arbiter, uint8_t weight = 1);
+  // time this driver waited for the bus
+  bool getBusStats(EthSpiArbiter::DeviceStats &stats);
+
+  // keep the SPIClass bus and SPI settings for a sequence of accesses of the calling task.
+  // accesses in the burst only toggle CS. bursts can nest
+  void beginBurst();
+  void endBurst();
+
+  // average time of an SPIClass access without the time of the transferred bits in ns
+  uint32_t spiAccessOverhead();
+  // count of SPIClass accesses and of their bytes, with the command header
+  uint32_t spiAccessCount() {
+    return spiAccesses;
+  }
+  uint64_t spiByteCount() {
+    return spiBits / 8;
+  }
+
+#if ETH_SPI_TRACE_SIZE > 0
+  // prints the recorded SPI accesses of the MAC driver as CSV, oldest first. out can be Serial or a client
+  size_t dumpSpiTrace(Print &out);
+  void clearSpiTrace() {
+    traceCount = 0;
+  }
+#endif
+  void resetSpiStats();
+
 protected:
   void initCustomSPI(eth_spi_custom_driver_config_t& customSPI);
+  bool initSpiHost();
+  void tuneSpiFreq();
+
+  // writes the pattern to a chip register and reads it back. false if it doesn't match
+  virtual bool spiTest(uint8_t pattern) {
+    return false;
+  }
+  virtual bool spiTestSupported() {
+    return false;
+  }
+  virtual bool rxPollSupported() {
+    return false;
+  }
+
+  // header and payload in one SPI transfer. rxData or txData is NULL
+  void spiTransfer(const uint8_t *header, uint8_t headerLen, uint8_t *rxData, const uint8_t *txData, uint32_t dataLen);
+
+  // SPI callbacks for the MAC driver which call read and write of driver class D without the virtual call.
+  // instantiated in the .cpp of D, so its read and write can be inlined into them
+  template<class D> static esp_err_t spiRead(void *ctx, uint32_t cmd, uint32_t addr, void *data, uint32_t data_len) {
+#if ETH_SPI_TRACE_SIZE > 0
+    uint32_t start = esp_cpu_get_cycle_count();
+    esp_err_t ret = static_cast<D*>((EthSpiDriver*) ctx)->D::read(cmd, addr, data, data_len);
+    ((EthSpiDriver*) ctx)->traceRecord(start, cmd, addr, data_len, false);
+    return ret;
+#else
+    return static_cast<D*>((EthSpiDriver*) ctx)->D::read(cmd, addr, data, data_len);
+#endif
+  }
+  template<class D> static esp_err_t spiWrite(void *ctx, uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len) {
+#if ETH_SPI_TRACE_SIZE > 0
+    uint32_t start = esp_cpu_get_cycle_count();
+    esp_err_t ret = static_cast<D*>((EthSpiDriver*) ctx)->D::write(cmd, addr, data, data_len);
+    ((EthSpiDriver*) ctx)->traceRecord(start, cmd, addr, data_len, true);
+    return ret;
+#else
+    return static_cast<D*>((EthSpiDriver*) ctx)->D::write(cmd, addr, data, data_len);
+#endif
+  }
+
+#if ETH_SPI_TRACE_SIZE > 0
+  void traceRecord(uint32_t start, uint32_t cmd, uint32_t addr, uint32_t len, bool write) {
+    uint32_t i = __atomic_fetch_add(&traceCount, 1, __ATOMIC_RELAXED) % ETH_SPI_TRACE_SIZE;
+    trace[i] = {start, esp_cpu_get_cycle_count() - start, (uint16_t) cmd, (uint16_t) addr, (uint16_t) len, write};
+  }
+#endif
+
+  // sets the SPI part of the MAC config for the native or the SPIClass backend.
+  // D is the driver class
+  template<class D, typename T> bool initSPI(T& macConfig) {
+    if (spiHost >= 0) {
+      if (!initSpiHost()) {
+        return false;
+      }
+      macConfig.spi_host_id = (spi_host_device_t) spiHost;
+      macConfig.spi_devcfg = &spiDevCfg;
+      macConfig.custom_spi_driver = {}; // default ESP-IDF SPI driver
+    } else {
+      pinMode(pinCS, OUTPUT);
+      digitalWrite(pinCS, HIGH);
+      spi->begin();
+      if (spiFreqAutoTuneMax > 0) {
+        tuneSpiFreq();
+      }
+      macConfig.spi_host_id = SPI2_HOST; // not used with custom driver
+      macConfig.spi_devcfg = NULL;
+      initCustomSPI(macConfig.custom_spi_driver);
+      macConfig.custom_spi_driver.read = spiRead<D>;
+      macConfig.custom_spi_driver.write = spiWrite<D>;
+    }
+    return true;
+  }
 
   SPIClass* spi = &SPI;
   uint8_t spiFreq = ETH_PHY_SPI_FREQ_MHZ;
+  uint8_t rxPollBudget = 0;
+  uint8_t spiFreqAutoTuneMax = 0;
+  bool spiFreqTuned = false;
   int8_t pinCS;
   int8_t pinIRQ;
   int8_t pinRst;
+
+  int8_t spiHost = -1;
+  int8_t pinSCK = -1;
+  int8_t pinMISO = -1;
+  int8_t pinMOSI = -1;
+  spi_device_interface_config_t spiDevCfg = {};
+
+  void busAcquire();
+  void busRelease();
+
+  EthSpiArbiter* arbiter = nullptr;
+  int8_t arbiterId = -1;
+
+  TaskHandle_t burstOwner = NULL;
+  uint8_t burstDepth = 0;
+
+  uint8_t spiScratch[ETH_SPI_SCRATCH_SIZE]; // used under the SPIClass bus lock
+  uint32_t spiAccesses = 0;
+  uint64_t spiBits = 0;
+  uint64_t spiTime = 0; // us
+
+#if ETH_SPI_TRACE_SIZE > 0
+  EthSpiTraceEntry trace[ETH_SPI_TRACE_SIZE];
+  uint32_t traceCount = 0;
+#endif
 };
 
 void* eth_spi_init(const void *ctx);
 esp_err_t eth_spi_deinit(void *ctx);
 esp_err_t eth_spi_read(void *ctx, uint32_t cmd, uint32_t addr, void *data, uint32_t data_len);
 esp_err_t eth_spi_write(void *ctx, uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len);
+void eth_spi_burst_begin(void *ctx);
+void eth_spi_burst_end(void *ctx);
 
 #endif
@@ -0,0 +1,144 @@
+/*
+  This file is part of the EthernetESP32 library for Arduino
+  https://github.com/Networking-for-Arduino/EthernetESP32
+  Copyright 2024 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "EthSpiArbiter.h"
+
+#include <Arduino.h>
+#include "esp_timer.h"
+
+EthSpiArbiter::EthSpiArbiter(Mode mode, uint32_t maxHoldTime) {
+  this->mode = mode;
+  this->maxHoldTime = maxHoldTime;
+}
+
+EthSpiArbiter::~EthSpiArbiter() {
+  for (int i = 0; i < deviceCount; i++) {
+    vSemaphoreDelete(devices[i].turn);
+  }
+}
+
+int8_t EthSpiArbiter::addDevice(uint8_t weight) {
+  if (weight == 0) {
+    weight = 1;
+  }
+  if (deviceCount == ETH_SPI_ARBITER_MAX_DEVICES || (mode == ROUND_ROBIN && scheduleLen + weight > ETH_SPI_ARBITER_MAX_SLOTS)) {
+    log_e("SPI arbiter is full");
+    return -1;
+  }
+  SemaphoreHandle_t turn = xSemaphoreCreateCounting(UINT8_MAX, 0);
+  if (turn == NULL) {
+    return -1;
+  }
+  portENTER_CRITICAL(&lock);
+  int8_t id = deviceCount;
+  devices[id].weight = weight;
+  devices[id].turn = turn;
+  if (mode == ROUND_ROBIN) {
+    for (int i = 0; i < weight; i++) {
+      schedule[scheduleLen++] = id;
+    }
+  }
+  deviceCount++;
+  portEXIT_CRITICAL(&lock);
+  return id;
+}
+
+// call in critical section
+int8_t EthSpiArbiter::nextDevice() {
+  int8_t next = -1;
+  if (mode == PRIORITY) {
+    for (int i = 0; i < deviceCount; i++) {
+      if (devices[i].waiting && (next < 0 || devices[i].weight > devices[next].weight)) {
+        next = i;
+      }
+    }
+  } else {
+    for (int i = 1; i <= scheduleLen; i++) {
+      uint8_t pos = (schedulePos + i) % scheduleLen;
+      if (devices[schedule[pos]].waiting) {
+        schedulePos = pos;
+        next = schedule[pos];
+        break;
+      }
+    }
+  }
+  return next;
+}
+
+void EthSpiArbiter::acquire(int8_t id) {
+  Device &device = devices[id];
+  int64_t start = esp_timer_get_time();
+  portENTER_CRITICAL(&lock);
+  bool free = (owner < 0);
+  if (free) {
+    owner = id;
+  } else {
+    device.waiting++;
+  }
+  portEXIT_CRITICAL(&lock);
+  if (!free) {
+    xSemaphoreTake(device.turn, portMAX_DELAY); // release() made this device the owner
+  }
+  int64_t now = esp_timer_get_time();
+  holdStart = now;
+  device.stats.grants++;
+  if (!free) {
+    uint32_t wait = now - start;
+    device.stats.waits++;
+    device.stats.waitTime += wait;
+    if (wait > device.stats.maxWaitTime) {
+      device.stats.maxWaitTime = wait;
+    }
+  }
+}
+
+void EthSpiArbiter::release(int8_t id) {
+  portENTER_CRITICAL(&lock);
+  int8_t next = nextDevice();
+  if (next >= 0) {
+    devices[next].waiting--;
+  }
+  owner = next;
+  portEXIT_CRITICAL(&lock);
+  if (next >= 0) {
+    xSemaphoreGive(devices[next].turn);
+  }
+}
+
+bool EthSpiArbiter::shouldYield(int8_t id) {
+  if (esp_timer_get_time() - holdStart < maxHoldTime) {
+    return false;
+  }
+  bool waiting = false;
+  portENTER_CRITICAL(&lock);
+  for (int i = 0; i < deviceCount && !waiting; i++) {
+    waiting = (i != id) && devices[i].waiting;
+  }
+  portEXIT_CRITICAL(&lock);
+  return waiting;
+}
+
+bool EthSpiArbiter::getStats(int8_t id, DeviceStats &stats) {
+  if (id < 0 || id >= deviceCount) {
+    return false;
+  }
+  stats = devices[id].stats;
+  return true;
+}
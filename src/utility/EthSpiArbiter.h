@@ -0,0 +1,86 @@
+/*
+  This file is part of the EthernetESP32 library for Arduino
+  https://github.com/Networking-for-Arduino/EthernetESP32
+  Copyright 2024 Juraj Andrassy
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _ETH_SPI_ARBITER_H_
+#define _ETH_SPI_ARBITER_H_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifndef ETH_SPI_ARBITER_MAX_DEVICES
+#define ETH_SPI_ARBITER_MAX_DEVICES 4
+#endif
+#define ETH_SPI_ARBITER_MAX_SLOTS 16
+
+// shares one SPI bus fairly between the Ethernet drivers set to use it
+class EthSpiArbiter {
+public:
+
+  enum Mode {
+    ROUND_ROBIN, // weight is count of turns in a round
+    PRIORITY // weight is priority, the highest waiting device gets the bus
+  };
+
+  struct DeviceStats {
+    uint32_t grants; // count of bus accesses
+    uint32_t waits; // count of accesses which had to wait for other device
+    uint64_t waitTime; // total wait time in us
+    uint32_t maxWaitTime; // longest wait in us
+  };
+
+  EthSpiArbiter(Mode mode = ROUND_ROBIN, uint32_t maxHoldTime = 1000);
+  ~EthSpiArbiter();
+
+  // returns id of the device or -1 if full
+  int8_t addDevice(uint8_t weight);
+
+  void acquire(int8_t id);
+  void release(int8_t id);
+
+  // true if the device held the bus longer than maxHoldTime and other device waits
+  bool shouldYield(int8_t id);
+
+  bool getStats(int8_t id, DeviceStats &stats);
+
+private:
+  int8_t nextDevice();
+
+  Mode mode;
+  uint32_t maxHoldTime;
+  portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+  struct Device {
+    uint8_t weight;
+    uint8_t waiting;
+    SemaphoreHandle_t turn;
+    DeviceStats stats;
+  } devices[ETH_SPI_ARBITER_MAX_DEVICES] = {};
+  uint8_t deviceCount = 0;
+
+  // round robin schedule, a device has as many slots as its weight
+  int8_t schedule[ETH_SPI_ARBITER_MAX_SLOTS];
+  uint8_t scheduleLen = 0;
+  uint8_t schedulePos = 0;
+
+  int8_t owner = -1;
+  int64_t holdStart = 0;
+};
+
+#endif
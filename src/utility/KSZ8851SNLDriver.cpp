@@ -25,17 +25,15 @@
 
 esp_eth_mac_t* KSZ8851SNLDriver::newMAC() {
 
-  pinMode(pinCS, OUTPUT);
-  digitalWrite(pinCS, HIGH);
-
-  spi->begin();
-
   eth_ksz8851snl_config_t mac_config;
+  if (!initSPI<KSZ8851SNLDriver>(mac_config)) {
+    return NULL;
+  }
   mac_config.int_gpio_num = digitalPinToGPIONumber(pinIRQ);
   mac_config.poll_period_ms = (pinIRQ < 0) ? 10 : 0;
-  initCustomSPI(mac_config.custom_spi_driver);
 
   eth_mac_config_t eth_mac_config = ETH_MAC_DEFAULT_CONFIG();
+  initMacConfig(eth_mac_config);
   return esp_eth_mac_new_ksz8851snl(&mac_config, &eth_mac_config);
 }
 
@@ -47,34 +45,26 @@ esp_eth_phy_t* KSZ8851SNLDriver::newPHY() {
   return esp_eth_phy_new_w5500(&phy_config);
 }
 
-bool KSZ8851SNLDriver::read(uint32_t cmd, uint32_t addr, void* data, uint32_t data_len) {
-  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
-  digitalWrite(pinCS, LOW);
-
+static uint8_t commandHeader(uint32_t cmd, uint32_t addr, uint8_t *header) {
   if (cmd > 1) {
-    spi->write(cmd << 6 | addr);
-  } else {
-    spi->write16(cmd << 14 | addr);
+    header[0] = cmd << 6 | addr;
+    return 1;
   }
-  spi->transferBytes(NULL, (uint8_t*) data, data_len);
+  header[0] = (cmd << 6) | (addr >> 8);
+  header[1] = addr;
+  return 2;
+}
 
-  digitalWrite(pinCS, HIGH);
-  spi->endTransaction();
+bool KSZ8851SNLDriver::read(uint32_t cmd, uint32_t addr, void* data, uint32_t data_len) {
+  uint8_t header[2];
+  uint8_t headerLen = commandHeader(cmd, addr, header);
+  spiTransfer(header, headerLen, (uint8_t*) data, NULL, data_len);
   return ESP_OK;
 }
 
 bool KSZ8851SNLDriver::write(uint32_t cmd, uint32_t addr, const void* data, uint32_t data_len) {
-  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
-  digitalWrite(pinCS, LOW);
-
-  if (cmd > 1) {
-    spi->write(cmd << 6 | addr);
-  } else {
-    spi->write16(cmd << 14 | addr);
-  }
-  spi->writeBytes((const uint8_t*) data, data_len);
-
-  digitalWrite(pinCS, HIGH);
-  spi->endTransaction();
+  uint8_t header[2];
+  uint8_t headerLen = commandHeader(cmd, addr, header);
+  spiTransfer(header, headerLen, NULL, (const uint8_t*) data, data_len);
   return ESP_OK;
 }
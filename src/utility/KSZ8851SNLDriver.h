@@ -36,6 +36,9 @@ public:
 protected:
   virtual esp_eth_mac_t* newMAC();
   virtual esp_eth_phy_t* newPHY();
+  virtual const char* rxTaskName() {
+    return "ksz8851snl_tsk";
+  }
 
 };
 
@@ -25,17 +25,15 @@
 
 esp_eth_mac_t* W5500Driver::newMAC() {
 
-  pinMode(pinCS, OUTPUT);
-  digitalWrite(pinCS, HIGH);
-
-  spi->begin();
-
   eth_w5500_config_t mac_config;
+  if (!initSPI<W5500Driver>(mac_config)) {
+    return NULL;
+  }
   mac_config.int_gpio_num = digitalPinToGPIONumber(pinIRQ);
   mac_config.poll_period_ms = (pinIRQ < 0) ? 10 : 0;
-  initCustomSPI(mac_config.custom_spi_driver);
 
   eth_mac_config_t eth_mac_config = ETH_MAC_DEFAULT_CONFIG();
+  initMacConfig(eth_mac_config);
   return esp_eth_mac_new_w5500(&mac_config, &eth_mac_config);
 }
 
@@ -47,28 +45,26 @@ esp_eth_phy_t* W5500Driver::newPHY() {
   return esp_eth_phy_new_w5500(&phy_config);
 }
 
-bool W5500Driver::read(uint32_t cmd, uint32_t addr, void* data, uint32_t data_len) {
-  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
-  digitalWrite(pinCS, LOW);
-
-  spi->write16(cmd);
-  spi->write(addr);
-  spi->transferBytes(NULL, (uint8_t*) data, data_len);
+bool W5500Driver::spiTest(uint8_t pattern) {
+  // gateway address register in common register block, not used in MACRAW mode
+  const uint16_t GAR = 0x0001;
+  const uint8_t COMMON_READ = 0x00;
+  const uint8_t COMMON_WRITE = 0x04;
+  uint8_t data[4] = {pattern, (uint8_t) ~pattern, (uint8_t) (pattern ^ 0x5A), (uint8_t) (pattern + 1)};
+  uint8_t readback[4];
+  write(GAR, COMMON_WRITE, data, sizeof(data));
+  read(GAR, COMMON_READ, readback, sizeof(readback));
+  return memcmp(data, readback, sizeof(data)) == 0;
+}
 
-  digitalWrite(pinCS, HIGH);
-  spi->endTransaction();
+bool W5500Driver::read(uint32_t cmd, uint32_t addr, void* data, uint32_t data_len) {
+  uint8_t header[] = {(uint8_t) (cmd >> 8), (uint8_t) cmd, (uint8_t) addr};
+  spiTransfer(header, sizeof(header), (uint8_t*) data, NULL, data_len);
   return ESP_OK;
 }
 
 bool W5500Driver::write(uint32_t cmd, uint32_t addr, const void* data, uint32_t data_len) {
-  spi->beginTransaction(SPISettings(1000000L * spiFreq, MSBFIRST, SPI_MODE0));
-  digitalWrite(pinCS, LOW);
-
-  spi->write16(cmd);
-  spi->write(addr);
-  spi->writeBytes((const uint8_t*) data, data_len);
-
-  digitalWrite(pinCS, HIGH);
-  spi->endTransaction();
+  uint8_t header[] = {(uint8_t) (cmd >> 8), (uint8_t) cmd, (uint8_t) addr};
+  spiTransfer(header, sizeof(header), NULL, (const uint8_t*) data, data_len);
   return ESP_OK;
 }
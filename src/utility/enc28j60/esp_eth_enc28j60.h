@@ -13,9 +13,43 @@ extern "C" {
 #include "esp_eth_phy.h"
 #include "esp_eth_mac.h"
 #include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
 
 #define CS_HOLD_TIME_MIN_NS 210
 
+#define ENC28J60_RX_POOL_MAX_SIZE 32 // maximum count of preallocated RX frame buffers
+#define ENC28J60_MAC_FILTER_MAX 16 // maximum count of multicast MAC filters
+
+/**
+ * @brief ENC28J60 receive filter profile
+ *
+ */
+typedef enum {
+    ENC28J60_RX_FILTER_DEFAULT,     /*!< Unicast, broadcast and multicast frames */
+    ENC28J60_RX_FILTER_UNICAST,     /*!< Only unicast frames to own address */
+    ENC28J60_RX_FILTER_UNICAST_ARP, /*!< Unicast frames, ARP broadcasts and joined multicast groups */
+    ENC28J60_RX_FILTER_PATTERN,     /*!< Unicast frames, frames matching the pattern and joined multicast groups */
+} eth_enc28j60_rx_filter_t;
+
+/**
+ * @brief ENC28J60 receive pattern match filter
+ *
+ */
+typedef struct {
+    uint16_t offset;                            /*!< Offset of the 64 bytes pattern window from the start of the frame */
+    uint8_t mask[8];                            /*!< Bit n of the mask selects byte n of the window for the match */
+    uint8_t pattern[64];                        /*!< Content of the window to match, unselected bytes are ignored */
+} eth_enc28j60_rx_pattern_t;
+
+/**
+ * @brief Optional hooks of a custom SPI driver to keep the SPI bus for a sequence of accesses
+ *
+ */
+typedef struct {
+    void (*begin)(void *spi_ctx);               /*!< Take the bus for the following accesses, NULL if not supported */
+    void (*end)(void *spi_ctx);                 /*!< Release the bus */
+} eth_enc28j60_spi_burst_t;
+
 /**
  * @brief ENC28J60 specific configuration
  *
@@ -24,10 +58,50 @@ typedef struct {
     spi_host_device_t spi_host_id;              /*!< SPI peripheral */
     spi_device_interface_config_t *spi_devcfg;  /*!< SPI device configuration */
     eth_spi_custom_driver_config_t custom_spi_driver;   /*!< Custom SPI driver definitions */
+    eth_enc28j60_spi_burst_t spi_burst;         /*!< Burst hooks of the custom SPI driver, used on the RX and TX paths */
     int int_gpio_num;                           /*!< Interrupt GPIO number */
     uint32_t poll_period_ms;                    /*!< Period in ms to poll rx status when interrupt mode is not used */
+    uint32_t rx_poll_budget;                    /*!< Adaptive mode: max frames received in one pass. If the chip has more frames,
+                                                     the driver masks the interrupt and polls until the chip is empty,
+                                                     sleeping a tick after every 2 ticks of polling. 0 disables */
+    uint32_t rx_buf_pool_size;                  /*!< Count of preallocated RX frame buffers, 0 to allocate every frame from heap.
+                                                     If used, the netif driver must free RX buffers with emac_enc28j60_free_rx_buffer */
+    uint32_t tx_buf_size;                       /*!< Size in bytes of TX part of the 8 KB chip buffer, rest is RX. Must be even, 0 for default 2 KB (3 KB with tx_double_buffer) */
+    bool tx_double_buffer;                      /*!< Use two TX slots, next frame is uploaded while the previous one is transmitted */
+    bool tx_checksum_offload;                   /*!< Compute IPv4 header and IPv4/IPv6 TCP/UDP checksums of transmitted frames with the chip's DMA engine */
+    eth_enc28j60_rx_filter_t rx_filter;         /*!< Receive filter profile */
+    const eth_enc28j60_rx_pattern_t *rx_pattern; /*!< Pattern for ENC28J60_RX_FILTER_PATTERN, copied by the driver */
+    StackType_t *rx_task_stack;                 /*!< Static stack of rx_task_stack_size bytes for the RX task, NULL to allocate it from heap */
 } eth_enc28j60_config_t;
 
+/**
+ * @brief ENC28J60 driver statistics
+ *
+ */
+typedef struct {
+    uint32_t rx_pool_exhausted;                 /*!< Count of frames for which no RX pool buffer was available and heap was used */
+    uint32_t bank_switches;                     /*!< Count of register bank switches */
+    uint32_t bank_switches_per_sec;             /*!< Register bank switches in the last second */
+    uint32_t rx_filter_rejected;                /*!< Count of frames passed by the multicast hash table only by a hash collision and dropped */
+    uint32_t rx_poll_entries;                   /*!< Adaptive mode: count of switches from interrupt to polling */
+    uint32_t rx_poll_exits;                     /*!< Adaptive mode: count of switches from polling back to interrupt */
+    uint32_t rx_poll_passes;                    /*!< Adaptive mode: count of polling passes */
+    uint32_t rx_task_stack_free;                /*!< Minimum free stack of the RX task in bytes since it was started */
+    uint32_t spi_transactions;                  /*!< Count of SPI transactions (one command each) */
+    uint64_t spi_bytes;                         /*!< Count of bytes transferred over SPI, including the command bytes */
+    uint32_t rx_frames;                         /*!< Count of frames read from the chip */
+    uint32_t rx_spi_transactions;               /*!< SPI transactions of reading the frames */
+    uint64_t rx_spi_bytes;                      /*!< SPI bytes of reading the frames */
+    uint32_t tx_frames;                         /*!< Count of frames uploaded to the chip */
+    uint32_t tx_spi_transactions;               /*!< SPI transactions of uploading the frames */
+    uint64_t tx_spi_bytes;                      /*!< SPI bytes of uploading the frames */
+    uint32_t rx_no_buffer;                      /*!< Count of frames not read for lack of a receive buffer */
+    uint32_t rx_overflows;                      /*!< Count of receive errors of the chip, frames dropped by a full receive buffer */
+    uint32_t tx_timeouts;                       /*!< Count of waits for the end of the previous transmit which timed out */
+    uint32_t tx_errors;                         /*!< Count of transmit errors reported by the chip */
+    uint32_t spi_errors;                        /*!< Count of failed SPI transactions */
+} eth_enc28j60_stats_t;
+
 /**
  * @brief ENC28J60 Supported Revisions
  *
@@ -48,8 +122,17 @@ typedef enum {
         .spi_host_id = spi_host,                  \
         .spi_devcfg = spi_devcfg_p,               \
         .custom_spi_driver = ETH_DEFAULT_SPI,     \
+        .spi_burst = { NULL, NULL },              \
         .int_gpio_num = 4,                        \
         .poll_period_ms = 0,                      \
+        .rx_poll_budget = 0,                      \
+        .rx_buf_pool_size = 0,                    \
+        .tx_buf_size = 0,                         \
+        .tx_double_buffer = false,                \
+        .tx_checksum_offload = false,             \
+        .rx_filter = ENC28J60_RX_FILTER_DEFAULT,  \
+        .rx_pattern = NULL,                       \
+        .rx_task_stack = NULL,                    \
     }
 
 /**
@@ -105,6 +188,67 @@ esp_eth_phy_t *esp_eth_phy_new_enc28j60(const eth_phy_config_t *config);
  */
 eth_enc28j60_rev_t emac_enc28j60_get_chip_info(esp_eth_mac_t *mac);
 
+/**
+ * @brief Get ENC28J60 driver statistics
+ *
+ * @param mac ENC28J60 MAC Handle
+ * @param[out] stats copy of the driver counters
+ * @return
+ *      - ESP_OK: statistics copied
+ *      - ESP_ERR_INVALID_ARG: invalid argument
+ */
+esp_err_t emac_enc28j60_get_stats(esp_eth_mac_t *mac, eth_enc28j60_stats_t *stats);
+
+/**
+ * @brief Set receive filter profile
+ * @note frames with a CRC error are always rejected
+ *
+ * @param mac ENC28J60 MAC Handle
+ * @param filter receive filter profile
+ * @param pattern pattern for ENC28J60_RX_FILTER_PATTERN, ignored with other profiles
+ * @return
+ *      - ESP_OK: filter set
+ *      - ESP_ERR_INVALID_ARG: invalid argument
+ *      - ESP_FAIL: writing the registers failed
+ */
+esp_err_t emac_enc28j60_set_rx_filter(esp_eth_mac_t *mac, eth_enc28j60_rx_filter_t filter, const eth_enc28j60_rx_pattern_t *pattern);
+
+/**
+ * @brief Receive frames with the multicast destination address
+ * @note The address is programmed into the multicast hash table. Once a filter is set,
+ *       the chip stops receiving all multicast frames.
+ *
+ * @param mac ENC28J60 MAC Handle
+ * @param addr multicast MAC address
+ * @return
+ *      - ESP_OK: filter added
+ *      - ESP_ERR_INVALID_ARG: invalid argument
+ *      - ESP_FAIL: writing the registers failed
+ */
+esp_err_t emac_enc28j60_add_mac_filter(esp_eth_mac_t *mac, uint8_t *addr);
+
+/**
+ * @brief Remove multicast destination address filter
+ *
+ * @param mac ENC28J60 MAC Handle
+ * @param addr multicast MAC address
+ * @return
+ *      - ESP_OK: filter removed
+ *      - ESP_ERR_NOT_FOUND: the address was not filtered
+ *      - ESP_FAIL: writing the registers failed
+ */
+esp_err_t emac_enc28j60_rm_mac_filter(esp_eth_mac_t *mac, uint8_t *addr);
+
+/**
+ * @brief Free a received frame buffer handed to the stack by the ENC28J60 driver
+ * @note Signature matches esp_netif_driver_ifconfig_t.driver_free_rx_buffer. Buffers from
+ *       the RX pool are returned to the pool, other buffers are freed to heap.
+ *
+ * @param h driver handle (unused)
+ * @param buffer the frame buffer
+ */
+void emac_enc28j60_free_rx_buffer(void *h, void *buffer);
+
 #ifdef __cplusplus
 }
 #endif
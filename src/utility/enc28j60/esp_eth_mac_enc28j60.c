@@ -5,6 +5,7 @@
  */
 #include <string.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 #include <sys/cdefs.h>
 #include "esp_check.h"
 #include "driver/gpio.h"
@@ -17,6 +18,7 @@
 #include "esp_heap_caps.h"
 #include "esp_rom_sys.h"
 #include "esp_timer.h"
+#include "esp_idf_version.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -51,23 +53,47 @@ static const char *TAG = "enc28j60";
 #define ENC28J60_PHY_OPERATION_TIMEOUT_US (150)
 #define ENC28J60_SYSTEM_RESET_ADDITION_TIME_US (1000)
 #define ENC28J60_TX_READY_TIMEOUT_MS (2000)
+#define ENC28J60_DMA_TIMEOUT_US (1000)
+#define ENC28J60_RX_POLL_TICKS (2) // ticks of continuous polling after which the RX task sleeps one tick
 
 #define ENC28J60_BUFFER_SIZE (0x2000) // 8KB built-in buffer
 /**
  *  ______
- * |__TX__| TX: 2 KB : [0x1800, 0x2000)
+ * |__TX__| TX: tx_buf_size (default 2 KB) : [tx_start, 0x2000)
  * |      |
- * |  RX  | RX: 6 KB : [0x0000, 0x1800)
+ * |  RX  | RX: the rest (default 6 KB)     : [0x0000, tx_start)
  * |______|
  *
  */
 #define ENC28J60_BUF_RX_START (0)
-#define ENC28J60_BUF_RX_END (ENC28J60_BUF_TX_START - 1)
-#define ENC28J60_BUF_TX_START ((ENC28J60_BUFFER_SIZE / 4) * 3)
-#define ENC28J60_BUF_TX_END (ENC28J60_BUFFER_SIZE - 1)
+#define ENC28J60_BUF_TX_SIZE_DEFAULT (ENC28J60_BUFFER_SIZE / 4)
+#define ENC28J60_BUF_TX_SIZE_DOUBLE_DEFAULT ((ENC28J60_BUFFER_SIZE / 8) * 3) // two TX slots
+#define ENC28J60_TX_SLOT_NONE (0xFF)
+
+#define ENC28J60_RX_POOL_BUF_SIZE ((ETH_MAX_PACKET_SIZE + 3) & ~3) // keep every pool buffer 4 byte aligned
+#define ENC28J60_RX_POOL_MAX_INSTANCES (3)
 
 #define ENC28J60_RSV_SIZE (6) // Receive Status Vector Size
-#define ENC28J60_TSV_SIZE (6) // Transmit Status Vector Size
+#define ENC28J60_TSV_SIZE (7) // Transmit Status Vector Size, 52 bits
+#define ENC28J60_RX_SPECULATIVE_LEN (64) // frame bytes read together with RSV, covers minimal frames (must be 4 byte multiple)
+#define ENC28J60_READ_PTR_UNKNOWN (0xFFFFFFFF)
+
+// TX part must hold control byte, max frame and TSV, RX part a max frame with RSV and the speculative read
+#define ENC28J60_BUF_TX_SIZE_MIN ((1 + ETH_MAX_PACKET_SIZE + ENC28J60_TSV_SIZE + 1) & ~1)
+#define ENC28J60_BUF_RX_SIZE_MIN (ENC28J60_RSV_SIZE + ETH_MAX_PACKET_SIZE + ENC28J60_RX_SPECULATIVE_LEN)
+#define ENC28J60_BANK_UNKNOWN (0xFF)
+#define ENC28J60_STATS_RATE_PERIOD_US (1000000)
+
+/**
+ * @brief Per-bank masks of registers which are changed only by the driver, so writes
+ *        of unchanged values can be skipped and reads can be served from the shadow copy
+ */
+static const uint32_t s_enc28j60_reg_cacheable[4] = {
+    0x003F0FF0, // bank 0: ETXST, ETXND, ERXST, ERXND, EDMAST, EDMAND, EDMADST. not ERXRDPT, its low byte is latched by the high byte write
+    0x0133FFFF, // bank 1: EHT0-7, EPMM0-7, EPMCS, EPMO, ERXFCON
+    0x00000FDD, // bank 2: MACON1, MACON3, MACON4, MABBIPG, MAIPGL, MAIPGH, MACLCON1, MACLCON2, MAMXFL
+    0x0320003F, // bank 3: MAADR1-6, ECOCON, EPAUS
+};
 
 typedef struct {
     uint8_t next_packet_low;
@@ -117,25 +143,81 @@ typedef struct {
     esp_err_t (*write)(void *spi_ctx, uint32_t cmd, uint32_t addr, const void *data, uint32_t data_len);
 } eth_spi_custom_driver_t;
 
+/**
+ * @brief Fixed pool of DMA capable RX frame buffers
+ * @note free_mask has a bit set for every buffer which is available. Buffers are taken
+ *       by the RX task and returned from the TCP/IP stack context with atomic operations
+ *       only, no lock is taken on either path. refs counts the driver and the buffers held
+ *       by the stack, the last reference frees the memory, so a pool deleted while the stack
+ *       holds some of its buffers is freed when the last buffer returns. The pools are static
+ *       slots, so emac_enc28j60_free_rx_buffer finds the pool of a buffer by its address range
+ *       without a lock. seq is odd while the range of a slot changes, which happens only while
+ *       the slot has no buffers out.
+ */
+typedef struct {
+    _Atomic bool used;            /*!< slot taken by a pool */
+    _Atomic uint32_t seq;         /*!< incremented before and after the range changes */
+    _Atomic uintptr_t start;      /*!< address range of the buffers, empty while the slot is free */
+    _Atomic uintptr_t end;
+    uint8_t *mem;
+    uint32_t count;
+    _Atomic uint32_t free_mask;
+    _Atomic uint32_t refs;        /*!< the driver and every buffer the stack holds */
+} enc28j60_rx_pool_t;
+
 typedef struct {
     esp_eth_mac_t parent;
     esp_eth_mediator_t *eth;
     eth_spi_custom_driver_t spi;
-    SemaphoreHandle_t reg_trans_lock;
-    SemaphoreHandle_t tx_ready_sem;
+    SemaphoreHandle_t reg_trans_lock; // recursive, held for the whole burst
+    eth_enc28j60_spi_burst_t spi_burst;
+    SemaphoreHandle_t tx_ready_sem; // in double buffer mode counts free TX slots
+    SemaphoreHandle_t tx_lock;      // guards TX slots state in double buffer mode
     TaskHandle_t rx_task_hdl;
+    StaticTask_t rx_task_tcb; // used only with static stack
+    _Atomic bool rx_task_exit; // set by emac_enc28j60_del, the RX task suspends itself
     uint32_t sw_reset_timeout_ms;
+    uint32_t rx_end;   // last address of RX part of the buffer
+    uint32_t tx_start; // first address of TX part of the buffer
+    uint32_t tx_slot_size;
+    uint32_t tx_slot_len[2];
+    uint8_t tx_next_slot;  // slot for the next frame to upload
+    uint8_t tx_in_flight;  // slot being transmitted
+    uint8_t tx_staged;     // uploaded slot waiting for transmit request
+    bool tx_double_buffer;
+    bool tx_checksum_offload;
+    bool promiscuous;
+    portMUX_TYPE mac_filter_lock;
+    uint8_t mac_filters[ENC28J60_MAC_FILTER_MAX][6];
+    uint8_t mac_filter_cnt;
+    uint8_t mac_filter_overflow; // count of filters mac_filters couldn't hold, all multicast is accepted
+    eth_enc28j60_rx_filter_t rx_filter;
+    eth_enc28j60_rx_pattern_t rx_pattern;
+    bool rx_check_dest; // hash table filter passes other frames too, check destination of received frames
     uint32_t next_packet_ptr;
+    uint32_t read_ptr; // ERDPT position after the last buffer memory read
     uint32_t last_tsv_addr;
     int int_gpio_num;
     esp_timer_handle_t poll_timer;
     uint32_t poll_period_ms;
     uint8_t addr[6];
     uint8_t last_bank;
+    uint8_t reg_shadow[4][32];
+    uint32_t reg_shadow_valid[4];
+    uint32_t rx_pkt_pending;
+    uint32_t bank_switch_window_cnt;
+    int64_t bank_switch_window_start;
     bool packets_remain;
+    uint32_t rx_poll_budget; // frames per pass in adaptive mode, 0 if disabled
+    bool rx_polling; // adaptive mode switched to polling, interrupt masked
+    TickType_t rx_poll_since; // start of the polling without a sleep
     eth_enc28j60_rev_t revision;
+    enc28j60_rx_pool_t *rx_pool;
+    eth_enc28j60_stats_t stats;
 } emac_enc28j60_t;
 
+static enc28j60_rx_pool_t s_rx_pools[ENC28J60_RX_POOL_MAX_INSTANCES];
+
 static void *enc28j60_spi_init(const void *spi_config)
 {
     void *ret = NULL;
@@ -247,12 +329,46 @@ static esp_err_t enc28j60_spi_read(void *spi_ctx, uint32_t cmd, uint32_t addr, v
 
 static inline bool enc28j60_reg_trans_lock(emac_enc28j60_t *emac)
 {
-    return xSemaphoreTake(emac->reg_trans_lock, pdMS_TO_TICKS(ENC28J60_REG_TRANS_LOCK_TIMEOUT_MS)) == pdTRUE;
+    return xSemaphoreTakeRecursive(emac->reg_trans_lock, pdMS_TO_TICKS(ENC28J60_REG_TRANS_LOCK_TIMEOUT_MS)) == pdTRUE;
 }
 
 static inline bool enc28j60_reg_trans_unlock(emac_enc28j60_t *emac)
 {
-    return xSemaphoreGive(emac->reg_trans_lock) == pdTRUE;
+    return xSemaphoreGiveRecursive(emac->reg_trans_lock) == pdTRUE;
+}
+
+/**
+ * @brief Keep the register lock and the SPI bus for a sequence of accesses
+ * @note the register lock is taken before the bus, in the same order as by single register accesses
+ */
+static bool enc28j60_burst_begin(emac_enc28j60_t *emac)
+{
+    if (!enc28j60_reg_trans_lock(emac)) {
+        return false;
+    }
+    if (emac->spi_burst.begin) {
+        emac->spi_burst.begin(emac->spi.ctx);
+    }
+    return true;
+}
+
+static void enc28j60_burst_end(emac_enc28j60_t *emac)
+{
+    if (emac->spi_burst.end) {
+        emac->spi_burst.end(emac->spi.ctx);
+    }
+    enc28j60_reg_trans_unlock(emac);
+}
+
+/**
+ * @brief Add the SPI traffic since the snapshot to the RX or TX counters
+ * @note called under the register lock, so it contains only the traffic of the frame
+ */
+static inline void enc28j60_count_frame_spi(emac_enc28j60_t *emac, uint32_t *transactions, uint64_t *bytes,
+        uint32_t transactions_start, uint64_t bytes_start)
+{
+    *transactions += emac->stats.spi_transactions - transactions_start;
+    *bytes += emac->stats.spi_bytes - bytes_start;
 }
 
 /**
@@ -274,15 +390,24 @@ static inline uint32_t enc28j60_next_ptr_align_odd(uint32_t next_packet_ptr, uin
 /**
  * @brief Calculate wrap around when reading beyond the end of the RX buffer
  */
-static inline uint32_t enc28j60_rx_packet_start(uint32_t start_addr, uint32_t off)
+static inline uint32_t enc28j60_rx_packet_start(emac_enc28j60_t *emac, uint32_t start_addr, uint32_t off)
 {
-    if (start_addr + off > ENC28J60_BUF_RX_END) {
-        return (start_addr + off) - (ENC28J60_BUF_RX_END - ENC28J60_BUF_RX_START + 1);
+    if (start_addr + off > emac->rx_end) {
+        return (start_addr + off) - (emac->rx_end - ENC28J60_BUF_RX_START + 1);
     } else {
         return start_addr + off;
     }
 }
 
+/**
+ * @brief Count an SPI transaction with the command byte and len data bytes
+ */
+static inline void enc28j60_count_spi(emac_enc28j60_t *emac, uint32_t len)
+{
+    emac->stats.spi_transactions++;
+    emac->stats.spi_bytes += 1 + len;
+}
+
 /**
  * @brief SPI operation wrapper for writing ENC28J60 internal register
  */
@@ -291,8 +416,12 @@ static esp_err_t enc28j60_do_register_write(emac_enc28j60_t *emac, uint8_t reg_a
     esp_err_t ret = ESP_OK;
 
     ESP_GOTO_ON_ERROR(emac->spi.write(emac->spi.ctx, ENC28J60_SPI_CMD_WCR, reg_addr, &value, sizeof(value)), err, TAG, "register write failed");
+    enc28j60_count_spi(emac, sizeof(value));
 
 err:
+    if (ret != ESP_OK) {
+        emac->stats.spi_errors++;
+    }
     return ret;
 }
 
@@ -305,9 +434,13 @@ static esp_err_t enc28j60_do_register_read(emac_enc28j60_t *emac, bool is_eth_re
 
     uint8_t tmp[2];
     ESP_GOTO_ON_ERROR(emac->spi.read(emac->spi.ctx, ENC28J60_SPI_CMD_RCR, reg_addr, tmp, is_eth_reg ? 1 : 2), err, TAG, "register read failed");
+    enc28j60_count_spi(emac, is_eth_reg ? 1 : 2);
     *value = is_eth_reg ? tmp[0] : tmp[1];
 
 err:
+    if (ret != ESP_OK) {
+        emac->stats.spi_errors++;
+    }
     return ret;
 }
 
@@ -320,8 +453,12 @@ static esp_err_t enc28j60_do_bitwise_set(emac_enc28j60_t *emac, uint8_t reg_addr
     esp_err_t ret = ESP_OK;
 
     ESP_GOTO_ON_ERROR(emac->spi.write(emac->spi.ctx, ENC28J60_SPI_CMD_BFS, reg_addr, &mask, sizeof(mask)), err, TAG, "bitwise set failed");
+    enc28j60_count_spi(emac, sizeof(mask));
 
 err:
+    if (ret != ESP_OK) {
+        emac->stats.spi_errors++;
+    }
     return ret;
 }
 
@@ -334,8 +471,12 @@ static esp_err_t enc28j60_do_bitwise_clr(emac_enc28j60_t *emac, uint8_t reg_addr
     esp_err_t ret = ESP_OK;
 
     ESP_GOTO_ON_ERROR(emac->spi.write(emac->spi.ctx, ENC28J60_SPI_CMD_BFC, reg_addr, &mask, sizeof(mask)), err, TAG, "bitwise clear failed");
+    enc28j60_count_spi(emac, sizeof(mask));
 
 err:
+    if (ret != ESP_OK) {
+        emac->stats.spi_errors++;
+    }
     return ret;
 }
 
@@ -347,8 +488,12 @@ static esp_err_t enc28j60_do_memory_write(emac_enc28j60_t *emac, uint8_t *buffer
     esp_err_t ret = ESP_OK;
 
     ESP_GOTO_ON_ERROR(emac->spi.write(emac->spi.ctx, ENC28J60_SPI_CMD_WBM, 0x1A, buffer, len), err, TAG, "memory writer failed");
+    enc28j60_count_spi(emac, len);
 
 err:
+    if (ret != ESP_OK) {
+        emac->stats.spi_errors++;
+    }
     return ret;
 }
 
@@ -360,8 +505,12 @@ static esp_err_t enc28j60_do_memory_read(emac_enc28j60_t *emac, uint8_t *buffer,
     esp_err_t ret = ESP_OK;
 
     ESP_GOTO_ON_ERROR(emac->spi.read(emac->spi.ctx, ENC28J60_SPI_CMD_RBM, 0x1A, buffer, len), err, TAG, "register read failed");
+    enc28j60_count_spi(emac, len);
 
 err:
+    if (ret != ESP_OK) {
+        emac->stats.spi_errors++;
+    }
     return ret;
 }
 
@@ -373,42 +522,108 @@ static esp_err_t enc28j60_do_reset(emac_enc28j60_t *emac)
     esp_err_t ret = ESP_OK;
 
     ESP_GOTO_ON_ERROR(emac->spi.write(emac->spi.ctx, ENC28J60_SPI_CMD_SRC, 0x1F, NULL, 0), err, TAG, "soft reset failed");
+    enc28j60_count_spi(emac, 0);
+    // registers are back at their reset values
+    memset(emac->reg_shadow_valid, 0, sizeof(emac->reg_shadow_valid));
+    emac->last_bank = ENC28J60_BANK_UNKNOWN;
 
     // After reset, wait at least 1ms for the device to be ready
     esp_rom_delay_us(ENC28J60_SYSTEM_RESET_ADDITION_TIME_US);
 
 err:
+    if (ret != ESP_OK) {
+        emac->stats.spi_errors++;
+    }
     return ret;
 }
 
+/**
+ * @brief Count bank switch for the statistics
+ */
+static inline void enc28j60_count_bank_switch(emac_enc28j60_t *emac)
+{
+    int64_t now = esp_timer_get_time();
+    emac->stats.bank_switches++;
+    emac->bank_switch_window_cnt++;
+    if (now - emac->bank_switch_window_start >= ENC28J60_STATS_RATE_PERIOD_US) {
+        emac->stats.bank_switches_per_sec = emac->bank_switch_window_cnt;
+        emac->bank_switch_window_cnt = 0;
+        emac->bank_switch_window_start = now;
+    }
+}
+
 /**
  * @brief Switch ENC28J60 register bank
+ * @note if the current bank is known, only the bits which differ are cleared or set
  */
 static esp_err_t enc28j60_switch_register_bank(emac_enc28j60_t *emac, uint8_t bank)
 {
     esp_err_t ret = ESP_OK;
     if (bank != emac->last_bank) {
-        MAC_CHECK(enc28j60_do_bitwise_clr(emac, ENC28J60_ECON1, 0x03) == ESP_OK,
-                  "clear ECON1[1:0] failed", out, ESP_FAIL);
-        MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_ECON1, bank & 0x03) == ESP_OK,
-                  "set ECON1[1:0] failed", out, ESP_FAIL);
+        uint8_t clr_bits = 0x03;
+        uint8_t set_bits = bank & 0x03;
+        if (emac->last_bank != ENC28J60_BANK_UNKNOWN) {
+            clr_bits = emac->last_bank & ~bank & 0x03;
+            set_bits = bank & ~emac->last_bank & 0x03;
+        }
+        emac->last_bank = ENC28J60_BANK_UNKNOWN;
+        if (clr_bits) {
+            MAC_CHECK(enc28j60_do_bitwise_clr(emac, ENC28J60_ECON1, clr_bits) == ESP_OK,
+                      "clear ECON1[1:0] failed", out, ESP_FAIL);
+        }
+        if (set_bits) {
+            MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_ECON1, set_bits) == ESP_OK,
+                      "set ECON1[1:0] failed", out, ESP_FAIL);
+        }
         emac->last_bank = bank;
+        enc28j60_count_bank_switch(emac);
     }
 out:
     return ret;
 }
 
+static inline bool enc28j60_reg_is_cacheable(uint16_t reg_addr)
+{
+    return s_enc28j60_reg_cacheable[(reg_addr & 0x300) >> 8] & (1UL << (reg_addr & 0x1F));
+}
+
+static inline bool enc28j60_reg_shadow_get(emac_enc28j60_t *emac, uint16_t reg_addr, uint8_t *value)
+{
+    uint8_t bank = (reg_addr & 0x300) >> 8;
+    uint8_t index = reg_addr & 0x1F;
+    if (!(emac->reg_shadow_valid[bank] & (1UL << index))) {
+        return false;
+    }
+    *value = emac->reg_shadow[bank][index];
+    return true;
+}
+
+static inline void enc28j60_reg_shadow_set(emac_enc28j60_t *emac, uint16_t reg_addr, uint8_t value)
+{
+    if (enc28j60_reg_is_cacheable(reg_addr)) {
+        uint8_t bank = (reg_addr & 0x300) >> 8;
+        uint8_t index = reg_addr & 0x1F;
+        emac->reg_shadow[bank][index] = value;
+        emac->reg_shadow_valid[bank] |= 1UL << index;
+    }
+}
+
 /**
  * @brief Write ENC28J60 register
  */
 static esp_err_t enc28j60_register_write(emac_enc28j60_t *emac, uint16_t reg_addr, uint8_t value)
 {
     esp_err_t ret = ESP_OK;
+    uint8_t shadow;
     if (enc28j60_reg_trans_lock(emac)) {
+        if (enc28j60_reg_shadow_get(emac, reg_addr, &shadow) && shadow == value) {
+            goto out; // register already has the value
+        }
         MAC_CHECK(enc28j60_switch_register_bank(emac, (reg_addr & 0xF00) >> 8) == ESP_OK,
                 "switch bank failed", out, ESP_FAIL);
         MAC_CHECK(enc28j60_do_register_write(emac, reg_addr & 0xFF, value) == ESP_OK,
                 "write register failed", out, ESP_FAIL);
+        enc28j60_reg_shadow_set(emac, reg_addr, value);
         enc28j60_reg_trans_unlock(emac);
     } else {
         ret = ESP_ERR_TIMEOUT;
@@ -426,10 +641,14 @@ static esp_err_t enc28j60_register_read(emac_enc28j60_t *emac, uint16_t reg_addr
 {
     esp_err_t ret = ESP_OK;
     if (enc28j60_reg_trans_lock(emac)) {
+        if (enc28j60_reg_shadow_get(emac, reg_addr, value)) {
+            goto out;
+        }
         MAC_CHECK(enc28j60_switch_register_bank(emac, (reg_addr & 0xF00) >> 8) == ESP_OK,
                 "switch bank failed", out, ESP_FAIL);
         MAC_CHECK(enc28j60_do_register_read(emac, !(reg_addr & 0xF000), reg_addr & 0xFF, value) == ESP_OK,
                 "read register failed", out, ESP_FAIL);
+        enc28j60_reg_shadow_set(emac, reg_addr, *value);
         enc28j60_reg_trans_unlock(emac);
     } else {
         ret = ESP_ERR_TIMEOUT;
@@ -441,18 +660,34 @@ out:
 }
 
 /**
- * @brief Read ENC28J60 internal memroy
+ * @brief Set ENC28J60 buffer read pointer
  */
-static esp_err_t enc28j60_read_packet(emac_enc28j60_t *emac, uint32_t addr, uint8_t *packet, uint32_t len)
+static esp_err_t enc28j60_set_read_ptr(emac_enc28j60_t *emac, uint32_t addr)
 {
     esp_err_t ret = ESP_OK;
+    emac->read_ptr = ENC28J60_READ_PTR_UNKNOWN;
     MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERDPTL, addr & 0xFF) == ESP_OK,
               "write ERDPTL failed", out, ESP_FAIL);
     MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERDPTH, (addr & 0xFF00) >> 8) == ESP_OK,
               "write ERDPTH failed", out, ESP_FAIL);
+    emac->read_ptr = addr;
+out:
+    return ret;
+}
+
+/**
+ * @brief Read ENC28J60 internal memroy
+ */
+static esp_err_t enc28j60_read_packet(emac_enc28j60_t *emac, uint32_t addr, uint8_t *packet, uint32_t len)
+{
+    esp_err_t ret = ESP_OK;
+    MAC_CHECK(enc28j60_set_read_ptr(emac, addr) == ESP_OK,
+              "set read pointer failed", out, ESP_FAIL);
     MAC_CHECK(enc28j60_do_memory_read(emac, packet, len) == ESP_OK,
               "read memory failed", out, ESP_FAIL);
 out:
+    // only RX buffer reads track the wrap around of ERDPT
+    emac->read_ptr = ENC28J60_READ_PTR_UNKNOWN;
     return ret;
 }
 
@@ -592,20 +827,167 @@ out:
 }
 
 /**
- * @brief   Clear multicast hash table
+ * @brief Hash table index of MAC address: bits 28:23 of CRC-32 over the address
+ */
+static uint8_t enc28j60_hash_index(const uint8_t *addr)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (int i = 0; i < 6; i++) {
+        uint8_t byte = addr[i];
+        for (int j = 0; j < 8; j++) {
+            bool crc_next = ((crc >> 31) ^ byte) & 0x01;
+            crc <<= 1;
+            if (crc_next) {
+                crc ^= 0x04C11DB7;
+            }
+            byte >>= 1;
+        }
+    }
+    return (crc >> 23) & 0x3F;
+}
+
+/**
+ * @brief Write multicast hash table from the list of MAC filters
  */
-static esp_err_t enc28j60_clear_multicast_table(emac_enc28j60_t *emac)
+static esp_err_t enc28j60_write_multicast_table(emac_enc28j60_t *emac)
 {
     esp_err_t ret = ESP_OK;
+    uint8_t table[8] = {0};
 
-    for (int i = 0; i < 7; i++) {
-        MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EHT0 + i, 0x00) == ESP_OK,
+    portENTER_CRITICAL(&emac->mac_filter_lock);
+    for (int i = 0; i < emac->mac_filter_cnt; i++) {
+        uint8_t index = enc28j60_hash_index(emac->mac_filters[i]);
+        table[index >> 3] |= 1 << (index & 0x07);
+    }
+    portEXIT_CRITICAL(&emac->mac_filter_lock);
+    for (int i = 0; i < 8; i++) {
+        MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EHT0 + i, table[i]) == ESP_OK,
                   "write ENC28J60_EHT%d failed", out, ESP_FAIL, i);
     }
 out:
     return ret;
 }
 
+/**
+ * @brief Hash table filter is used instead of accepting all multicast frames
+ */
+static inline bool enc28j60_hash_filter_active(emac_enc28j60_t *emac)
+{
+    return !emac->promiscuous && !emac->mac_filter_overflow && emac->mac_filter_cnt > 0;
+}
+
+/**
+ * @brief Fill the pattern to match ARP broadcast frames
+ */
+static void enc28j60_arp_pattern(eth_enc28j60_rx_pattern_t *pattern)
+{
+    memset(pattern, 0, sizeof(*pattern));
+    memset(pattern->pattern, 0xFF, 6); // broadcast destination
+    pattern->pattern[12] = 0x08; // EtherType ARP
+    pattern->pattern[13] = 0x06;
+    pattern->mask[0] = 0x3F; // bytes 0-5
+    pattern->mask[1] = 0x30; // bytes 12, 13
+}
+
+/**
+ * @brief Write pattern match filter registers
+ * @note the chip matches the IP checksum of the bytes selected by the mask
+ */
+static esp_err_t enc28j60_write_rx_pattern(emac_enc28j60_t *emac)
+{
+    esp_err_t ret = ESP_OK;
+    const eth_enc28j60_rx_pattern_t *pattern = &emac->rx_pattern;
+    uint32_t sum = 0;
+    bool high_byte = true;
+
+    for (int i = 0; i < sizeof(pattern->pattern); i++) {
+        if (pattern->mask[i >> 3] & (1 << (i & 0x07))) {
+            sum += high_byte ? pattern->pattern[i] << 8 : pattern->pattern[i];
+            high_byte = !high_byte;
+        }
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    uint16_t checksum = ~sum;
+
+    for (int i = 0; i < sizeof(pattern->mask); i++) {
+        MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EPMM0 + i, pattern->mask[i]) == ESP_OK,
+                  "write ENC28J60_EPMM%d failed", out, ESP_FAIL, i);
+    }
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EPMCSL, checksum & 0xFF) == ESP_OK,
+              "write EPMCSL failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EPMCSH, checksum >> 8) == ESP_OK,
+              "write EPMCSH failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EPMOL, pattern->offset & 0xFF) == ESP_OK,
+              "write EPMOL failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EPMOH, pattern->offset >> 8) == ESP_OK,
+              "write EPMOH failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+/**
+ * @brief Write receive filter configuration
+ */
+static esp_err_t enc28j60_update_rx_filter(emac_enc28j60_t *emac)
+{
+    esp_err_t ret = ESP_OK;
+    // filter mode: (unicast OR broadcast/pattern OR multicast) AND crc valid
+    uint8_t erxfcon = ERXFCON_UCEN | ERXFCON_CRCEN;
+    switch (emac->rx_filter) {
+    case ENC28J60_RX_FILTER_UNICAST:
+        break;
+    case ENC28J60_RX_FILTER_UNICAST_ARP:
+    case ENC28J60_RX_FILTER_PATTERN:
+        erxfcon |= ERXFCON_PMEN;
+        break;
+    default:
+        erxfcon |= ERXFCON_BCEN;
+        break;
+    }
+    if (emac->rx_filter != ENC28J60_RX_FILTER_UNICAST) {
+        if (enc28j60_hash_filter_active(emac)) {
+            erxfcon |= ERXFCON_HTEN; // only the joined multicast groups
+        } else if (emac->rx_filter == ENC28J60_RX_FILTER_DEFAULT || emac->mac_filter_overflow) {
+            erxfcon |= ERXFCON_MCEN;
+        }
+    }
+    if (emac->promiscuous) {
+        erxfcon = 0;
+    }
+    if (erxfcon & ERXFCON_PMEN) {
+        MAC_CHECK(enc28j60_write_rx_pattern(emac) == ESP_OK, "write pattern failed", out, ESP_FAIL);
+    }
+    // frames passed by the pattern can have any destination
+    emac->rx_check_dest = (erxfcon & ERXFCON_HTEN) && !(erxfcon & ERXFCON_PMEN);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXFCON, erxfcon) == ESP_OK,
+              "write ERXFCON failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+/**
+ * @brief Check destination of a frame accepted by the hash table filter
+ * @note the hash table passes any address with a matching hash, unicast included
+ */
+static bool enc28j60_rx_frame_wanted(emac_enc28j60_t *emac, const uint8_t *dest)
+{
+    bool wanted = false;
+    if (!(dest[0] & 0x01)) {
+        return memcmp(dest, emac->addr, 6) == 0;
+    }
+    if (memcmp(dest, "\xff\xff\xff\xff\xff\xff", 6) == 0) {
+        return true;
+    }
+    portENTER_CRITICAL(&emac->mac_filter_lock);
+    for (int i = 0; i < emac->mac_filter_cnt && !wanted; i++) {
+        wanted = memcmp(dest, emac->mac_filters[i], 6) == 0;
+    }
+    portEXIT_CRITICAL(&emac->mac_filter_lock);
+    return wanted;
+}
+
 /**
  * @brief Default setup for ENC28J60 internal registers
  */
@@ -618,25 +1000,25 @@ static esp_err_t enc28j60_setup_default(emac_enc28j60_t *emac)
               "write ERXSTL failed", out, ESP_FAIL);
     MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXSTH, (ENC28J60_BUF_RX_START & 0xFF00) >> 8) == ESP_OK,
               "write ERXSTH failed", out, ESP_FAIL);
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXNDL, ENC28J60_BUF_RX_END & 0xFF) == ESP_OK,
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXNDL, emac->rx_end & 0xFF) == ESP_OK,
               "write ERXNDL failed", out, ESP_FAIL);
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXNDH, (ENC28J60_BUF_RX_END & 0xFF00) >> 8) == ESP_OK,
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXNDH, (emac->rx_end & 0xFF00) >> 8) == ESP_OK,
               "write ERXNDH failed", out, ESP_FAIL);
-    uint32_t erxrdpt = enc28j60_next_ptr_align_odd(ENC28J60_BUF_RX_START, ENC28J60_BUF_RX_START, ENC28J60_BUF_RX_END);
+    uint32_t erxrdpt = enc28j60_next_ptr_align_odd(ENC28J60_BUF_RX_START, ENC28J60_BUF_RX_START, emac->rx_end);
     MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXRDPTL, erxrdpt & 0xFF) == ESP_OK,
               "write ERXRDPTL failed", out, ESP_FAIL);
     MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXRDPTH, (erxrdpt & 0xFF00) >> 8) == ESP_OK,
               "write ERXRDPTH failed", out, ESP_FAIL);
 
     // set up transmit buffer start + end
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXSTL, ENC28J60_BUF_TX_START & 0xFF) == ESP_OK,
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXSTL, emac->tx_start & 0xFF) == ESP_OK,
               "write ETXSTL failed", out, ESP_FAIL);
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXSTH, (ENC28J60_BUF_TX_START & 0xFF00) >> 8) == ESP_OK,
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXSTH, (emac->tx_start & 0xFF00) >> 8) == ESP_OK,
               "write ETXSTH failed", out, ESP_FAIL);
 
-    // set up default filter mode: (unicast OR broadcast OR multicast) AND crc valid
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXFCON, ERXFCON_UCEN | ERXFCON_CRCEN | ERXFCON_BCEN | ERXFCON_MCEN) == ESP_OK,
-              "write ERXFCON failed", out, ESP_FAIL);
+    // set up receive filter
+    MAC_CHECK(enc28j60_update_rx_filter(emac) == ESP_OK,
+              "set receive filter failed", out, ESP_FAIL);
 
     // enable MAC receive, enable pause control frame on Tx and Rx path
     MAC_CHECK(enc28j60_register_write(emac, ENC28J60_MACON1, MACON1_MARXEN | MACON1_RXPAUS | MACON1_TXPAUS) == ESP_OK,
@@ -672,13 +1054,19 @@ static esp_err_t emac_enc28j60_start(esp_eth_mac_t *mac)
     MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_EIE, EIE_PKTIE | EIE_INTIE | EIE_TXERIE) == ESP_OK,
               "set EIE.[PKTIE|INTIE] failed", out, ESP_FAIL);
     /* enable rx logic */
+    emac->rx_pkt_pending = 0;
+    if (emac->tx_double_buffer) {
+        /* TX slots from before stop are not transmitted */
+        emac->tx_in_flight = ENC28J60_TX_SLOT_NONE;
+        emac->tx_staged = ENC28J60_TX_SLOT_NONE;
+        emac->tx_next_slot = 0;
+        while (xSemaphoreGive(emac->tx_ready_sem) == pdTRUE);
+    }
     MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_ECON1, ECON1_RXEN) == ESP_OK,
               "set ECON1.RXEN failed", out, ESP_FAIL);
 
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERDPTL, 0x00) == ESP_OK,
-              "write ERDPTL failed", out, ESP_FAIL);
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERDPTH, 0x00) == ESP_OK,
-              "write ERDPTH failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_set_read_ptr(emac, 0x00) == ESP_OK,
+              "set read pointer failed", out, ESP_FAIL);
 out:
     return ret;
 }
@@ -726,6 +1114,74 @@ static inline esp_err_t emac_enc28j60_get_tsv(emac_enc28j60_t *emac, enc28j60_ts
     return enc28j60_read_packet(emac, emac->last_tsv_addr, (uint8_t *)tsv, ENC28J60_TSV_SIZE);
 }
 
+/**
+ * @brief Set TX pointers to the slot and request the transmission
+ * @note double buffer mode, must be called with tx_lock
+ */
+static esp_err_t enc28j60_tx_start_slot(emac_enc28j60_t *emac, uint8_t slot)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t start = emac->tx_start + slot * emac->tx_slot_size;
+    uint32_t end = start + emac->tx_slot_len[slot];
+
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXSTL, start & 0xFF) == ESP_OK,
+              "write ETXSTL failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXSTH, (start & 0xFF00) >> 8) == ESP_OK,
+              "write ETXSTH failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXNDL, end & 0xFF) == ESP_OK,
+              "write ETXNDL failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXNDH, (end & 0xFF00) >> 8) == ESP_OK,
+              "write ETXNDH failed", out, ESP_FAIL);
+    emac->last_tsv_addr = end + 1;
+
+    MAC_CHECK(enc28j60_do_bitwise_clr(emac, ENC28J60_EIR, EIR_TXIF) == ESP_OK,
+              "clear EIR_TXIF failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_EIE, EIE_TXIE) == ESP_OK,
+              "set EIE_TXIE failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_ECON1, ECON1_TXRTS) == ESP_OK,
+              "set ECON1.TXRTS failed", out, ESP_FAIL);
+    emac->tx_in_flight = slot;
+out:
+    return ret;
+}
+
+/**
+ * @brief Release the transmitted slot and start transmission of the staged slot
+ * @note double buffer mode. tx_lock is always taken inside the register lock burst
+ */
+static esp_err_t enc28j60_tx_done(emac_enc28j60_t *emac)
+{
+    esp_err_t ret = ESP_OK;
+    if (!enc28j60_burst_begin(emac)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (xSemaphoreTake(emac->tx_lock, pdMS_TO_TICKS(ENC28J60_REG_TRANS_LOCK_TIMEOUT_MS)) != pdTRUE) {
+        enc28j60_burst_end(emac);
+        return ESP_ERR_TIMEOUT;
+    }
+    MAC_CHECK(enc28j60_do_bitwise_clr(emac, ENC28J60_EIR, EIR_TXIF) == ESP_OK,
+              "clear TXIF failed", out, ESP_FAIL);
+    if (emac->tx_in_flight != ENC28J60_TX_SLOT_NONE) {
+        emac->tx_in_flight = ENC28J60_TX_SLOT_NONE;
+        xSemaphoreGive(emac->tx_ready_sem);
+    }
+    if (emac->tx_staged != ENC28J60_TX_SLOT_NONE) {
+        uint8_t slot = emac->tx_staged;
+        emac->tx_staged = ENC28J60_TX_SLOT_NONE;
+        if (enc28j60_tx_start_slot(emac, slot) != ESP_OK) {
+            xSemaphoreGive(emac->tx_ready_sem); // frame dropped, slot is free
+            MAC_CHECK(false, "start staged frame failed", out, ESP_FAIL);
+        }
+    } else {
+        MAC_CHECK(enc28j60_do_bitwise_clr(emac, ENC28J60_EIE, EIE_TXIE) == ESP_OK,
+                  "clear TXIE failed", out, ESP_FAIL);
+    }
+out:
+    xSemaphoreGive(emac->tx_lock);
+    enc28j60_burst_end(emac);
+    return ret;
+}
+
 static void enc28j60_isr_handler(void *arg)
 {
     emac_enc28j60_t *emac = (emac_enc28j60_t *)arg;
@@ -743,6 +1199,145 @@ static void enc28j60_poll_timer(void *arg)
     xTaskNotifyGive(emac->rx_task_hdl);
 }
 
+static void enc28j60_rx_pool_set_range(enc28j60_rx_pool_t *pool, uintptr_t start, uintptr_t end)
+{
+    atomic_fetch_add(&pool->seq, 1);
+    atomic_store(&pool->start, start);
+    atomic_store(&pool->end, end);
+    atomic_fetch_add(&pool->seq, 1);
+}
+
+/**
+ * @brief Allocate RX pool in a free slot for emac_enc28j60_free_rx_buffer
+ */
+static enc28j60_rx_pool_t *enc28j60_rx_pool_create(uint32_t count)
+{
+    uint8_t *mem = heap_caps_malloc(count * ENC28J60_RX_POOL_BUF_SIZE, MALLOC_CAP_DMA);
+    if (!mem) {
+        return NULL;
+    }
+    for (int i = 0; i < ENC28J60_RX_POOL_MAX_INSTANCES; i++) {
+        enc28j60_rx_pool_t *pool = &s_rx_pools[i];
+        bool used = false;
+        if (atomic_compare_exchange_strong(&pool->used, &used, true)) {
+            pool->mem = mem;
+            pool->count = count;
+            atomic_store(&pool->free_mask, count == 32 ? UINT32_MAX : (1UL << count) - 1);
+            atomic_store(&pool->refs, 1);
+            enc28j60_rx_pool_set_range(pool, (uintptr_t)mem, (uintptr_t)(mem + count * ENC28J60_RX_POOL_BUF_SIZE));
+            return pool;
+        }
+    }
+    free(mem);
+    return NULL;
+}
+
+/**
+ * @brief Drop a reference to the pool, the last one frees the memory and the slot
+ */
+static void enc28j60_rx_pool_unref(enc28j60_rx_pool_t *pool)
+{
+    if (atomic_fetch_sub(&pool->refs, 1) != 1) {
+        return;
+    }
+    enc28j60_rx_pool_set_range(pool, 0, 0);
+    free(pool->mem);
+    pool->mem = NULL;
+    atomic_store(&pool->used, false);
+}
+
+/**
+ * @brief Free RX pool
+ * @note If the stack still holds some of the buffers, the pool is freed when the last of them is returned.
+ */
+static void enc28j60_rx_pool_delete(enc28j60_rx_pool_t *pool)
+{
+    if (atomic_load(&pool->refs) > 1) {
+        ESP_LOGD(TAG, "RX buffers still in use, pool freed later");
+    }
+    enc28j60_rx_pool_unref(pool);
+}
+
+static uint8_t *enc28j60_rx_pool_get(enc28j60_rx_pool_t *pool)
+{
+    uint32_t mask = atomic_load(&pool->free_mask);
+    while (mask) {
+        uint32_t slot = __builtin_ctz(mask);
+        if (atomic_compare_exchange_weak(&pool->free_mask, &mask, mask & ~(1UL << slot))) {
+            atomic_fetch_add(&pool->refs, 1);
+            return pool->mem + slot * ENC28J60_RX_POOL_BUF_SIZE;
+        }
+    }
+    return NULL;
+}
+
+static bool enc28j60_rx_pool_owns(enc28j60_rx_pool_t *pool, const uint8_t *buf)
+{
+    return buf >= pool->mem && buf < pool->mem + pool->count * ENC28J60_RX_POOL_BUF_SIZE;
+}
+
+static void enc28j60_rx_pool_put(enc28j60_rx_pool_t *pool, uint8_t *buf)
+{
+    atomic_fetch_or(&pool->free_mask, 1UL << ((buf - pool->mem) / ENC28J60_RX_POOL_BUF_SIZE));
+    enc28j60_rx_pool_unref(pool);
+}
+
+/**
+ * @brief Find the pool of a buffer the stack returns, NULL for a heap buffer
+ * @note The pool of a buffer which is out can't change its range, so a slot which is
+ *       changing while it is checked can't be the owner and is skipped.
+ */
+static enc28j60_rx_pool_t *enc28j60_rx_pool_find(const void *buffer)
+{
+    uintptr_t buf = (uintptr_t)buffer;
+    for (int i = 0; i < ENC28J60_RX_POOL_MAX_INSTANCES; i++) {
+        enc28j60_rx_pool_t *pool = &s_rx_pools[i];
+        uint32_t seq = atomic_load(&pool->seq);
+        if (seq & 1) {
+            continue;
+        }
+        bool inside = buf >= atomic_load(&pool->start) && buf < atomic_load(&pool->end);
+        if (inside && atomic_load(&pool->seq) == seq) {
+            return pool;
+        }
+    }
+    return NULL;
+}
+
+void emac_enc28j60_free_rx_buffer(void *h, void *buffer)
+{
+    enc28j60_rx_pool_t *pool = enc28j60_rx_pool_find(buffer);
+    if (pool) {
+        enc28j60_rx_pool_put(pool, buffer);
+    } else {
+        free(buffer);
+    }
+}
+
+/**
+ * @brief Get a buffer for a received frame, from the pool if configured, else from heap
+ */
+static uint8_t *enc28j60_alloc_rx_buffer(emac_enc28j60_t *emac)
+{
+    if (emac->rx_pool) {
+        uint8_t *buffer = enc28j60_rx_pool_get(emac->rx_pool);
+        if (buffer) {
+            return buffer;
+        }
+        emac->stats.rx_pool_exhausted++;
+    }
+    return heap_caps_malloc(ETH_MAX_PACKET_SIZE, MALLOC_CAP_DMA);
+}
+
+static void enc28j60_free_rx_buffer(emac_enc28j60_t *emac, uint8_t *buffer)
+{
+    if (emac->rx_pool && enc28j60_rx_pool_owns(emac->rx_pool, buffer)) {
+        enc28j60_rx_pool_put(emac->rx_pool, buffer);
+    } else {
+        free(buffer);
+    }
+}
+
 /**
  * @brief Main ENC28J60 Task. Mainly used for Rx processing. However, it also handles other interrupts.
  *
@@ -754,11 +1349,25 @@ static void emac_enc28j60_task(void *arg)
     uint8_t mask = 0;
     uint8_t *buffer = NULL;
     uint32_t length = 0;
+    bool rx_poll_next = false;
 
     while (1) {
 loop_start:
+        rx_poll_next = false;
         // block until some task notifies me or check the gpio by myself
-        if (emac->int_gpio_num >= 0) {                                   // if in interrupt mode
+        if (emac->rx_polling) {
+            // adaptive mode under load: the interrupt stays masked, let other tasks of the same priority
+            // run between the passes. taskYIELD doesn't let lower priority tasks run, so after
+            // ENC28J60_RX_POLL_TICKS of polling the task sleeps a tick. the chip buffers the frames meanwhile
+            ulTaskNotifyTake(pdTRUE, 0);
+            if (xTaskGetTickCount() - emac->rx_poll_since >= ENC28J60_RX_POLL_TICKS) {
+                vTaskDelay(1);
+                emac->rx_poll_since = xTaskGetTickCount();
+            } else {
+                taskYIELD();
+            }
+            emac->stats.rx_poll_passes++;
+        } else if (emac->int_gpio_num >= 0) {                                   // if in interrupt mode
             if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) == 0 &&    // if no notification ...
                 gpio_get_level(emac->int_gpio_num) != 0) {               // ...and no interrupt asserted
                 continue;                                                // -> just continue to check again
@@ -766,6 +1375,9 @@ loop_start:
         } else {
             ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         }
+        if (atomic_load(&emac->rx_task_exit)) {
+            break;
+        }
         // the host controller should clear the global enable bit for the interrupt pin before servicing the interrupt
         MAC_CHECK_NO_RET(enc28j60_do_bitwise_clr(emac, ENC28J60_EIE, EIE_INTIE) == ESP_OK,
                         "clear EIE_INTIE failed", loop_start);
@@ -774,6 +1386,12 @@ loop_start:
                         "read EIR failed", loop_end);
         MAC_CHECK_NO_RET(enc28j60_do_register_read(emac, true, ENC28J60_EIE, &mask) == ESP_OK,
                         "read EIE failed", loop_end);
+        // the receive error interrupt is not enabled, the flag is only counted
+        if (status & EIR_RXERIF) {
+            emac->stats.rx_overflows++;
+            MAC_CHECK_NO_RET(enc28j60_do_bitwise_clr(emac, ENC28J60_EIR, EIR_RXERIF) == ESP_OK,
+                            "clear RXERIF failed", loop_end);
+        }
         status &= mask;
 
         // When source of interrupt is unknown, try to check if there is packet waiting (Errata #6 workaround)
@@ -790,26 +1408,32 @@ loop_start:
 
         // packet received
         if (status & EIR_PKTIF) {
+            uint32_t frames = 0;
             do {
                 length = ETH_MAX_PACKET_SIZE;
-                buffer = heap_caps_malloc(length, MALLOC_CAP_DMA);
+                buffer = enc28j60_alloc_rx_buffer(emac);
                 if (!buffer) {
+                    emac->stats.rx_no_buffer++;
                     ESP_LOGE(TAG, "no mem for receive buffer");
                 } else if (emac->parent.receive(&emac->parent, buffer, &length) == ESP_OK) {
                     /* pass the buffer to stack (e.g. TCP/IP layer) */
                     if (length) {
                         emac->eth->stack_input(emac->eth, buffer, length);
                     } else {
-                        free(buffer);
+                        enc28j60_free_rx_buffer(emac, buffer);
                     }
                 } else {
-                    free(buffer);
+                    enc28j60_free_rx_buffer(emac, buffer);
                 }
-            } while (emac->packets_remain);
+                frames++;
+            } while (emac->packets_remain && (!emac->rx_poll_budget || frames < emac->rx_poll_budget));
+            // budget exhausted, the chip isn't empty
+            rx_poll_next = emac->packets_remain;
         }
 
         // transmit error
         if (status & EIR_TXERIF) {
+            emac->stats.tx_errors++;
             // Errata #12/#13 workaround - reset Tx state machine
             MAC_CHECK_NO_RET(enc28j60_do_bitwise_set(emac, ENC28J60_ECON1, ECON1_TXRST) == ESP_OK,
                             "set TXRST failed", loop_end);
@@ -841,7 +1465,11 @@ loop_start:
         }
 
         // transmit ready
-        if (status & EIR_TXIF) {
+        if ((status & EIR_TXIF) && emac->tx_double_buffer) {
+            // release the slot and issue TXRTS for the frame uploaded in the meantime
+            MAC_CHECK_NO_RET(enc28j60_tx_done(emac) == ESP_OK,
+                            "handle tx done failed", loop_end);
+        } else if (status & EIR_TXIF) {
             MAC_CHECK_NO_RET(enc28j60_do_bitwise_clr(emac, ENC28J60_EIR, EIR_TXIF) == ESP_OK,
                             "clear TXIF failed", loop_end);
             MAC_CHECK_NO_RET(enc28j60_do_bitwise_clr(emac, ENC28J60_EIE, EIE_TXIE) == ESP_OK,
@@ -850,12 +1478,25 @@ loop_start:
             xSemaphoreGive(emac->tx_ready_sem);
         }
 loop_end:
+        if (rx_poll_next != emac->rx_polling) {
+            emac->rx_polling = rx_poll_next;
+            if (rx_poll_next) {
+                emac->rx_poll_since = xTaskGetTickCount();
+                emac->stats.rx_poll_entries++;
+            } else {
+                emac->stats.rx_poll_exits++;
+            }
+        }
+        if (emac->rx_polling) {
+            continue; // the interrupt is re-enabled when a pass finds the chip empty
+        }
         // restore global enable interrupt bit
         MAC_CHECK_NO_RET(enc28j60_do_bitwise_set(emac, ENC28J60_EIE, EIE_INTIE) == ESP_OK,
                             "clear INTIE failed", loop_start);
         // Note: Interrupt flag PKTIF is cleared when PKTDEC is set (in receive function)
     }
-    vTaskDelete(NULL);
+    // wait for emac_enc28j60_del, which deletes the task while it is suspended
+    vTaskSuspend(NULL);
 }
 
 static esp_err_t emac_enc28j60_set_link(esp_eth_mac_t *mac, eth_link_t link)
@@ -934,12 +1575,365 @@ static esp_err_t emac_enc28j60_set_promiscuous(esp_eth_mac_t *mac, bool enable)
 {
     esp_err_t ret = ESP_OK;
     emac_enc28j60_t *emac = __containerof(mac, emac_enc28j60_t, parent);
-    if (enable) {
-        MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXFCON, 0x00) == ESP_OK,
-                  "write ERXFCON failed", out, ESP_FAIL);
+    emac->promiscuous = enable;
+    MAC_CHECK(enc28j60_update_rx_filter(emac) == ESP_OK,
+              "set receive filter failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+esp_err_t emac_enc28j60_set_rx_filter(esp_eth_mac_t *mac, eth_enc28j60_rx_filter_t filter, const eth_enc28j60_rx_pattern_t *pattern)
+{
+    esp_err_t ret = ESP_OK;
+    MAC_CHECK(mac, "can't set rx filter to null", out, ESP_ERR_INVALID_ARG);
+    MAC_CHECK(filter <= ENC28J60_RX_FILTER_PATTERN, "invalid rx filter", out, ESP_ERR_INVALID_ARG);
+    MAC_CHECK(filter != ENC28J60_RX_FILTER_PATTERN || pattern, "rx filter pattern missing", out, ESP_ERR_INVALID_ARG);
+    MAC_CHECK(!pattern || pattern->offset < ENC28J60_BUFFER_SIZE, "invalid rx filter pattern offset", out, ESP_ERR_INVALID_ARG);
+    emac_enc28j60_t *emac = __containerof(mac, emac_enc28j60_t, parent);
+    emac->rx_filter = filter;
+    if (filter == ENC28J60_RX_FILTER_UNICAST_ARP) {
+        enc28j60_arp_pattern(&emac->rx_pattern);
+    } else if (filter == ENC28J60_RX_FILTER_PATTERN) {
+        emac->rx_pattern = *pattern;
+    }
+    MAC_CHECK(enc28j60_update_rx_filter(emac) == ESP_OK, "set receive filter failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+esp_err_t emac_enc28j60_add_mac_filter(esp_eth_mac_t *mac, uint8_t *addr)
+{
+    esp_err_t ret = ESP_OK;
+    MAC_CHECK(mac && addr, "can't set mac filter to null", out, ESP_ERR_INVALID_ARG);
+    MAC_CHECK(addr[0] & 0x01, "only multicast address can be filtered", out, ESP_ERR_INVALID_ARG);
+    emac_enc28j60_t *emac = __containerof(mac, emac_enc28j60_t, parent);
+    bool found = false;
+    portENTER_CRITICAL(&emac->mac_filter_lock);
+    for (int i = 0; i < emac->mac_filter_cnt && !found; i++) {
+        found = memcmp(addr, emac->mac_filters[i], 6) == 0;
+    }
+    if (!found) {
+        if (emac->mac_filter_cnt < ENC28J60_MAC_FILTER_MAX) {
+            memcpy(emac->mac_filters[emac->mac_filter_cnt], addr, 6);
+            emac->mac_filter_cnt++;
+        } else {
+            emac->mac_filter_overflow++;
+        }
+    }
+    portEXIT_CRITICAL(&emac->mac_filter_lock);
+    if (found) {
+        return ESP_OK;
+    }
+    if (emac->mac_filter_overflow) {
+        ESP_LOGW(TAG, "too many multicast filters, receiving all multicast");
+    }
+    MAC_CHECK(enc28j60_write_multicast_table(emac) == ESP_OK, "write multicast table failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_update_rx_filter(emac) == ESP_OK, "set receive filter failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+esp_err_t emac_enc28j60_rm_mac_filter(esp_eth_mac_t *mac, uint8_t *addr)
+{
+    esp_err_t ret = ESP_OK;
+    MAC_CHECK(mac && addr, "can't remove null mac filter", out, ESP_ERR_INVALID_ARG);
+    emac_enc28j60_t *emac = __containerof(mac, emac_enc28j60_t, parent);
+    bool found = false;
+    portENTER_CRITICAL(&emac->mac_filter_lock);
+    for (int i = 0; i < emac->mac_filter_cnt; i++) {
+        if (memcmp(addr, emac->mac_filters[i], 6) == 0) {
+            emac->mac_filter_cnt--;
+            memcpy(emac->mac_filters[i], emac->mac_filters[emac->mac_filter_cnt], 6);
+            found = true;
+            break;
+        }
+    }
+    if (!found && emac->mac_filter_overflow > 0) {
+        // one of the filters that didn't fit into the list
+        emac->mac_filter_overflow--;
+        found = true;
+    }
+    portEXIT_CRITICAL(&emac->mac_filter_lock);
+    MAC_CHECK(found, "mac filter not found", out, ESP_ERR_NOT_FOUND);
+    MAC_CHECK(enc28j60_write_multicast_table(emac) == ESP_OK, "write multicast table failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_update_rx_filter(emac) == ESP_OK, "set receive filter failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+/**
+ * @brief Write data to ENC28J60 buffer memory at address
+ */
+static esp_err_t enc28j60_write_mem_at(emac_enc28j60_t *emac, uint32_t addr, uint8_t *data, uint32_t len)
+{
+    esp_err_t ret = ESP_OK;
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EWRPTL, addr & 0xFF) == ESP_OK,
+              "write EWRPTL failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EWRPTH, (addr & 0xFF00) >> 8) == ESP_OK,
+              "write EWRPTH failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_do_memory_write(emac, data, len) == ESP_OK,
+              "buffer memory write failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+/**
+ * @brief Compute Internet checksum of buffer memory range [start, end] with the DMA engine
+ * @note the result is in network byte order, ready to be written to the frame
+ */
+static esp_err_t enc28j60_dma_checksum(emac_enc28j60_t *emac, uint32_t start, uint32_t end, uint8_t *csum)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t econ1 = 0;
+    uint32_t to = 0;
+
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EDMASTL, start & 0xFF) == ESP_OK,
+              "write EDMASTL failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EDMASTH, (start & 0xFF00) >> 8) == ESP_OK,
+              "write EDMASTH failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EDMANDL, end & 0xFF) == ESP_OK,
+              "write EDMANDL failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EDMANDH, (end & 0xFF00) >> 8) == ESP_OK,
+              "write EDMANDH failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_ECON1, ECON1_CSUMEN | ECON1_DMAST) == ESP_OK,
+              "set ECON1.DMAST failed", out, ESP_FAIL);
+    /* polling the busy flag */
+    do {
+        MAC_CHECK(enc28j60_do_register_read(emac, true, ENC28J60_ECON1, &econ1) == ESP_OK,
+                  "read ECON1 failed", out, ESP_FAIL);
+        if (econ1 & ECON1_DMAST) {
+            esp_rom_delay_us(5);
+            to += 5;
+        }
+    } while ((econ1 & ECON1_DMAST) && to < ENC28J60_DMA_TIMEOUT_US);
+    MAC_CHECK(!(econ1 & ECON1_DMAST), "DMA checksum timeout", out, ESP_ERR_TIMEOUT);
+    MAC_CHECK(enc28j60_do_bitwise_clr(emac, ENC28J60_ECON1, ECON1_CSUMEN) == ESP_OK,
+              "clear ECON1.CSUMEN failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_read(emac, ENC28J60_EDMACSH, &csum[0]) == ESP_OK,
+              "read EDMACSH failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_read(emac, ENC28J60_EDMACSL, &csum[1]) == ESP_OK,
+              "read EDMACSL failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+/**
+ * @brief Software Internet checksum, used for the frames the DMA engine can't cover in one range
+ */
+static uint16_t enc28j60_sw_checksum(uint32_t sum, const uint8_t *data, uint32_t len)
+{
+    for (uint32_t i = 0; i + 1 < len; i += 2) {
+        sum += (data[i] << 8) | data[i + 1];
+    }
+    if (len & 1) {
+        sum += data[len - 1] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return ~sum;
+}
+
+/**
+ * @brief Fill TCP/UDP checksum of an IPv6 packet uploaded to buffer memory at ip_addr
+ * @note Without extension headers the addresses and the segment are one DMA range, like for IPv4.
+ *       Fragmented datagrams are left as lwIP built them.
+ */
+static esp_err_t enc28j60_tx_checksum_ip6(emac_enc28j60_t *emac, uint32_t ip_addr, const uint8_t *ip, uint32_t length)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t csum[2] = {0, 0};
+    uint32_t payload_len = (ip[4] << 8) | ip[5];
+    uint8_t proto = ip[6];
+    uint32_t l4_off = 40;
+
+    if ((ip[0] >> 4) != 6 || 40 + payload_len > length) {
+        return ESP_OK;
+    }
+    // hop-by-hop, routing and destination options headers
+    while ((proto == 0 || proto == 43 || proto == 60) && l4_off + 8 <= 40 + payload_len) {
+        proto = ip[l4_off];
+        l4_off += (ip[l4_off + 1] + 1) * 8;
+    }
+    if (l4_off > 40 + payload_len) {
+        return ESP_OK;
+    }
+    uint32_t l4_len = 40 + payload_len - l4_off;
+    uint32_t csum_off;
+    if (proto == 6 && l4_len >= 20) {
+        csum_off = 16;
+    } else if (proto == 17 && l4_len >= 8) {
+        csum_off = 6;
+    } else {
+        return ESP_OK;
+    }
+    uint32_t pseudo = proto + l4_len;
+    if (l4_off == 40) {
+        csum[0] = pseudo >> 8;
+        csum[1] = pseudo & 0xFF;
+        MAC_CHECK(enc28j60_write_mem_at(emac, ip_addr + l4_off + csum_off, csum, 2) == ESP_OK, "preset L4 checksum failed", out, ESP_FAIL);
+        MAC_CHECK(enc28j60_dma_checksum(emac, ip_addr + 8, ip_addr + 40 + payload_len - 1, csum) == ESP_OK, "L4 checksum failed", out, ESP_FAIL);
+    } else {
+        const uint8_t *l4 = ip + l4_off;
+        uint32_t sum = pseudo;
+        for (int i = 8; i < 40; i += 2) {
+            sum += (ip[i] << 8) | ip[i + 1];
+        }
+        sum += 0xFFFF - ((l4[csum_off] << 8) | l4[csum_off + 1]); // cancels the field's value summed below
+        uint16_t sw_csum = enc28j60_sw_checksum(sum, l4, l4_len);
+        csum[0] = sw_csum >> 8;
+        csum[1] = sw_csum & 0xFF;
+    }
+    if (proto == 17 && csum[0] == 0 && csum[1] == 0) {
+        csum[0] = csum[1] = 0xFF; // UDP checksum 0 is not allowed with IPv6
+    }
+    MAC_CHECK(enc28j60_write_mem_at(emac, ip_addr + l4_off + csum_off, csum, 2) == ESP_OK, "write L4 checksum failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+/**
+ * @brief Fill IPv4 header and TCP/UDP checksums of the frame uploaded to buffer memory at frame_addr
+ * @note For TCP/UDP the checksum field is preset with protocol and length from the pseudo header,
+ *       then one DMA range from the source IP address to the end of the segment covers the rest.
+ */
+static esp_err_t enc28j60_tx_checksum(emac_enc28j60_t *emac, uint32_t frame_addr, const uint8_t *frame, uint32_t length)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t csum[2] = {0, 0};
+    uint32_t l3 = 14;
+    uint16_t type = (frame[12] << 8) | frame[13];
+
+    if (type == 0x8100 && length >= 18) { // VLAN tag
+        l3 = 18;
+        type = (frame[16] << 8) | frame[17];
+    }
+    if (type == 0x86DD && length >= l3 + 40) {
+        return enc28j60_tx_checksum_ip6(emac, frame_addr + l3, frame + l3, length - l3);
+    }
+    if (type != 0x0800 || length < l3 + 20) {
+        return ESP_OK; // not IP
+    }
+    const uint8_t *ip = frame + l3;
+    uint32_t ihl = (ip[0] & 0x0F) * 4;
+    uint32_t tot_len = (ip[2] << 8) | ip[3];
+    if ((ip[0] >> 4) != 4 || ihl < 20 || tot_len < ihl || l3 + tot_len > length) {
+        return ESP_OK;
+    }
+    uint32_t ip_addr = frame_addr + l3;
+
+    // IPv4 header checksum
+    MAC_CHECK(enc28j60_write_mem_at(emac, ip_addr + 10, csum, 2) == ESP_OK, "clear IP checksum failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_dma_checksum(emac, ip_addr, ip_addr + ihl - 1, csum) == ESP_OK, "IP checksum failed", out, ESP_FAIL);
+    MAC_CHECK(enc28j60_write_mem_at(emac, ip_addr + 10, csum, 2) == ESP_OK, "write IP checksum failed", out, ESP_FAIL);
+
+    // TCP/UDP checksum, fragmented datagrams are sent without it (UDP checksum 0)
+    if (((ip[6] & 0x3F) | ip[7]) != 0) {
+        return ESP_OK;
+    }
+    uint8_t proto = ip[9];
+    uint32_t l4_len = tot_len - ihl;
+    uint32_t csum_off;
+    if (proto == 6 && l4_len >= 20) {
+        csum_off = 16;
+    } else if (proto == 17 && l4_len >= 8) {
+        csum_off = 6;
+    } else {
+        return ESP_OK;
+    }
+    uint32_t pseudo = proto + l4_len;
+    if (ihl == 20) {
+        csum[0] = pseudo >> 8;
+        csum[1] = pseudo & 0xFF;
+        MAC_CHECK(enc28j60_write_mem_at(emac, ip_addr + ihl + csum_off, csum, 2) == ESP_OK, "preset L4 checksum failed", out, ESP_FAIL);
+        MAC_CHECK(enc28j60_dma_checksum(emac, ip_addr + 12, ip_addr + tot_len - 1, csum) == ESP_OK, "L4 checksum failed", out, ESP_FAIL);
+    } else {
+        // IP options are between addresses and segment, not covered by one DMA range
+        const uint8_t *l4 = ip + ihl;
+        uint32_t sum = pseudo;
+        for (int i = 12; i < 20; i += 2) {
+            sum += (ip[i] << 8) | ip[i + 1];
+        }
+        sum += 0xFFFF - ((l4[csum_off] << 8) | l4[csum_off + 1]); // cancels the field's value summed below
+        uint16_t sw_csum = enc28j60_sw_checksum(sum, l4, l4_len);
+        csum[0] = sw_csum >> 8;
+        csum[1] = sw_csum & 0xFF;
+    }
+    if (proto == 17 && csum[0] == 0 && csum[1] == 0) {
+        csum[0] = csum[1] = 0xFF; // UDP checksum 0 means no checksum
+    }
+    MAC_CHECK(enc28j60_write_mem_at(emac, ip_addr + ihl + csum_off, csum, 2) == ESP_OK, "write L4 checksum failed", out, ESP_FAIL);
+out:
+    return ret;
+}
+
+/**
+ * @brief Transmit in double buffer mode: upload the frame while the previous one is on the wire
+ */
+static esp_err_t enc28j60_transmit_double_buffer(emac_enc28j60_t *emac, uint8_t *buf, uint32_t length)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t econ1 = 0;
+    uint8_t slot = ENC28J60_TX_SLOT_NONE;
+
+    MAC_CHECK(1 + length + ENC28J60_TSV_SIZE <= emac->tx_slot_size, "frame too long", out, ESP_ERR_INVALID_SIZE);
+    if (xSemaphoreTake(emac->tx_ready_sem, pdMS_TO_TICKS(ENC28J60_TX_READY_TIMEOUT_MS)) == pdFALSE) {
+        emac->stats.tx_timeouts++;
+        ESP_LOGW(TAG, "tx_ready_sem expired");
+        // TX done may have been missed, recover if the chip is idle
+        MAC_CHECK(enc28j60_do_register_read(emac, true, ENC28J60_ECON1, &econ1) == ESP_OK,
+                  "read ECON1 failed", out, ESP_FAIL);
+        MAC_CHECK(!(econ1 & ECON1_TXRTS), "last transmit still in progress", out, ESP_ERR_INVALID_STATE);
+        MAC_CHECK(enc28j60_tx_done(emac) == ESP_OK, "handle tx done failed", out, ESP_FAIL);
+        MAC_CHECK(xSemaphoreTake(emac->tx_ready_sem, 0) == pdTRUE, "no free TX slot", out, ESP_ERR_TIMEOUT);
     }
+    MAC_CHECK(enc28j60_burst_begin(emac), "register lock timeout", err, ESP_ERR_TIMEOUT);
+    // slots are transmitted in order, so a free slot is always the next one. the slot is claimed,
+    // uploaded and queued in one burst, so concurrent transmits can't reorder or share the slots
+    slot = emac->tx_next_slot;
+    emac->tx_next_slot ^= 1;
+    uint32_t start = emac->tx_start + slot * emac->tx_slot_size;
+
+    /* copy data to tx memory of the slot */
+    uint32_t spi_transactions = emac->stats.spi_transactions;
+    uint64_t spi_bytes = emac->stats.spi_bytes;
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EWRPTL, start & 0xFF) == ESP_OK,
+              "write EWRPTL failed", err_burst, ESP_FAIL);
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EWRPTH, (start & 0xFF00) >> 8) == ESP_OK,
+              "write EWRPTH failed", err_burst, ESP_FAIL);
+    uint8_t per_pkt_control = 0; // MACON3 will be used to determine how the packet will be transmitted
+    MAC_CHECK(enc28j60_do_memory_write(emac, &per_pkt_control, 1) == ESP_OK,
+              "write packet control byte failed", err_burst, ESP_FAIL);
+    MAC_CHECK(enc28j60_do_memory_write(emac, buf, length) == ESP_OK,
+              "buffer memory write failed", err_burst, ESP_FAIL);
+    emac->tx_slot_len[slot] = length;
+    if (emac->tx_checksum_offload) {
+        MAC_CHECK(enc28j60_tx_checksum(emac, start + 1, buf, length) == ESP_OK,
+                  "checksum offload failed", err_burst, ESP_FAIL);
+    }
+    emac->stats.tx_frames++;
+    enc28j60_count_frame_spi(emac, &emac->stats.tx_spi_transactions, &emac->stats.tx_spi_bytes, spi_transactions, spi_bytes);
+
+    /* transmit now if the chip is idle, else the TX done handler issues the request */
+    MAC_CHECK(xSemaphoreTake(emac->tx_lock, pdMS_TO_TICKS(ENC28J60_REG_TRANS_LOCK_TIMEOUT_MS)) == pdTRUE,
+              "tx lock timeout", err_burst, ESP_ERR_TIMEOUT);
+    if (emac->tx_in_flight == ENC28J60_TX_SLOT_NONE) {
+        ret = enc28j60_tx_start_slot(emac, slot);
+    } else {
+        emac->tx_staged = slot;
+    }
+    xSemaphoreGive(emac->tx_lock);
+    MAC_CHECK(ret == ESP_OK, "start transmit failed", err_burst, ret);
+    enc28j60_burst_end(emac);
 out:
     return ret;
+err_burst:
+    // still in the burst, so no other transmit claimed a slot after this one
+    emac->tx_next_slot = slot;
+    enc28j60_burst_end(emac);
+err:
+    xSemaphoreGive(emac->tx_ready_sem);
+    return ret;
 }
 
 static esp_err_t emac_enc28j60_transmit(esp_eth_mac_t *mac, uint8_t *buf, uint32_t length)
@@ -948,24 +1942,35 @@ static esp_err_t emac_enc28j60_transmit(esp_eth_mac_t *mac, uint8_t *buf, uint32
     emac_enc28j60_t *emac = __containerof(mac, emac_enc28j60_t, parent);
     uint8_t econ1 = 0;
 
+    if (emac->tx_double_buffer) {
+        return enc28j60_transmit_double_buffer(emac, buf, length);
+    }
+
     /* ENC28J60 may be a bottle neck in Eth communication. Hence we need to check if it is ready. */
     if (xSemaphoreTake(emac->tx_ready_sem, pdMS_TO_TICKS(ENC28J60_TX_READY_TIMEOUT_MS)) == pdFALSE) {
+        emac->stats.tx_timeouts++;
         ESP_LOGW(TAG, "tx_ready_sem expired");
     }
+    if (!enc28j60_burst_begin(emac)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    uint32_t spi_transactions = emac->stats.spi_transactions;
+    uint64_t spi_bytes = emac->stats.spi_bytes;
     MAC_CHECK(enc28j60_do_register_read(emac, true, ENC28J60_ECON1, &econ1) == ESP_OK,
             "read ECON1 failed", out, ESP_FAIL);
     MAC_CHECK(!(econ1 & ECON1_TXRTS), "last transmit still in progress", out, ESP_ERR_INVALID_STATE);
+    MAC_CHECK(emac->tx_start + 1 + length + ENC28J60_TSV_SIZE <= ENC28J60_BUFFER_SIZE, "frame too long", out, ESP_ERR_INVALID_SIZE);
 
     /* Set the write pointer to start of transmit buffer area */
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EWRPTL, ENC28J60_BUF_TX_START & 0xFF) == ESP_OK,
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EWRPTL, emac->tx_start & 0xFF) == ESP_OK,
               "write EWRPTL failed", out, ESP_FAIL);
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EWRPTH, (ENC28J60_BUF_TX_START & 0xFF00) >> 8) == ESP_OK,
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_EWRPTH, (emac->tx_start & 0xFF00) >> 8) == ESP_OK,
               "write EWRPTH failed", out, ESP_FAIL);
 
     /* Set the end pointer to correspond to the packet size given */
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXNDL, (ENC28J60_BUF_TX_START + length) & 0xFF) == ESP_OK,
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXNDL, (emac->tx_start + length) & 0xFF) == ESP_OK,
               "write ETXNDL failed", out, ESP_FAIL);
-    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXNDH, ((ENC28J60_BUF_TX_START + length) & 0xFF00) >> 8) == ESP_OK,
+    MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ETXNDH, ((emac->tx_start + length) & 0xFF00) >> 8) == ESP_OK,
               "write ETXNDH failed", out, ESP_FAIL);
 
     /* copy data to tx memory */
@@ -974,7 +1979,11 @@ static esp_err_t emac_enc28j60_transmit(esp_eth_mac_t *mac, uint8_t *buf, uint32
               "write packet control byte failed", out, ESP_FAIL);
     MAC_CHECK(enc28j60_do_memory_write(emac, buf, length) == ESP_OK,
               "buffer memory write failed", out, ESP_FAIL);
-    emac->last_tsv_addr = ENC28J60_BUF_TX_START + length + 1;
+    emac->last_tsv_addr = emac->tx_start + length + 1;
+    if (emac->tx_checksum_offload) {
+        MAC_CHECK(enc28j60_tx_checksum(emac, emac->tx_start + 1, buf, length) == ESP_OK,
+                  "checksum offload failed", out, ESP_FAIL);
+    }
 
     /* enable Tx Interrupt to indicate next Tx ready state */
     MAC_CHECK(enc28j60_do_bitwise_clr(emac, ENC28J60_EIR, EIR_TXIF) == ESP_OK,
@@ -985,7 +1994,10 @@ static esp_err_t emac_enc28j60_transmit(esp_eth_mac_t *mac, uint8_t *buf, uint32
     /* issue tx polling command */
     MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_ECON1, ECON1_TXRTS) == ESP_OK,
               "set ECON1.TXRTS failed", out, ESP_FAIL);
+    emac->stats.tx_frames++;
 out:
+    enc28j60_count_frame_spi(emac, &emac->stats.tx_spi_transactions, &emac->stats.tx_spi_bytes, spi_transactions, spi_bytes);
+    enc28j60_burst_end(emac);
     return ret;
 }
 
@@ -996,22 +2008,54 @@ static esp_err_t emac_enc28j60_receive(esp_eth_mac_t *mac, uint8_t *buf, uint32_
     uint8_t pk_counter = 0;
     uint16_t rx_len = 0;
     uint32_t next_packet_addr = 0;
-    __attribute__((aligned(4))) enc28j60_rx_header_t header; // SPI driver needs the rx buffer 4 byte align
+    // receive status vector followed by the beginning of the frame
+    __attribute__((aligned(4))) uint8_t rx_head[ENC28J60_RSV_SIZE + ENC28J60_RX_SPECULATIVE_LEN]; // SPI driver needs the rx buffer 4 byte align
+    enc28j60_rx_header_t *header = (enc28j60_rx_header_t *)rx_head;
 
-    // read packet header
-    MAC_CHECK(enc28j60_read_packet(emac, emac->next_packet_ptr, (uint8_t *)&header, sizeof(header)) == ESP_OK,
+    if (!enc28j60_burst_begin(emac)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    uint32_t spi_transactions = emac->stats.spi_transactions;
+    uint64_t spi_bytes = emac->stats.spi_bytes;
+    // ERDPT auto-increments, so after the previous packet it usually already points to this one
+    if (emac->read_ptr != emac->next_packet_ptr) {
+        MAC_CHECK(enc28j60_set_read_ptr(emac, emac->next_packet_ptr) == ESP_OK,
+                  "set read pointer failed", out, ESP_FAIL);
+    }
+    emac->read_ptr = ENC28J60_READ_PTR_UNKNOWN;
+
+    // read packet header with speculative part of the content
+    MAC_CHECK(enc28j60_do_memory_read(emac, rx_head, sizeof(rx_head)) == ESP_OK,
               "read header failed", out, ESP_FAIL);
+    uint32_t read_len = sizeof(rx_head);
 
     // get packets' length, address
-    rx_len = header.length_low + (header.length_high << 8);
-    next_packet_addr = header.next_packet_low + (header.next_packet_high << 8);
-
-    // read packet content
-    MAC_CHECK(enc28j60_read_packet(emac, enc28j60_rx_packet_start(emac->next_packet_ptr, ENC28J60_RSV_SIZE), buf, rx_len) == ESP_OK,
-              "read packet content failed", out, ESP_FAIL);
+    rx_len = header->length_low + (header->length_high << 8);
+    next_packet_addr = header->next_packet_low + (header->next_packet_high << 8);
+
+    if (rx_len >= 4 && rx_len <= ETH_MAX_PACKET_SIZE && emac->rx_check_dest &&
+            !enc28j60_rx_frame_wanted(emac, rx_head + ENC28J60_RSV_SIZE)) {
+        // passed the hash table only by a hash collision, skip the rest of the frame
+        emac->stats.rx_filter_rejected++;
+        emac->read_ptr = enc28j60_rx_packet_start(emac, emac->next_packet_ptr, read_len);
+        rx_len = 4; // drop the frame
+    } else if (rx_len >= 4 && rx_len <= ETH_MAX_PACKET_SIZE) {
+        // read rest of the packet content, ERDPT wraps around at the end of RX buffer
+        uint32_t head_len = rx_len < ENC28J60_RX_SPECULATIVE_LEN ? rx_len : ENC28J60_RX_SPECULATIVE_LEN;
+        memcpy(buf, rx_head + ENC28J60_RSV_SIZE, head_len);
+        if (rx_len > head_len) {
+            MAC_CHECK(enc28j60_do_memory_read(emac, buf + head_len, rx_len - head_len) == ESP_OK,
+                      "read packet content failed", out, ESP_FAIL);
+            read_len += rx_len - head_len;
+        }
+        emac->read_ptr = enc28j60_rx_packet_start(emac, emac->next_packet_ptr, read_len);
+    } else {
+        ESP_LOGW(TAG, "invalid frame length %u", rx_len);
+        rx_len = 4; // drop the frame
+    }
 
     // free receive buffer space
-    uint32_t erxrdpt = enc28j60_next_ptr_align_odd(next_packet_addr, ENC28J60_BUF_RX_START, ENC28J60_BUF_RX_END);
+    uint32_t erxrdpt = enc28j60_next_ptr_align_odd(next_packet_addr, ENC28J60_BUF_RX_START, emac->rx_end);
     MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXRDPTL, (erxrdpt & 0xFF)) == ESP_OK,
               "write ERXRDPTL failed", out, ESP_FAIL);
     MAC_CHECK(enc28j60_register_write(emac, ENC28J60_ERXRDPTH, (erxrdpt & 0xFF00) >> 8) == ESP_OK,
@@ -1020,12 +2064,23 @@ static esp_err_t emac_enc28j60_receive(esp_eth_mac_t *mac, uint8_t *buf, uint32_
 
     MAC_CHECK(enc28j60_do_bitwise_set(emac, ENC28J60_ECON2, ECON2_PKTDEC) == ESP_OK,
               "set ECON2.PKTDEC failed", out, ESP_FAIL);
-    MAC_CHECK(enc28j60_register_read(emac, ENC28J60_EPKTCNT, &pk_counter) == ESP_OK,
-              "read EPKTCNT failed", out, ESP_FAIL);
+    if (emac->rx_pkt_pending > 0) {
+        emac->rx_pkt_pending--;
+    }
+    // EPKTCNT is in bank 1, read it only when the packets counted last time are processed
+    // so the receive of a batch of packets stays in bank 0
+    if (emac->rx_pkt_pending == 0) {
+        MAC_CHECK(enc28j60_register_read(emac, ENC28J60_EPKTCNT, &pk_counter) == ESP_OK,
+                  "read EPKTCNT failed", out, ESP_FAIL);
+        emac->rx_pkt_pending = pk_counter;
+    }
 
     *length = rx_len - 4; // substract the CRC length
-    emac->packets_remain = pk_counter > 0;
+    emac->packets_remain = emac->rx_pkt_pending > 0;
+    emac->stats.rx_frames++;
 out:
+    enc28j60_count_frame_spi(emac, &emac->stats.rx_spi_transactions, &emac->stats.rx_spi_bytes, spi_transactions, spi_bytes);
+    enc28j60_burst_end(emac);
     return ret;
 }
 
@@ -1038,6 +2093,20 @@ eth_enc28j60_rev_t emac_enc28j60_get_chip_info(esp_eth_mac_t *mac)
     return emac->revision;
 }
 
+esp_err_t emac_enc28j60_get_stats(esp_eth_mac_t *mac, eth_enc28j60_stats_t *stats)
+{
+    esp_err_t ret = ESP_OK;
+    MAC_CHECK(mac && stats, "can't get stats to null", out, ESP_ERR_INVALID_ARG);
+    emac_enc28j60_t *emac = __containerof(mac, emac_enc28j60_t, parent);
+    memcpy(stats, &emac->stats, sizeof(eth_enc28j60_stats_t));
+    if (esp_timer_get_time() - emac->bank_switch_window_start >= 2 * ENC28J60_STATS_RATE_PERIOD_US) {
+        stats->bank_switches_per_sec = 0; // no bank switch in last period
+    }
+    stats->rx_task_stack_free = uxTaskGetStackHighWaterMark(emac->rx_task_hdl);
+out:
+    return ret;
+}
+
 static esp_err_t emac_enc28j60_init(esp_eth_mac_t *mac)
 {
     esp_err_t ret = ESP_OK;
@@ -1062,8 +2131,8 @@ static esp_err_t emac_enc28j60_init(esp_eth_mac_t *mac)
     MAC_CHECK(enc28j60_verify_id(emac) == ESP_OK, "vefiry chip ID failed", out, ESP_FAIL);
     /* default setup of internal registers */
     MAC_CHECK(enc28j60_setup_default(emac) == ESP_OK, "enc28j60 default setup failed", out, ESP_FAIL);
-    /* clear multicast hash table */
-    MAC_CHECK(enc28j60_clear_multicast_table(emac) == ESP_OK, "clear multicast table failed", out, ESP_FAIL);
+    /* write multicast hash table */
+    MAC_CHECK(enc28j60_write_multicast_table(emac) == ESP_OK, "write multicast table failed", out, ESP_FAIL);
 
     return ESP_OK;
 out:
@@ -1091,16 +2160,38 @@ static esp_err_t emac_enc28j60_deinit(esp_eth_mac_t *mac)
     return ESP_OK;
 }
 
+/**
+ * @brief Stop and delete the RX task
+ * @note vTaskDelete of a task which runs, even on the other core, leaves the cleanup of its TCB to the
+ *       idle task, after emac with the static TCB is freed. So the task is asked to exit and deleted
+ *       when it is suspended. FreeRTOS then removes it at once and doesn't access the TCB after vTaskDelete.
+ */
+static void enc28j60_rx_task_delete(emac_enc28j60_t *emac)
+{
+    atomic_store(&emac->rx_task_exit, true);
+    xTaskNotifyGive(emac->rx_task_hdl);
+    while (eTaskGetState(emac->rx_task_hdl) != eSuspended) {
+        vTaskDelay(1);
+    }
+    vTaskDelete(emac->rx_task_hdl);
+}
+
 static esp_err_t emac_enc28j60_del(esp_eth_mac_t *mac)
 {
     emac_enc28j60_t *emac = __containerof(mac, emac_enc28j60_t, parent);
     if (emac->poll_timer) {
         esp_timer_delete(emac->poll_timer);
     }
-    vTaskDelete(emac->rx_task_hdl);
+    enc28j60_rx_task_delete(emac);
     emac->spi.deinit(emac->spi.ctx);
     vSemaphoreDelete(emac->reg_trans_lock);
     vSemaphoreDelete(emac->tx_ready_sem);
+    if (emac->tx_lock) {
+        vSemaphoreDelete(emac->tx_lock);
+    }
+    if (emac->rx_pool) {
+        enc28j60_rx_pool_delete(emac->rx_pool);
+    }
     free(emac);
     return ESP_OK;
 }
@@ -1115,13 +2206,43 @@ esp_eth_mac_t *esp_eth_mac_new_enc28j60(const eth_enc28j60_config_t *enc28j60_co
     MAC_CHECK(emac, "calloc emac failed", err, NULL);
     /* enc28j60 driver is interrupt driven */
     MAC_CHECK((enc28j60_config->int_gpio_num >= 0)  != (enc28j60_config->poll_period_ms > 0), "invalid configuration argument combination", err, NULL);
-
-    emac->last_bank = 0xFF;
+    MAC_CHECK(enc28j60_config->rx_buf_pool_size <= ENC28J60_RX_POOL_MAX_SIZE, "RX buffer pool too large", err, NULL);
+    /* validate buffer layout, ERXND must be odd (ERXST is even) */
+    uint32_t tx_buf_size = enc28j60_config->tx_buf_size;
+    if (tx_buf_size == 0) {
+        tx_buf_size = enc28j60_config->tx_double_buffer ? ENC28J60_BUF_TX_SIZE_DOUBLE_DEFAULT : ENC28J60_BUF_TX_SIZE_DEFAULT;
+    }
+    MAC_CHECK(!(tx_buf_size & 1), "TX buffer size must be even", err, NULL);
+    MAC_CHECK(tx_buf_size >= ENC28J60_BUF_TX_SIZE_MIN, "TX buffer size too small", err, NULL);
+    MAC_CHECK(tx_buf_size <= ENC28J60_BUFFER_SIZE - ENC28J60_BUF_RX_SIZE_MIN, "TX buffer size too large", err, NULL);
+    MAC_CHECK(!enc28j60_config->tx_double_buffer || tx_buf_size >= 2 * ENC28J60_BUF_TX_SIZE_MIN,
+              "TX buffer size too small for double buffering", err, NULL);
+    MAC_CHECK(enc28j60_config->rx_filter <= ENC28J60_RX_FILTER_PATTERN, "invalid rx filter", err, NULL);
+    MAC_CHECK(enc28j60_config->rx_filter != ENC28J60_RX_FILTER_PATTERN || enc28j60_config->rx_pattern,
+              "rx filter pattern missing", err, NULL);
+
+    emac->last_bank = ENC28J60_BANK_UNKNOWN;
+    emac->tx_start = ENC28J60_BUFFER_SIZE - tx_buf_size;
+    emac->rx_end = emac->tx_start - 1;
+    emac->tx_double_buffer = enc28j60_config->tx_double_buffer;
+    emac->tx_checksum_offload = enc28j60_config->tx_checksum_offload;
+    emac->rx_filter = enc28j60_config->rx_filter;
+    if (emac->rx_filter == ENC28J60_RX_FILTER_UNICAST_ARP) {
+        enc28j60_arp_pattern(&emac->rx_pattern);
+    } else if (emac->rx_filter == ENC28J60_RX_FILTER_PATTERN) {
+        emac->rx_pattern = *enc28j60_config->rx_pattern;
+    }
+    emac->tx_slot_size = (tx_buf_size / 2) & ~1;
+    emac->tx_in_flight = ENC28J60_TX_SLOT_NONE;
+    emac->tx_staged = ENC28J60_TX_SLOT_NONE;
     emac->next_packet_ptr = ENC28J60_BUF_RX_START;
+    emac->read_ptr = ENC28J60_READ_PTR_UNKNOWN;
+    portMUX_INITIALIZE(&emac->mac_filter_lock);
     /* bind methods and attributes */
     emac->sw_reset_timeout_ms = mac_config->sw_reset_timeout_ms;
     emac->int_gpio_num = enc28j60_config->int_gpio_num;
     emac->poll_period_ms = enc28j60_config->poll_period_ms;
+    emac->rx_poll_budget = enc28j60_config->rx_poll_budget;
     emac->parent.set_mediator = emac_enc28j60_set_mediator;
     emac->parent.init = emac_enc28j60_init;
     emac->parent.deinit = emac_enc28j60_deinit;
@@ -1136,6 +2257,10 @@ esp_eth_mac_t *esp_eth_mac_new_enc28j60(const eth_enc28j60_config_t *enc28j60_co
     emac->parent.set_duplex = emac_enc28j60_set_duplex;
     emac->parent.set_link = emac_enc28j60_set_link;
     emac->parent.set_promiscuous = emac_enc28j60_set_promiscuous;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+    emac->parent.add_mac_filter = emac_enc28j60_add_mac_filter;
+    emac->parent.rm_mac_filter = emac_enc28j60_rm_mac_filter;
+#endif
     emac->parent.transmit = emac_enc28j60_transmit;
     emac->parent.receive = emac_enc28j60_receive;
 
@@ -1146,6 +2271,7 @@ esp_eth_mac_t *esp_eth_mac_new_enc28j60(const eth_enc28j60_config_t *enc28j60_co
         emac->spi.deinit = enc28j60_config->custom_spi_driver.deinit;
         emac->spi.read = enc28j60_config->custom_spi_driver.read;
         emac->spi.write = enc28j60_config->custom_spi_driver.write;
+        emac->spi_burst = enc28j60_config->spi_burst;
         /* Custom SPI driver device init */
         ESP_GOTO_ON_FALSE((emac->spi.ctx = emac->spi.init(enc28j60_config->custom_spi_driver.config)) != NULL, NULL, err, TAG, "SPI initialization failed");
     } else {
@@ -1158,19 +2284,36 @@ esp_eth_mac_t *esp_eth_mac_new_enc28j60(const eth_enc28j60_config_t *enc28j60_co
         ESP_GOTO_ON_FALSE((emac->spi.ctx = emac->spi.init(enc28j60_config)) != NULL, NULL, err, TAG, "SPI initialization failed");
     }
 /* create mutex */
-    emac->reg_trans_lock = xSemaphoreCreateMutex();
+    emac->reg_trans_lock = xSemaphoreCreateRecursiveMutex();
     MAC_CHECK(emac->reg_trans_lock, "create register transaction lock failed", err, NULL);
-    emac->tx_ready_sem = xSemaphoreCreateBinary();
-    MAC_CHECK(emac->tx_ready_sem, "create pkt transmit ready semaphore failed", err, NULL);
-    xSemaphoreGive(emac->tx_ready_sem); // ensures the first transmit is performed without waiting
+    if (emac->tx_double_buffer) {
+        emac->tx_ready_sem = xSemaphoreCreateCounting(2, 2);
+        MAC_CHECK(emac->tx_ready_sem, "create pkt transmit ready semaphore failed", err, NULL);
+        emac->tx_lock = xSemaphoreCreateMutex();
+        MAC_CHECK(emac->tx_lock, "create tx lock failed", err, NULL);
+    } else {
+        emac->tx_ready_sem = xSemaphoreCreateBinary();
+        MAC_CHECK(emac->tx_ready_sem, "create pkt transmit ready semaphore failed", err, NULL);
+        xSemaphoreGive(emac->tx_ready_sem); // ensures the first transmit is performed without waiting
+    }
+    if (enc28j60_config->rx_buf_pool_size > 0) {
+        emac->rx_pool = enc28j60_rx_pool_create(enc28j60_config->rx_buf_pool_size);
+        MAC_CHECK(emac->rx_pool, "create RX buffer pool failed", err, NULL);
+    }
     /* create enc28j60 task */
     BaseType_t core_num = tskNO_AFFINITY;
     if (mac_config->flags & ETH_MAC_FLAG_PIN_TO_CORE) {
         core_num = esp_cpu_get_core_id();
     }
-    BaseType_t xReturned = xTaskCreatePinnedToCore(emac_enc28j60_task, "enc28j60_tsk", mac_config->rx_task_stack_size, emac,
-                           mac_config->rx_task_prio, &emac->rx_task_hdl, core_num);
-    MAC_CHECK(xReturned == pdPASS, "create enc28j60 task failed", err, NULL);
+    if (enc28j60_config->rx_task_stack) {
+        emac->rx_task_hdl = xTaskCreateStaticPinnedToCore(emac_enc28j60_task, "enc28j60_tsk", mac_config->rx_task_stack_size, emac,
+                            mac_config->rx_task_prio, enc28j60_config->rx_task_stack, &emac->rx_task_tcb, core_num);
+        MAC_CHECK(emac->rx_task_hdl, "create enc28j60 task failed", err, NULL);
+    } else {
+        BaseType_t xReturned = xTaskCreatePinnedToCore(emac_enc28j60_task, "enc28j60_tsk", mac_config->rx_task_stack_size, emac,
+                               mac_config->rx_task_prio, &emac->rx_task_hdl, core_num);
+        MAC_CHECK(xReturned == pdPASS, "create enc28j60 task failed", err, NULL);
+    }
 
     if (emac->int_gpio_num < 0) {
         const esp_timer_create_args_t poll_timer_args = {
@@ -1189,7 +2332,7 @@ err:
             esp_timer_delete(emac->poll_timer);
         }
         if (emac->rx_task_hdl) {
-            vTaskDelete(emac->rx_task_hdl);
+            enc28j60_rx_task_delete(emac);
         }
         if (emac->spi.ctx) {
             emac->spi.deinit(emac->spi.ctx);
@@ -1200,6 +2343,12 @@ err:
         if (emac->tx_ready_sem) {
             vSemaphoreDelete(emac->tx_ready_sem);
         }
+        if (emac->tx_lock) {
+            vSemaphoreDelete(emac->tx_lock);
+        }
+        if (emac->rx_pool) {
+            enc28j60_rx_pool_delete(emac->rx_pool);
+        }
         free(emac);
     }
     return ret;